@@ -19,6 +19,7 @@
 #include <QEvent>
 
 #include <fmt/format.h>
+#include <algorithm>
 #include <string.h>
 #include <stdexcept>
 #include <string>
@@ -28,12 +29,10 @@ using std::vector;
 
 AMOR2DTofPlot::AMOR2DTofPlot(Configuration &Config,
                              ESSConsumer &Consumer)
-    : AbstractPlot(PlotType::TOF2D, Consumer, Config) {
-  if ((not(mConfig.mGeometry.YDim <= TOF2DY) or
-       (not(mConfig.mTOF.BinSize <= TOF2DX)))) {
-    throw(std::runtime_error("2D TOF histogram size mismatch"));
-  }
-  memset(HistogramData2D, 0, sizeof(HistogramData2D));
+    : AbstractPlot(PlotType::TOF2D, Consumer, Config)
+    , HistogramData2D(Config, "tof2d",
+                      Config.mTOF.BinSize * Config.mGeometry.YDim)
+    , mWindow(Config, HistogramData2D.size()) {
 
   connect(this, &QCustomPlot::mouseMove, this, &AMOR2DTofPlot::showPointToolTip);
   setAttribute(Qt::WA_AlwaysShowToolTips);
@@ -89,6 +88,11 @@ AMOR2DTofPlot::AMOR2DTofPlot(Configuration &Config,
   // rescale the key (x) and value (y) axes so the whole color map is visible:
   rescaleAxes();
 
+  // Show counts picked up from a previous run
+  if (HistogramData2D.resumed()) {
+    plotDetectorImage(true);
+  }
+
   t1 = std::chrono::high_resolution_clock::now();
 }
 
@@ -127,20 +131,28 @@ AMOR2DTofPlot::getColorGradient(const std::string &GradientName) {
 }
 
 void AMOR2DTofPlot::clearDetectorImage() {
-  memset(HistogramData2D, 0, sizeof(HistogramData2D));
+  HistogramData2D.clear();
+  mWindow.clear();
+  mConsumer.clearCube(mConfig.mPlot.Source);
   plotDetectorImage(true);
 }
 
+void AMOR2DTofPlot::setBinCell(uint32_t Index) {
+  const int YDim = mConfig.mGeometry.YDim;
+  mColorMap->data()->setCell(Index / YDim, Index % YDim, HistogramData2D[Index]);
+}
+
 void AMOR2DTofPlot::plotDetectorImage(bool Force) {
   setCustomParameters();
 
-  for (int y = 0; y < mConfig.mGeometry.YDim; y++) {
+  const int YDim = mConfig.mGeometry.YDim;
+  for (int y = 0; y < YDim; y++) {
     for (unsigned int x = 0; x < mConfig.mTOF.BinSize; x++) {
-      if ((HistogramData2D[x][y] == 0) and (not Force)) {
+      const uint32_t Count = HistogramData2D[x * YDim + y];
+      if ((Count == 0) and (not Force)) {
         continue;
       }
-      // printf("debug x %u, y %u, z %u\n", x, y, HistogramData2D[x][y]);
-      mColorMap->data()->setCell(x, y, HistogramData2D[x][y]);
+      mColorMap->data()->setCell(x, y, Count);
     }
   }
 
@@ -153,23 +165,45 @@ void AMOR2DTofPlot::plotDetectorImage(bool Force) {
 
 void AMOR2DTofPlot::updateData() {
   // Get newest histogram data from Consumer
-  vector<uint32_t> PixelIDs = mConsumer.readData(DataType::PIXEL_ID);
-  vector<uint32_t> TOFs = mConsumer.readData(DataType::TOF);
-
-  // Accumulate counts, PixelId 0 does not exist
-  if (PixelIDs.size() == 0) {
-    return;
-  }
-
-  for (uint i = 0; i < PixelIDs.size(); i++) {
+  const std::string source = mConfig.mPlot.Source;
+  vector<uint32_t> PixelIDs =
+      mConsumer.readData(DataType::PIXEL_ID, source, mSubscriber);
+  vector<uint32_t> TOFs =
+      mConsumer.readData(DataType::TOF, source, mSubscriber);
+
+  // Histogram the events first, so each changed cell is updated once.
+  // PixelId 0 does not exist
+  const int YDim = mConfig.mGeometry.YDim;
+  AdaptiveHistogram Delta(HistogramData2D.size(),
+                          mConfig.mGeometry.SparseOccupancy);
+  const size_t Events = std::min(PixelIDs.size(), TOFs.size());
+  for (uint i = 0; i < Events; i++) {
     if (PixelIDs[i] == 0) {
       continue;
     }
-    int tof = TOFs[i];
+    uint32_t tof = TOFs[i];
     int yvals = (PixelIDs[i] - 1) / mConfig.mGeometry.XDim;
-    HistogramData2D[tof][yvals]++;
+    if (tof >= mConfig.mTOF.BinSize or yvals >= YDim) {
+      continue;
+    }
+    Delta.add(tof * YDim + yvals);
   }
-  plotDetectorImage(false);
+
+  setCustomParameters();
+  Delta.forEach([this](uint32_t Index, uint32_t Count) {
+    HistogramData2D[Index] += Count;
+    setBinCell(Index);
+  });
+  mWindow.add(Delta);
+
+  // Subtract counts which have left the sliding window
+  mWindow.expire([this](uint32_t Index, uint32_t Count) {
+    HistogramData2D[Index] -= Count;
+    setBinCell(Index);
+  });
+
+  mColorMap->rescaleDataRange(true);
+  replot();
 
   return;
 }
@@ -9,6 +9,8 @@
 #pragma once
 
 #include <AbstractPlot.h>
+#include <MappedHistogram.h>
+#include <SlidingWindow.h>
 
 #include <QPlot/qcustomplot/qcustomplot.h>
 
@@ -28,8 +30,7 @@ public:
   /// \brief plot needs the configurable plotting options
   AMOR2DTofPlot(Configuration &Config, ESSConsumer &Consumer);
 
-  /// \brief adds histogram data, clears periodically then calls
-  /// plotDetectorImage()
+  /// \brief adds event data, only the cells which changed are updated
   void updateData() override;
 
   /// \brief Support for different gradients
@@ -49,14 +50,19 @@ public slots:
   void showPointToolTip(QMouseEvent *event);
 
 private:
+  /// \brief copy the counts of a histogram bin to its color map cell
+  void setBinCell(uint32_t Index);
+
   // QCustomPlot variables
   QCPColorScale *mColorScale{nullptr};
   QCPColorMap *mColorMap{nullptr};
 
-  /// \brief allocated according to config in constructor
-  #define TOF2DX 512
-  #define TOF2DY 512
-  uint32_t HistogramData2D[TOF2DX + 1][TOF2DY + 1];
+  /// \brief TOF bin x Y counts allocated according to config in
+  /// constructor, optionally persistent. Indexed by TofBin * YDim + Y
+  MappedHistogram HistogramData2D;
+
+  /// \brief recent deltas, to show a sliding window if configured
+  SlidingWindow mWindow;
 
   /// \brief for calculating x, y, z from pixelid
   ESSGeometry *LogicalGeometry;
@@ -16,7 +16,7 @@ AbstractPlot::AbstractPlot(PlotType Type, ESSConsumer &Consumer, Configuration &
     , mConfig(Config)
     , mPlotType(Type)
     , mZoomRectActive(false) {
-    mConsumer.addSubscriber(mPlotType);
+    mSubscriber = mConsumer.addSubscriber(mPlotType);
     mConsumer.addSource(mConfig.mPlot.Source);
   };
 
@@ -132,10 +132,17 @@ void AbstractPlot::mousePressEvent(QMouseEvent *event) {
   // Initiate a zoom rectangle if
   //
   //   - Left mouse and Ctrl keyboard modifier is pressed
+  //
+  // or a region selection rectangle if
+  //
+  //   - Left mouse and Shift keyboard modifier is pressed, and the plot
+  //     supports regions
   const bool leftMouse = event->button() == Qt::LeftButton;
   const bool ctrlOn = event->modifiers() == Qt::ControlModifier;
-  if (leftMouse && ctrlOn) {
+  const bool shiftOn = event->modifiers() == Qt::ShiftModifier;
+  if (leftMouse && (ctrlOn || (shiftOn && mRegionsEnabled))) {
     mZoomRectActive = true;
+    mRegionRectActive = shiftOn;
     mPoint0 = event->position().toPoint();
     // fmt::print("mousePressEvent: {} {}\n", mPoint0->x(), mPoint0->y());
   }
@@ -174,12 +181,17 @@ void AbstractPlot::mouseReleaseEvent(QMouseEvent *event) {
   const double y0 = yAxis->pixelToCoord(mPoint0->y());
   const double y1 = yAxis->pixelToCoord(mPoint1->y());
 
-  // Set new axis ranges
-  xAxis->setRange(x0, x1);
-  yAxis->setRange(y0, y1);
+  // Select a region, or set new axis ranges
+  if (mRegionRectActive) {
+    selectRegion(QRectF(QPointF(x0, y0), QPointF(x1, y1)).normalized());
+  } else {
+    xAxis->setRange(x0, x1);
+    yAxis->setRange(y0, y1);
+  }
 
   // Reset zoom vars and request canvas update
   mZoomRectActive = false;
+  mRegionRectActive = false;
   mPoint0 = std::nullopt;
   mPoint1 = std::nullopt;
 
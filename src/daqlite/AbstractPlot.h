@@ -24,6 +24,9 @@ class AbstractPlot : public QCustomPlot {
 public:
   PlotType getPlotType() { return mPlotType; }
 
+  /// \brief Id used to read out data from the consumer
+  int getSubscriber() const { return mSubscriber; }
+
   virtual void clearDetectorImage() = 0;
 
   virtual void updateData() = 0;
@@ -40,6 +43,16 @@ protected:
   /// \brief Reference to main Configuration
   Configuration &mConfig;
 
+  /// \brief Subscriber id returned by the consumer
+  int mSubscriber{-1};
+
+  /// \brief Allow Shift + left mouse to select a region instead of zooming
+  bool mRegionsEnabled{false};
+
+  /// \brief Called with the rectangle selected with Shift + left mouse, in
+  /// plot coordinates
+  virtual void selectRegion(const QRectF &) {}
+
 private:
   /// \brief Store default axis ranges.
   void showEvent(QShowEvent *) override;
@@ -70,6 +83,9 @@ private:
   /// Zoom rectangle vars
   bool mZoomRectActive;
 
+  /// \brief The rectangle selects a region rather than a zoom range
+  bool mRegionRectActive{false};
+
   /// \brief First zoom rectangle corner
   std::optional<QPointF> mPoint0;
 
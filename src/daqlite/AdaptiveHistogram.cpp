@@ -0,0 +1,154 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file AdaptiveHistogram.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <AdaptiveHistogram.h>
+
+#include <algorithm>
+
+AdaptiveHistogram::AdaptiveHistogram(size_t Bins, double Occupancy)
+    : mBins(Bins)
+    , mOccupancy(Occupancy) {
+  if (mOccupancy <= 0.0 and mBins > 0) {
+    makeDense();
+  }
+}
+
+void AdaptiveHistogram::addSparse(uint32_t Index, uint32_t Count) {
+  assert(mBins == 0 or Index < mBins);
+
+  // Keep the load factor at or below one half
+  if (2 * (mOccupied + 1) > mKeys.size()) {
+    rehash(std::max(MIN_SLOTS, 2 * mKeys.size()));
+  }
+
+  const size_t Slot = slot(Index);
+  if (mKeys[Slot] == EMPTY) {
+    mKeys[Slot] = Index;
+    mCounts[Slot] = 0;
+    mOccupied++;
+  }
+  mCounts[Slot] += Count;
+
+  if (mBins > 0 and mOccupied > mOccupancy * mBins) {
+    makeDense();
+  }
+}
+
+void AdaptiveHistogram::rehash(size_t Slots) {
+  std::vector<uint32_t> Keys(Slots, EMPTY);
+  std::vector<uint32_t> Counts(Slots, 0);
+  Keys.swap(mKeys);
+  Counts.swap(mCounts);
+  mMask = Slots - 1;
+
+  for (size_t i = 0; i < Keys.size(); i++) {
+    if (Keys[i] != EMPTY) {
+      const size_t Slot = slot(Keys[i]);
+      mKeys[Slot] = Keys[i];
+      mCounts[Slot] = Counts[i];
+    }
+  }
+}
+
+void AdaptiveHistogram::makeDense() {
+  std::vector<uint32_t> Counts(mBins, 0);
+  forEach([&Counts](uint32_t Index, uint32_t Count) { Counts[Index] += Count; });
+
+  mCounts.swap(Counts);
+  mKeys.clear();
+  mKeys.shrink_to_fit();
+  mMask = 0;
+  mOccupied = 0;
+  mDense = true;
+}
+
+void AdaptiveHistogram::merge(const AdaptiveHistogram &Other) {
+  if (Other.mBins > mBins) {
+    resize(Other.mBins);
+  }
+
+  // Dense into dense is a plain element-wise add
+  if (Other.mDense and not mDense and
+      mOccupied + Other.mBins > mOccupancy * mBins) {
+    makeDense();
+  }
+  if (Other.mDense and mDense) {
+    for (size_t i = 0; i < Other.mCounts.size(); i++) {
+      mCounts[i] += Other.mCounts[i];
+    }
+    return;
+  }
+
+  Other.forEach([this](uint32_t Index, uint32_t Count) { add(Index, Count); });
+}
+
+uint32_t AdaptiveHistogram::at(uint32_t Index) const {
+  if (mDense) {
+    return Index < mCounts.size() ? mCounts[Index] : 0;
+  }
+  if (mOccupied == 0) {
+    return 0;
+  }
+
+  const size_t Slot = slot(Index);
+  return mKeys[Slot] == EMPTY ? 0 : mCounts[Slot];
+}
+
+std::vector<uint32_t> AdaptiveHistogram::toDense() const {
+  if (mDense) {
+    return mCounts;
+  }
+
+  std::vector<uint32_t> Counts(mBins, 0);
+  forEach([&Counts](uint32_t Index, uint32_t Count) {
+    if (Index < Counts.size()) {
+      Counts[Index] += Count;
+    }
+  });
+  return Counts;
+}
+
+void AdaptiveHistogram::resize(size_t Bins) {
+  mBins = Bins;
+
+  if (mDense) {
+    mCounts.resize(Bins, 0);
+    return;
+  }
+
+  // Drop sparse bins which no longer exist
+  if (mOccupied > 0) {
+    std::vector<uint32_t> Keys;
+    Keys.swap(mKeys);
+    std::vector<uint32_t> Counts;
+    Counts.swap(mCounts);
+    mOccupied = 0;
+    mMask = 0;
+    // Reinserting may convert to dense part way, so add() picks the form
+    for (size_t i = 0; i < Keys.size(); i++) {
+      if (Keys[i] != EMPTY and Keys[i] < Bins) {
+        add(Keys[i], Counts[i]);
+      }
+    }
+  }
+
+  if (not mDense and mBins > 0 and (mOccupancy <= 0.0 or mOccupied > mOccupancy * mBins)) {
+    makeDense();
+  }
+}
+
+void AdaptiveHistogram::clear() {
+  mKeys.clear();
+  mCounts.clear();
+  mMask = 0;
+  mOccupied = 0;
+  mDense = false;
+
+  if (mOccupancy <= 0.0 and mBins > 0) {
+    makeDense();
+  }
+}
@@ -0,0 +1,216 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file AdaptiveHistogram.h
+///
+/// \brief Histogram which is sparse at low occupancy and dense otherwise
+///
+/// Large detectors (1000 x 1000 pixels and more) often only see a few
+/// thousand pixels during commissioning, and a message rarely touches more
+/// than a small fraction of the pixels. The histogram starts out as an open
+/// addressing hash of touched bins and converts itself to a dense vector once
+/// the occupancy crosses a configurable fraction of the bins.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/// \class AdaptiveHistogram
+/// \brief Counts per bin index, stored sparse or dense depending on occupancy
+class AdaptiveHistogram {
+public:
+  /// \brief Occupancy above which the histogram becomes dense
+  static constexpr double DEFAULT_OCCUPANCY{0.1};
+
+  /// \brief Constructor
+  /// \param Bins       Number of bins, may grow later. Zero if not yet known
+  /// \param Occupancy  Fraction of occupied bins at which the histogram
+  ///                   converts to dense. Zero means always dense
+  explicit AdaptiveHistogram(size_t Bins = 0,
+                             double Occupancy = DEFAULT_OCCUPANCY);
+
+  /// \brief Add counts to a bin
+  /// \param Index  Bin index, must be below the number of bins if known
+  /// \param Count  Counts to add
+  inline void add(uint32_t Index, uint32_t Count = 1) {
+    if (mDense) {
+      assert(Index < mCounts.size());
+      mCounts[Index] += Count;
+      return;
+    }
+
+    addSparse(Index, Count);
+  }
+
+  /// \brief Add dense values element-wise, growing the bins if needed
+  /// \param Values  Any container with size() and operator[] returning counts
+  template <typename Container> void addValues(const Container &Values) {
+    if (Values.size() > mBins) {
+      resize(Values.size());
+    }
+
+    // Plain element-wise add when dense, which the compiler can vectorize
+    if (mDense) {
+      for (size_t i = 0; i < Values.size(); i++) {
+        mCounts[i] += static_cast<uint32_t>(Values[i]);
+      }
+      return;
+    }
+
+    for (size_t i = 0; i < Values.size(); i++) {
+      if (Values[i] != 0) {
+        add(i, static_cast<uint32_t>(Values[i]));
+      }
+    }
+  }
+
+  /// \brief Add all counts of another histogram
+  void merge(const AdaptiveHistogram &Other);
+
+  /// \brief Call Fn(Index, Count) for all bins with non zero counts. Sparse
+  /// histograms are visited in no particular order.
+  template <typename Function> void forEach(Function &&Fn) const {
+    if (mDense) {
+      for (size_t i = 0; i < mCounts.size(); i++) {
+        if (mCounts[i] != 0) {
+          Fn(static_cast<uint32_t>(i), mCounts[i]);
+        }
+      }
+      return;
+    }
+
+    for (size_t i = 0; i < mKeys.size(); i++) {
+      if (mKeys[i] != EMPTY) {
+        Fn(mKeys[i], mCounts[i]);
+      }
+    }
+  }
+
+  /// \return counts of one bin
+  uint32_t at(uint32_t Index) const;
+
+  /// \return all counts as a dense vector with one element per bin
+  std::vector<uint32_t> toDense() const;
+
+  /// \brief Set the number of bins, keeping counts of bins which remain
+  void resize(size_t Bins);
+
+  /// \brief Remove all counts and return to the sparse form
+  void clear();
+
+  /// \return number of bins
+  size_t size() const { return mBins; }
+
+  /// \return number of bins with non zero counts for sparse histograms, or
+  /// number of bins for dense ones
+  size_t occupied() const { return mDense ? mBins : mOccupied; }
+
+  bool isDense() const { return mDense; }
+
+  bool empty() const { return mDense ? false : mOccupied == 0; }
+
+  /// \return memory used for the counts
+  size_t bytes() const {
+    return (mKeys.capacity() + mCounts.capacity()) * sizeof(uint32_t);
+  }
+
+private:
+  /// \brief Marks an unused hash slot
+  static constexpr uint32_t EMPTY{UINT32_MAX};
+
+  /// \brief Smallest number of hash slots
+  static constexpr size_t MIN_SLOTS{64};
+
+  /// \brief Sparse insert, may convert to dense
+  void addSparse(uint32_t Index, uint32_t Count);
+
+  /// \brief Rehash into a table with the given number of slots
+  void rehash(size_t Slots);
+
+  /// \brief Switch to the dense representation
+  void makeDense();
+
+  /// \return slot for an index, either holding it or empty
+  inline size_t slot(uint32_t Index) const {
+    size_t Slot = (Index * 0x9E3779B97F4A7C15ULL) >> 32 & mMask;
+    while (mKeys[Slot] != EMPTY and mKeys[Slot] != Index) {
+      Slot = (Slot + 1) & mMask;
+    }
+    return Slot;
+  }
+
+  size_t mBins{0};
+  double mOccupancy{DEFAULT_OCCUPANCY};
+  bool mDense{false};
+
+  /// \brief Sparse: bin index per slot, EMPTY if unused
+  std::vector<uint32_t> mKeys;
+
+  /// \brief Sparse: counts per slot. Dense: counts per bin
+  std::vector<uint32_t> mCounts;
+
+  size_t mMask{0};
+  size_t mOccupied{0};
+};
+
+/// \class ThreadSafeHistogram
+/// \brief Mutex protected AdaptiveHistogram, as ThreadSafeVector is for
+/// std::vector
+class ThreadSafeHistogram {
+public:
+  /// \brief Set the conversion threshold for the histogram
+  void setOccupancy(double Occupancy) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mHistogram = AdaptiveHistogram(mHistogram.size(), Occupancy);
+    mOccupancy = Occupancy;
+  }
+
+  /// \brief Adds all counts of another histogram
+  void merge(const AdaptiveHistogram &Other) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mHistogram.merge(Other);
+  }
+
+  /// \brief Adds dense values element-wise
+  template <typename Container> void add_values(const Container &Values) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mHistogram.addValues(Values);
+  }
+
+  /// \brief Retrieves a copy of the histogram
+  AdaptiveHistogram get() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHistogram;
+  }
+
+  /// \brief Moves the contents out, leaving an empty histogram of the same
+  /// size
+  AdaptiveHistogram take() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    AdaptiveHistogram Result(mHistogram.size(), mOccupancy);
+    std::swap(Result, mHistogram);
+    return Result;
+  }
+
+  /// \brief Removes all counts
+  void clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mHistogram.clear();
+  }
+
+  /// \return number of bins
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHistogram.size();
+  }
+
+private:
+  mutable std::mutex mMutex;
+  AdaptiveHistogram mHistogram;
+  double mOccupancy{AdaptiveHistogram::DEFAULT_OCCUPANCY};
+};
@@ -0,0 +1,49 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file Binner.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <Binner.h>
+
+#include <Configuration.h>
+
+#include <cmath>
+
+Binner::Binner(const Configuration &Config)
+    : mBins(std::max(Config.mTOF.BinSize, 1u))
+    , mMaxValue(std::max(Config.mTOF.MaxValue, 1u))
+    , mEdges(Config.mTOF.BinEdges) {
+  mUniform = mEdges.size() < 2;
+  if (mUniform) {
+    return;
+  }
+
+  mBins = mEdges.size() - 1;
+  for (size_t i = 1; i < mBins; i++) {
+    mThresholds.push_back(std::max(0.0, std::ceil(mEdges[i])));
+  }
+
+  // Cells small enough that the table covers all edges in LUT_CELLS entries
+  const uint32_t Last = mThresholds.empty() ? 0 : mThresholds.back();
+  while ((Last >> mShift) >= LUT_CELLS) {
+    mShift++;
+  }
+  mLastCell = Last >> mShift;
+
+  mLut.resize(mLastCell + 2);
+  for (uint32_t Cell = 0; Cell <= mLastCell; Cell++) {
+    mLut[Cell] = std::upper_bound(mThresholds.begin(), mThresholds.end(),
+                                  Cell << mShift) -
+                 mThresholds.begin();
+  }
+  mLut[mLastCell + 1] = mThresholds.size();
+}
+
+double Binner::lowerEdge(uint32_t Bin) const {
+  if (not mUniform) {
+    return mEdges[std::min<size_t>(Bin, mEdges.size() - 1)];
+  }
+  return mBins > 1 ? double(Bin) * mMaxValue / (mBins - 1) : Bin * mMaxValue;
+}
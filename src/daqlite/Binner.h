@@ -1,34 +1,83 @@
-// Copyright (C) 2022 European Spallation Source, ERIC. See LICENSE file
+// Copyright (C) 2022 - 2026 European Spallation Source, ERIC. See LICENSE file
 //===----------------------------------------------------------------------===//
 ///
 /// \file Binner.h
 ///
 /// \brief Binning of data, conversion between values and bins
 /// Main use is for TOF binning
+///
+/// Uniform binning uses the original formula, bin = value * (bins - 1) / max.
+/// Non-uniform binning (logarithmic, piecewise linear or an explicit list of
+/// edges, see Configuration) looks the value up in a coarse table of
+/// power-of-two sized cells. Each cell holds the first bin which can contain
+/// a value in the cell, so only the few edges which fall inside the cell are
+/// left to search, which is done without data dependent branches.
 //===----------------------------------------------------------------------===//
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Forward declarations
+class Configuration;
+
 class Binner {
 public:
-  Binner(int bins, int maxvalue) :
-    Bins(bins), MaxValue(maxvalue);
-
-  /// \brief calculate bin number:
-  /// 1) Divide by MaxScaledValue to get values in range 0 - 1
-  /// 2) Multiply by number of Bins to get binsin range 0 - (Bins -1)
-  int valToBin(uint32_t Value) {
-    return std::min((Value * (Bins - 1))/(Scale * MaxValue), Bins);
-  }
+  /// \brief Binning from the tof section of the configuration
+  Binner(const Configuration &Config);
 
-  /// \brief calculate value:
-  /// 1) Divide by (Bins - 1) to get values from 0 - 1
-  /// 2) Multiply by MaxScaledValue to get values from 0 - MaxValue
-  uint32_t binToVal(int Bin) {
-    return std::max((Bin * MaxValue) / (Bins - 1), MaxValue);
+  /// \return bin of a value, values outside the edges go to the first or last
+  /// bin
+  inline uint32_t valueToBin(uint32_t Value) const {
+    if (mUniform) {
+      return uint64_t(std::min(Value, mMaxValue)) * (mBins - 1) / mMaxValue;
+    }
+
+    const uint32_t Cell = std::min(Value >> mShift, mLastCell);
+    const uint32_t *First = mThresholds.data() + mLut[Cell];
+    uint32_t Count = mLut[Cell + 1] - mLut[Cell];
+
+    // Number of thresholds <= Value, the select is compiled to a cmov
+    while (Count > 0) {
+      const uint32_t Half = Count / 2;
+      const bool Above = First[Half] <= Value;
+      First = Above ? First + Half + 1 : First;
+      Count = Above ? Count - Half - 1 : Half;
+    }
+    return First - mThresholds.data();
   }
 
+  /// \return true for the original uniform binning
+  bool uniform() const { return mUniform; }
+
+  /// \return number of bins
+  uint32_t bins() const { return mBins; }
+
+  /// \return lower edge of a bin
+  double lowerEdge(uint32_t Bin) const;
+
+  /// \return upper edge of a bin
+  double upperEdge(uint32_t Bin) const { return lowerEdge(Bin + 1); }
+
 private:
-  int Bins;
-  int MaxValue;
+  /// \brief Maximum number of cells in the coarse lookup table
+  static constexpr uint32_t LUT_CELLS{4096};
+
+  bool mUniform{true};
+  uint32_t mBins{1};
+  uint32_t mMaxValue{1};
+
+  /// \brief Bin edges, empty for uniform binning
+  std::vector<double> mEdges;
+
+  /// \brief Smallest integer value of each inner edge, a value v belongs to
+  /// bin i + 1 or above if v >= mThresholds[i]
+  std::vector<uint32_t> mThresholds;
+
+  /// \brief First bin for each cell of 2^mShift values, with one extra entry
+  std::vector<uint32_t> mLut;
+  uint32_t mShift{0};
+  uint32_t mLastCell{0};
 };
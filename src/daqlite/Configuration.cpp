@@ -10,9 +10,14 @@
 #include <nlohmann/json.hpp>
 
 #include <fmt/core.h>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <functional>
 #include <fstream>
 #include <initializer_list>
 #include <iostream>
+#include <limits>
 #include <stdexcept>
 
 using std::string;
@@ -42,16 +47,18 @@ vector<Configuration> Configuration::getConfigurations(const std::string &Path)
   // ---------------------------------------------------------------------------
   // Common options
   //
-  // Read Kafka, Geometry and TOF options - but no plots
+  // Read Kafka, Geometry, TOF, shared memory, pulse and cube options - but no
+  // plots
   nlohmann::json Common;
-  for (const auto& key: {"kafka", "geometry", "tof"}) {
+  for (const auto& key: {"kafka", "geometry", "tof", "shared_memory", "pulse", "cube"}) {
     if (MainJSON.contains(key)) {
       Common[key] = MainJSON[key];
     }
   }
 
   // Handy utility for adding a plot to a configuration
-  auto addPlot = [](const nlohmann::json &common, const nlohmann::json &plot) {
+  const std::string Name = std::filesystem::path(Path).stem().string();
+  auto addPlot = [&](const nlohmann::json &common, const nlohmann::json &plot) {
     // Copy the common state and add a plot
     nlohmann::json state = common;
     state["plot"] = plot;
@@ -59,6 +66,7 @@ vector<Configuration> Configuration::getConfigurations(const std::string &Path)
     // Initialize and return configuration
     Configuration conf;
     conf.fromJsonObj(state);
+    conf.mName = fmt::format("{}.{}", Name, Configurations.size());
 
     return conf;
   };
@@ -88,6 +96,9 @@ void Configuration::fromJsonObj(const nlohmann::json &obj) {
   getKafkaConfig();
   getPlotConfig();
   getTOFConfig();
+  getSharedMemoryConfig();
+  getPulseConfig();
+  getCubeConfig();
   print();
 }
 
@@ -107,6 +118,9 @@ void Configuration::fromJsonFile(const std::string &fname) {
   getKafkaConfig();
   getPlotConfig();
   getTOFConfig();
+  getSharedMemoryConfig();
+  getPulseConfig();
+  getCubeConfig();
   print();
 }
 
@@ -116,6 +130,10 @@ void Configuration::getGeometryConfig() {
   mGeometry.YDim = getVal("geometry", "ydim", mGeometry.YDim, true);
   mGeometry.ZDim = getVal("geometry", "zdim", mGeometry.ZDim, true);
   mGeometry.Offset = getVal("geometry", "offset", mGeometry.Offset);
+  mGeometry.SparseOccupancy =
+      getVal("geometry", "sparse_occupancy", mGeometry.SparseOccupancy);
+  mGeometry.DisplayMapFile =
+      getVal("geometry", "display_map_file", mGeometry.DisplayMapFile);
 }
 
 void Configuration::getKafkaConfig() {
@@ -135,6 +153,8 @@ void Configuration::getKafkaConfig() {
       getVal("kafka", "enable.auto.commit", mKafka.EnableAutoCommit);
   mKafka.EnableAutoOffsetStore =
       getVal("kafka", "enable.auto.offset.store", mKafka.EnableAutoOffsetStore);
+  mKafka.BackfillSeconds =
+      getVal("kafka", "backfill_seconds", mKafka.BackfillSeconds);
 }
 
 void Configuration::getPlotConfig() {
@@ -149,6 +169,19 @@ void Configuration::getPlotConfig() {
   mPlot.InvertGradient = getVal("plot", "invert_gradient", mPlot.InvertGradient);
   mPlot.LogScale = getVal("plot", "log_scale", mPlot.LogScale);
   mPlot.Source = getVal("plot", "source", mPlot.Source);
+  mPlot.PersistentDirectory =
+      getVal("plot", "persistent_directory", mPlot.PersistentDirectory);
+  mPlot.WindowSeconds = getVal("plot", "window_seconds", mPlot.WindowSeconds);
+  mPlot.WindowSliceSeconds =
+      getVal("plot", "window_slice_seconds", mPlot.WindowSliceSeconds);
+  mPlot.RateChart = getVal("plot", "rate_chart", mPlot.RateChart);
+  mPlot.RefreshHz = getVal("plot", "refresh_hz", mPlot.RefreshHz);
+  mPlot.RefreshPriority =
+      getVal("plot", "refresh_priority", mPlot.RefreshPriority);
+  if (mPlot.RefreshHz < 0.0 or mPlot.RefreshHz > 100.0) {
+    fmt::print("plot refresh_hz must be between 0 and 100\n");
+    throw std::runtime_error("Daqlite config error");
+  }
 
   // Window options - all are optional
   mPlot.WindowTitle = getVal("plot", "window_title", mPlot.WindowTitle);
@@ -170,16 +203,108 @@ void Configuration::getTOFConfig() {
   mTOF.BinSize = getVal("tof", "bin_size", mTOF.BinSize);
   mTOF.AutoScaleX = getVal("tof", "auto_scale_x", mTOF.AutoScaleX);
   mTOF.AutoScaleY = getVal("tof", "auto_scale_y", mTOF.AutoScaleY);
+  mTOF.Binning = getVal("tof", "binning", mTOF.Binning);
+  mTOF.MinValue = getVal("tof", "min_value", mTOF.MinValue);
+  mTOF.FlightPathFile =
+      getVal("tof", "flight_path_file", mTOF.FlightPathFile);
+  mTOF.GateMin = getVal("tof", "gate_min", mTOF.GateMin);
+  mTOF.GateMax = getVal("tof", "gate_max", mTOF.GateMax);
+  makeTofBinEdges();
+}
+
+void Configuration::makeTofBinEdges() {
+  auto &Edges = mTOF.BinEdges;
+  Edges.clear();
+
+  if (mTOF.Binning == "uniform") {
+    return;
+  } else if (mTOF.Binning == "log") {
+    // bin_size bins of equal width in log(TOF) from min_value to max_value
+    if (mTOF.MinValue <= 0 or mTOF.MinValue >= mTOF.MaxValue or
+        mTOF.BinSize == 0) {
+      fmt::print("Log TOF binning needs 0 < min_value < max_value\n");
+      throw std::runtime_error("Daqlite config error");
+    }
+    const double Ratio = std::log(mTOF.MaxValue / mTOF.MinValue);
+    for (unsigned int i = 0; i <= mTOF.BinSize; i++) {
+      Edges.push_back(mTOF.MinValue * std::exp(Ratio * i / mTOF.BinSize));
+    }
+  } else if (mTOF.Binning == "piecewise") {
+    // segments: [[upper edge, bins], ...] starting from min_value
+    std::vector<std::pair<double, unsigned int>> Segments;
+    if (mJsonObj["tof"].contains("segments")) {
+      Segments = mJsonObj["tof"]["segments"];
+    }
+    Edges.push_back(mTOF.MinValue);
+    for (const auto &[Upper, Bins] : Segments) {
+      const double Lower = Edges.back();
+      for (unsigned int i = 1; i <= Bins; i++) {
+        Edges.push_back(Lower + (Upper - Lower) * i / Bins);
+      }
+    }
+  } else if (mTOF.Binning == "edges") {
+    if (mJsonObj["tof"].contains("bin_edges")) {
+      Edges = mJsonObj["tof"]["bin_edges"].get<std::vector<double>>();
+    }
+  } else {
+    fmt::print("Unknown TOF binning {}\n", mTOF.Binning);
+    throw std::runtime_error("Daqlite config error");
+  }
+
+  if (Edges.size() < 2 or
+      std::adjacent_find(Edges.begin(), Edges.end(), std::greater_equal<>()) !=
+          Edges.end()) {
+    fmt::print("TOF bin edges must be at least two increasing values\n");
+    throw std::runtime_error("Daqlite config error");
+  }
+
+  // The rest of daqlite only needs the number of bins and the TOF range,
+  // both unsigned int
+  constexpr double Limit = std::numeric_limits<unsigned int>::max();
+  if (Edges.front() < 0 or std::ceil(Edges.back()) > Limit or
+      Edges.size() - 1 > std::numeric_limits<unsigned int>::max()) {
+    fmt::print("TOF bin edges must be within [0, {}]\n", Limit);
+    throw std::runtime_error("Daqlite config error");
+  }
+  mTOF.BinSize = static_cast<unsigned int>(Edges.size() - 1);
+  mTOF.MaxValue = static_cast<unsigned int>(std::ceil(Edges.back()));
+}
+
+void Configuration::getSharedMemoryConfig() {
+  // Shared memory options - all are optional
+  mSharedMemory.Mode = getVal("shared_memory", "mode", mSharedMemory.Mode);
+  mSharedMemory.Name =
+      getVal("shared_memory", "name", "/daqlite_" + mKafka.Topic);
+}
+
+void Configuration::getPulseConfig() {
+  // Pulse options - all are optional
+  mPulse.RingSize = getVal("pulse", "ring_size", mPulse.RingSize);
+  mPulse.PixelBinning = getVal("pulse", "pixel_binning", mPulse.PixelBinning);
+}
+
+void Configuration::getCubeConfig() {
+  // Cube options - all are optional
+  mCube.MemoryMB = getVal("cube", "memory_mb", mCube.MemoryMB);
+  mCube.TofMin = getVal("cube", "tof_min", mCube.TofMin);
+  mCube.TofMax = getVal("cube", "tof_max", mCube.TofMax);
+  if (mCube.TofMax > 0 and mCube.TofMin > mCube.TofMax) {
+    fmt::print("cube tof_min must not be larger than tof_max\n");
+    throw std::runtime_error("Daqlite config error");
+  }
 }
 
 void Configuration::print() {
   fmt::print("[Kafka]\n");
   fmt::print("  Broker {}\n", mKafka.Broker);
   fmt::print("  Topic {}\n", mKafka.Topic);
+  fmt::print("  Backfill (s) {}\n", mKafka.BackfillSeconds);
   fmt::print("[Geometry]\n");
   fmt::print("  Dimensions ({}, {}, {})\n", mGeometry.XDim, mGeometry.YDim,
              mGeometry.ZDim);
   fmt::print("  Pixel Offset {}\n", mGeometry.Offset);
+  fmt::print("  Sparse occupancy {}\n", mGeometry.SparseOccupancy);
+  fmt::print("  Display map file {}\n", mGeometry.DisplayMapFile);
   fmt::print("[Plot]\n");
   fmt::print("  WindowTitle {}\n", mPlot.WindowTitle);
   fmt::print("  Plot type {}\n", mPlot.Plot.asString());
@@ -191,12 +316,44 @@ void Configuration::print() {
   fmt::print("  Log Scale {}\n", mPlot.LogScale);
   fmt::print("  PlotTitle {}\n", mPlot.PlotTitle);
   fmt::print("  X Axis {}\n", mPlot.XAxis);
+  fmt::print("  Persistent directory {}\n", mPlot.PersistentDirectory);
+  fmt::print("  Sliding window (s) {}\n", mPlot.WindowSeconds);
+  fmt::print("  Window slice (s) {}\n", mPlot.WindowSliceSeconds);
+  fmt::print("  Rate chart {}\n", mPlot.RateChart);
+  fmt::print("  Refresh rate (Hz) {}\n", mPlot.RefreshHz);
+  fmt::print("  Refresh priority {}\n", mPlot.RefreshPriority);
   fmt::print("[TOF]\n");
   fmt::print("  Scale {}\n", mTOF.Scale);
   fmt::print("  Max value {}\n", mTOF.MaxValue);
   fmt::print("  Bin size {}\n", mTOF.BinSize);
+  fmt::print("  Binning {}\n", mTOF.Binning);
+  fmt::print("  Flight path file {}\n", mTOF.FlightPathFile);
+  if (mTOF.GateMax > 0) {
+    fmt::print("  Pixel map gate {} - {}\n", mTOF.GateMin, mTOF.GateMax);
+  }
+  if (!mTOF.BinEdges.empty()) {
+    fmt::print("  Bin edges {} - {}\n", mTOF.BinEdges.front(),
+               mTOF.BinEdges.back());
+  }
   fmt::print("  Auto scale x {}\n", mTOF.AutoScaleX);
   fmt::print("  Auto scale y {}\n", mTOF.AutoScaleY);
+  if (!mSharedMemory.Mode.empty()) {
+    fmt::print("[Shared memory]\n");
+    fmt::print("  Mode {}\n", mSharedMemory.Mode);
+    fmt::print("  Name {}\n", mSharedMemory.Name);
+  }
+  if (mPlot.Plot == PlotType::PULSE_RATE) {
+    fmt::print("[Pulse]\n");
+    fmt::print("  Ring size {}\n", mPulse.RingSize);
+    fmt::print("  Pixel binning {}\n", mPulse.PixelBinning);
+  }
+  if (mCube.MemoryMB > 0) {
+    fmt::print("[Cube]\n");
+    fmt::print("  Memory budget (MB) {}\n", mCube.MemoryMB);
+  }
+  if (mCube.TofMax > 0) {
+    fmt::print("  Pixel map TOF window {} - {}\n", mCube.TofMin, mCube.TofMax);
+  }
 }
 
 //\brief getVal() template is used to effectively achieve
@@ -51,6 +51,19 @@ public:
   // get the TOF related config options
   void getTOFConfig();
 
+  // get the shared memory related config options
+  void getSharedMemoryConfig();
+
+  // get the pulse related config options
+  void getPulseConfig();
+
+  // get the pixel x TOF cube config options
+  void getCubeConfig();
+
+  /// \brief calculate mTOF.BinEdges for non-uniform TOF binning and update
+  /// BinSize and MaxValue to match the edges
+  void makeTofBinEdges();
+
   /// \brief prints the settings
   void print();
 
@@ -67,6 +80,12 @@ public:
     unsigned int BinSize{512};    // initial bin size
     bool AutoScaleX{true};
     bool AutoScaleY{true};
+    std::string Binning{"uniform"}; // uniform, log, piecewise or edges
+    double MinValue{0};             // first edge for log and piecewise
+    std::vector<double> BinEdges;   // empty for uniform binning
+    std::string FlightPathFile{""}; // per pixel L1 + L2, for wavelength
+    unsigned int GateMin{0};        // pixel maps only count events with
+    unsigned int GateMax{0};        // GateMin <= TOF <= GateMax, if set
   };
 
   struct GeometryOptions {
@@ -74,6 +93,8 @@ public:
     int YDim{1};
     int ZDim{1};
     int Offset{0};
+    double SparseOccupancy{0.1}; // pixel histograms become dense above this
+    std::string DisplayMapFile{""}; // pixel to display x, y, see DisplayMap.h
   };
 
   struct KafkaOptions {
@@ -85,6 +106,7 @@ public:
     std::string ReplicaFetchMaxBytes{"10000000"};
     std::string EnableAutoCommit{"false"};
     std::string EnableAutoOffsetStore{"false"};
+    uint32_t BackfillSeconds{0}; // replay this period of data on startup
   };
 
   struct PlotOptions {
@@ -99,16 +121,44 @@ public:
     std::string PlotTitle{""};
     std::string XAxis{""};
     std::string Source{Configuration::EMPTY_SOURCE};
+    std::string PersistentDirectory{""}; // keep histograms in files here
+    uint32_t WindowSeconds{0};        // sliding window, 0 for cumulative
+    double WindowSliceSeconds{1.0};   // window resolution
+    bool RateChart{false};            // show an event rate strip chart
+    double RefreshHz{0.0};            // plot updates/s, 0 with the consumer
+    int RefreshPriority{0};           // higher is updated first when due
 
     int Width{600};             // Default window width
     int Height{400};            // Default window height
     bool defaultGeometry{true}; // True if window geometries are default
   };
 
+  struct SharedMemoryOptions {
+    std::string Mode{""}; // "publish", "view" or empty for normal operation
+    std::string Name{""}; // POSIX shm name, defaults to "/daqlite_<topic>"
+  };
+
+  struct PulseOptions {
+    uint32_t RingSize{1000};  // number of pulses kept
+    uint32_t PixelBinning{0}; // coarse pixel map binning, 0 for no map
+  };
+
+  struct CubeOptions {
+    uint32_t MemoryMB{0}; // pixel x TOF cube memory budget, 0 for no cube
+    unsigned int TofMin{0}; // pixel plots show the cube events with
+    unsigned int TofMax{0}; // TofMin <= TOF <= TofMax instead, if set
+  };
+
   struct TOFOptions mTOF;
   struct GeometryOptions mGeometry;
   struct KafkaOptions mKafka;
   struct PlotOptions mPlot;
+  struct SharedMemoryOptions mSharedMemory;
+  struct PulseOptions mPulse;
+  struct CubeOptions mCube;
+
+  /// \brief Identifies the plot, made from the file name and plot index
+  std::string mName{""};
 
   std::string mKafkaConfigFile{""};
   std::vector<std::pair<std::string, std::string>> mKafkaConfig;
@@ -0,0 +1,85 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file DisplayMap.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <DisplayMap.h>
+
+#include <fmt/format.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+constexpr char MAGIC[8] = {'D', 'A', 'Q', 'L', 'M', 'A', 'P', '1'};
+
+struct Header {
+  char Magic[8];
+  uint32_t Pixels;
+  uint32_t Width;
+  uint32_t Height;
+  uint32_t Reserved;
+};
+
+struct Entry {
+  int32_t X;
+  int32_t Y;
+};
+} // namespace
+
+DisplayMap::DisplayMap(const std::string &FileName) {
+  const int Fd = open(FileName.c_str(), O_RDONLY);
+  if (Fd < 0) {
+    throw std::runtime_error(fmt::format("Unable to open display map {}: {}",
+                                         FileName, strerror(errno)));
+  }
+
+  struct stat Stat{};
+  if (fstat(Fd, &Stat) != 0 or Stat.st_size < (off_t)sizeof(Header)) {
+    close(Fd);
+    throw std::runtime_error(
+        fmt::format("Display map {} is too short", FileName));
+  }
+
+  void *Mapping = mmap(nullptr, Stat.st_size, PROT_READ, MAP_PRIVATE, Fd, 0);
+  close(Fd);
+  if (Mapping == MAP_FAILED) {
+    throw std::runtime_error(fmt::format("Unable to map display map {}: {}",
+                                         FileName, strerror(errno)));
+  }
+
+  Header Hdr;
+  memcpy(&Hdr, Mapping, sizeof(Header));
+  const bool Valid =
+      memcmp(Hdr.Magic, MAGIC, sizeof(MAGIC)) == 0 and
+      (size_t)Stat.st_size >= sizeof(Header) + Hdr.Pixels * sizeof(Entry) and
+      uint64_t(Hdr.Width) * Hdr.Height < NO_CELL;
+  if (not Valid) {
+    munmap(Mapping, Stat.st_size);
+    throw std::runtime_error(
+        fmt::format("{} is not a valid display map", FileName));
+  }
+
+  // Compile the x, y pairs into cell indexes, pixel ids start from 1
+  mWidth = Hdr.Width;
+  mHeight = Hdr.Height;
+  mCells.assign(size_t(Hdr.Pixels) + 1, NO_CELL);
+  const auto *Entries = reinterpret_cast<const Entry *>(
+      static_cast<const char *>(Mapping) + sizeof(Header));
+  for (uint32_t i = 0; i < Hdr.Pixels; i++) {
+    const int32_t X = Entries[i].X;
+    const int32_t Y = Entries[i].Y;
+    if (X >= 0 and Y >= 0 and uint32_t(X) < mWidth and uint32_t(Y) < mHeight) {
+      mCells[i + 1] = uint32_t(Y) * mWidth + X;
+    }
+  }
+
+  munmap(Mapping, Stat.st_size);
+}
@@ -0,0 +1,57 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file DisplayMap.h
+///
+/// \brief Pixel to display cell lookup table for non-grid layouts
+///
+/// By default pixel maps show the logical x, y grid of ESSGeometry. Tube
+/// based instruments are easier to read in a layout of their own, which is
+/// loaded from a binary file (geometry.display_map_file):
+///
+///     char     Magic[8]   "DAQLMAP1"
+///     uint32_t Pixels     number of pixels, starting from pixel 1
+///     uint32_t Width      display columns
+///     uint32_t Height     display rows
+///     uint32_t Reserved
+///     int32_t  X, Y       for each pixel, -1 if the pixel is not shown
+///
+/// in host byte order. The file is mapped and compiled once into a flat table
+/// of display cell indexes, so plotting a pixel through the map is a single
+/// lookup, as it is for the native grid. Several pixels may share a cell.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class DisplayMap {
+public:
+  /// \brief Marks pixels which are not shown
+  static constexpr uint32_t NO_CELL{UINT32_MAX};
+
+  /// \brief Load a mapping file, throws std::runtime_error if the file can
+  /// not be read or is malformed
+  explicit DisplayMap(const std::string &FileName);
+
+  /// \return display cell (Y * width + X) of a pixel, or NO_CELL
+  inline uint32_t cell(uint32_t Pixel) const {
+    return Pixel < mCells.size() ? mCells[Pixel] : NO_CELL;
+  }
+
+  uint32_t width() const { return mWidth; }
+  uint32_t height() const { return mHeight; }
+
+  /// \return number of pixel ids covered by the table, including pixel 0
+  size_t size() const { return mCells.size(); }
+
+private:
+  /// \brief Cell of each pixel id, pixel 0 is never shown
+  std::vector<uint32_t> mCells;
+
+  uint32_t mWidth{0};
+  uint32_t mHeight{0};
+};
@@ -8,6 +8,7 @@
 #include <ESSConsumer.h>
 
 #include <Configuration.h>
+#include <SharedHistograms.h>
 #include <ThreadSafeVector.h>
 #include <types/PlotType.h>
 
@@ -18,22 +19,188 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <fmt/format.h>
+#include <limits>
 #include <memory>
 #include <stdlib.h>
 #include <sys/types.h>
+#include <type_traits>
 #include <unistd.h>
 #include <vector>
 
 using std::string;
 using std::vector;
 
+namespace {
+/// \brief Typed view of the values of a da00 variable inside the flat buffer.
+/// Values are loaded with memcpy, as the data has no alignment guarantee.
+template <typename T> struct Da00Values {
+  const uint8_t *Data;
+  size_t Size;
+
+  size_t size() const { return Size; }
+
+  T operator[](size_t Index) const {
+    T Value;
+    memcpy(&Value, Data + Index * sizeof(T), sizeof(T));
+    return Value;
+  }
+};
+
+/// \brief da00 values as histogram counts. Values are clamped to the uint32_t
+/// range, NaN counts as zero and floating point values are rounded.
+template <typename View> struct Da00Counts {
+  View Values;
+
+  size_t size() const { return Values.size(); }
+
+  uint32_t operator[](size_t Index) const {
+    constexpr uint32_t Max{std::numeric_limits<uint32_t>::max()};
+    const auto Value = Values[Index];
+    if constexpr (std::is_floating_point_v<decltype(Value)>) {
+      // Comparisons with NaN are false, so it ends up as zero
+      const double Rounded = static_cast<double>(Value) + 0.5;
+      if (not(Rounded >= 1.0)) {
+        return 0;
+      }
+      return Rounded >= static_cast<double>(Max) ? Max
+                                                 : static_cast<uint32_t>(Rounded);
+    } else if constexpr (std::is_signed_v<decltype(Value)>) {
+      return Value > 0 ? static_cast<uint32_t>(std::min<int64_t>(Value, Max))
+                       : 0;
+    } else {
+      return static_cast<uint32_t>(std::min<uint64_t>(Value, Max));
+    }
+  }
+};
+
+/// \return number of values of a da00 variable, limited by its data size
+size_t da00Size(const da00_Variable &Variable);
+
+/// \brief Call Fn with a Da00Values view of the right type for the variable.
+/// \return false for non numeric types
+template <typename Function>
+bool visitDa00(const da00_Variable &Variable, Function &&Fn) {
+  const uint8_t *Data = Variable.data()->Data();
+  const size_t Size = da00Size(Variable);
+
+  switch (Variable.data_type()) {
+  case da00_dtype::int8:
+    Fn(Da00Values<int8_t>{Data, Size});
+    return true;
+  case da00_dtype::uint8:
+    Fn(Da00Values<uint8_t>{Data, Size});
+    return true;
+  case da00_dtype::int16:
+    Fn(Da00Values<int16_t>{Data, Size});
+    return true;
+  case da00_dtype::uint16:
+    Fn(Da00Values<uint16_t>{Data, Size});
+    return true;
+  case da00_dtype::int32:
+    Fn(Da00Values<int32_t>{Data, Size});
+    return true;
+  case da00_dtype::uint32:
+    Fn(Da00Values<uint32_t>{Data, Size});
+    return true;
+  case da00_dtype::int64:
+    Fn(Da00Values<int64_t>{Data, Size});
+    return true;
+  case da00_dtype::uint64:
+    Fn(Da00Values<uint64_t>{Data, Size});
+    return true;
+  case da00_dtype::float32:
+    Fn(Da00Values<float>{Data, Size});
+    return true;
+  case da00_dtype::float64:
+    Fn(Da00Values<double>{Data, Size});
+    return true;
+  default:
+    return false;
+  }
+}
+
+size_t da00Size(const da00_Variable &Variable) {
+  size_t Width{0};
+  switch (Variable.data_type()) {
+  case da00_dtype::int8:
+  case da00_dtype::uint8:
+    Width = 1;
+    break;
+  case da00_dtype::int16:
+  case da00_dtype::uint16:
+    Width = 2;
+    break;
+  case da00_dtype::int32:
+  case da00_dtype::uint32:
+  case da00_dtype::float32:
+    Width = 4;
+    break;
+  case da00_dtype::int64:
+  case da00_dtype::uint64:
+  case da00_dtype::float64:
+    Width = 8;
+    break;
+  default:
+    return 0;
+  }
+
+  if (Variable.data() == nullptr or Variable.shape() == nullptr or
+      Variable.shape()->size() == 0) {
+    return 0;
+  }
+
+  const int64_t Shape = Variable.shape()->Get(0);
+  const size_t Available = Variable.data()->size() / Width;
+  return Shape > 0 ? std::min<size_t>(Shape, Available) : 0;
+}
+
+/// \brief FNV-1a hash of a byte range
+uint64_t fnv1a(const uint8_t *Data, size_t Size, uint64_t Seed) {
+  uint64_t Hash = 0xcbf29ce484222325ULL ^ Seed;
+  for (size_t i = 0; i < Size; i++) {
+    Hash = (Hash ^ Data[i]) * 0x100000001b3ULL;
+  }
+  return Hash;
+}
+
+/// \brief Add values element-wise, growing Result if needed
+void addValues(vector<uint32_t> &Result, const vector<uint32_t> &Values) {
+  if (Result.empty()) {
+    Result = Values;
+    return;
+  }
+  if (Values.size() > Result.size()) {
+    Result.resize(Values.size(), 0);
+  }
+  for (size_t i = 0; i < Values.size(); i++) {
+    Result[i] += Values[i];
+  }
+}
+
+/// \brief Move the non-empty containers of all sources into an epoch
+void sealData(ESSConsumer::TSVectorMap &Open,
+              std::map<std::string, vector<uint32_t>> &Sealed) {
+  for (auto &[key, data] : Open) {
+    if (vector<uint32_t> Values = data.take(); not Values.empty()) {
+      Sealed.emplace(key, std::move(Values));
+    }
+  }
+}
+} // namespace
+
 // clang-format off
 ESSConsumer::ESSConsumer(Configuration &Config,
                          vector<std::pair<string, string>> &KafkaConfig)
     : mConfig(Config)
+    , mPulses(Config)
+    , mTofBinner(Config)
+    , mCube(Config)
+    , mWavelength(Config)
     , mKafkaConfig(KafkaConfig) {
   auto &geom = mConfig.mGeometry;
   mNumPixels = geom.XDim * geom.YDim * geom.ZDim;
@@ -42,8 +209,15 @@ ESSConsumer::ESSConsumer(Configuration &Config,
   assert(mMaxPixel != 0);
   assert(mMinPixel < mMaxPixel);
 
-  mConsumer = subscribeTopic();
-  assert(mConsumer != nullptr);
+  // A shared memory viewer gets its data from a publishing daqlite instance
+  if (mConfig.mSharedMemory.Mode != SharedHistograms::VIEW) {
+    if (mConfig.mKafka.BackfillSeconds > 0) {
+      mConsumer = assignBackfill();
+    } else {
+      mConsumer = subscribeTopic();
+    }
+    assert(mConsumer != nullptr);
+  }
 
   const auto types = {
     DataType::NONE, 
@@ -51,16 +225,25 @@ ESSConsumer::ESSConsumer(Configuration &Config,
     DataType::TOF, 
     DataType::HISTOGRAM,
     DataType::HISTOGRAM_TOF, 
-    DataType::PIXEL_ID
+    DataType::PIXEL_ID,
+    DataType::PULSE
   };
   for (DataType t : types) {
     mSubscriptionCount[t] = 0;
-    mDeliveryCount[t] = 0;
+  }
+
+  createData(std::string(Configuration::EMPTY_SOURCE));
+}
+
+ESSConsumer::~ESSConsumer() {
+  mStopBackfill = true;
+  for (auto &Thread : mBackfillThreads) {
+    Thread.join();
   }
 }
 // clang-format on
 
-RdKafka::KafkaConsumer *ESSConsumer::subscribeTopic() const {
+RdKafka::KafkaConsumer *ESSConsumer::createConsumer() const {
   auto mConf = RdKafka::Conf::create(RdKafka::Conf::CONF_GLOBAL);
 
   if (!mConf) {
@@ -92,8 +275,16 @@ RdKafka::KafkaConsumer *ESSConsumer::subscribeTopic() const {
     fmt::print("Failed to create consumer: {}\n", ErrStr);
     return nullptr;
   }
-  //
-  // // Start consumer for topic+partition at start offset
+
+  return ret;
+}
+
+RdKafka::KafkaConsumer *ESSConsumer::subscribeTopic() const {
+  auto ret = createConsumer();
+  if (!ret) {
+    return nullptr;
+  }
+
   RdKafka::ErrorCode resp = ret->subscribe({mConfig.mKafka.Topic});
   if (resp != RdKafka::ERR_NO_ERROR) {
     fmt::print("Failed to subscribe consumer to '{}': {}\n",
@@ -103,6 +294,179 @@ RdKafka::KafkaConsumer *ESSConsumer::subscribeTopic() const {
   return ret;
 }
 
+RdKafka::KafkaConsumer *ESSConsumer::assignBackfill() {
+  auto ret = createConsumer();
+  if (!ret) {
+    return nullptr;
+  }
+
+  // Find all partitions of the topic
+  const string &Topic = mConfig.mKafka.Topic;
+  vector<int32_t> Partitions;
+  RdKafka::Metadata *Metadata{nullptr};
+  RdKafka::ErrorCode resp =
+      ret->metadata(true, nullptr, &Metadata, BACKFILL_TIMEOUT_MS);
+  if (resp == RdKafka::ERR_NO_ERROR) {
+    for (const auto *TopicMetadata : *Metadata->topics()) {
+      if (TopicMetadata->topic() != Topic) {
+        continue;
+      }
+      for (const auto *PartitionMetadata : *TopicMetadata->partitions()) {
+        Partitions.push_back(PartitionMetadata->id());
+      }
+    }
+  }
+  delete Metadata;
+
+  if (Partitions.empty()) {
+    fmt::print("No partitions found for '{}' ({}), skipping backfill\n", Topic,
+               err2str(resp));
+    resp = ret->subscribe({Topic});
+    if (resp != RdKafka::ERR_NO_ERROR) {
+      fmt::print("Failed to subscribe consumer to '{}': {}\n", Topic,
+                 err2str(resp));
+    }
+    return ret;
+  }
+
+  // Look up the first offset at or after the backfill start time
+  const int64_t StartMS =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count() -
+      1000LL * mConfig.mKafka.BackfillSeconds;
+
+  vector<RdKafka::TopicPartition *> Offsets;
+  for (int32_t Partition : Partitions) {
+    Offsets.push_back(RdKafka::TopicPartition::create(Topic, Partition, StartMS));
+  }
+  resp = ret->offsetsForTimes(Offsets, BACKFILL_TIMEOUT_MS);
+  if (resp != RdKafka::ERR_NO_ERROR) {
+    fmt::print("Failed to get backfill offsets for '{}': {}\n", Topic,
+               err2str(resp));
+  }
+
+  // Backfill from there up to the current end of each partition, where live
+  // consumption takes over so no message is processed twice
+  vector<RdKafka::TopicPartition *> Live;
+  for (const auto *Offset : Offsets) {
+    int64_t Low{0};
+    int64_t High{RdKafka::Topic::OFFSET_END};
+    if (ret->query_watermark_offsets(Topic, Offset->partition(), &Low, &High,
+                                     BACKFILL_TIMEOUT_MS) !=
+        RdKafka::ERR_NO_ERROR) {
+      High = RdKafka::Topic::OFFSET_END;
+    }
+
+    const int64_t Start = (resp == RdKafka::ERR_NO_ERROR and Offset->offset() >= 0)
+                              ? std::max(Offset->offset(), Low)
+                              : High;
+    if (High >= 0 and Start < High) {
+      mBackfillRanges.push_back({Offset->partition(), Start, High});
+      mBackfillTotal += High - Start;
+    }
+
+    Live.push_back(
+        RdKafka::TopicPartition::create(Topic, Offset->partition(), High));
+  }
+
+  resp = ret->assign(Live);
+  if (resp != RdKafka::ERR_NO_ERROR) {
+    fmt::print("Failed to assign consumer to '{}': {}\n", Topic,
+               err2str(resp));
+  }
+
+  fmt::print("Backfilling {} messages from {} partitions of '{}'\n",
+             mBackfillTotal.load(), mBackfillRanges.size(), Topic);
+
+  RdKafka::TopicPartition::destroy(Offsets);
+  RdKafka::TopicPartition::destroy(Live);
+
+  return ret;
+}
+
+void ESSConsumer::startBackfill() {
+  const size_t Cores = std::max(1u, std::thread::hardware_concurrency());
+  const size_t Readers =
+      std::min({mBackfillRanges.size(), Cores, BACKFILL_READERS});
+  mBackfillRunning = Readers;
+  for (size_t i = 0; i < Readers; i++) {
+    mBackfillThreads.emplace_back(&ESSConsumer::backfillRanges, this);
+  }
+}
+
+double ESSConsumer::getBackfillProgress() const {
+  const int64_t Total = mBackfillTotal;
+  if (Total == 0 or mBackfillRunning == 0) {
+    return 1.0;
+  }
+
+  return std::min(1.0, static_cast<double>(mBackfillDone) / Total);
+}
+
+void ESSConsumer::backfillRanges() {
+  std::unique_ptr<RdKafka::KafkaConsumer> Consumer(createConsumer());
+
+  for (size_t i = mBackfillNext++; i < mBackfillRanges.size();
+       i = mBackfillNext++) {
+    const auto &Range = mBackfillRanges[i];
+    if (Consumer) {
+      backfillPartition(*Consumer, Range);
+    } else {
+      // Account for the skipped range, so progress ends at 100%
+      mBackfillDone += Range.End - Range.Start;
+    }
+  }
+
+  if (Consumer) {
+    Consumer->close();
+  }
+  mBackfillRunning--;
+}
+
+void ESSConsumer::backfillPartition(RdKafka::KafkaConsumer &Consumer,
+                                    BackfillRange Range) {
+  int64_t Offset = Range.Start;
+
+  std::unique_ptr<RdKafka::TopicPartition> Partition(
+      RdKafka::TopicPartition::create(mConfig.mKafka.Topic, Range.Partition,
+                                      Range.Start));
+  Consumer.assign({Partition.get()});
+
+  // Messages may be missing near the end (e.g. transaction markers), so
+  // give up after a few consecutive timeouts
+  int Timeouts{0};
+  while (not mStopBackfill and Offset < Range.End and
+         Timeouts < BACKFILL_MAX_TIMEOUTS) {
+    std::unique_ptr<RdKafka::Message> Msg(Consumer.consume(1000));
+
+    if (Msg->err() == RdKafka::ERR__TIMED_OUT) {
+      Timeouts++;
+      continue;
+    }
+    Timeouts = 0;
+
+    if (Msg->err() != RdKafka::ERR_NO_ERROR) {
+      handleMessage(Msg.get());
+      break;
+    }
+
+    // Live consumption takes over at the end offset
+    if (Msg->offset() >= Range.End) {
+      break;
+    }
+
+    handleMessage(Msg.get());
+    mBackfillDone += Msg->offset() + 1 - Offset;
+    Offset = Msg->offset() + 1;
+  }
+
+  Consumer.unassign();
+
+  // Account for anything skipped, so progress ends at 100%
+  mBackfillDone += std::max<int64_t>(0, Range.End - Offset);
+}
+
 uint32_t ESSConsumer::processEV44Data(RdKafka::Message *Msg) {
   auto EvMsg = GetEvent44Message(Msg->payload());
   auto PixelIds = EvMsg->pixel_id();
@@ -122,45 +486,127 @@ uint32_t ESSConsumer::processEV44Data(RdKafka::Message *Msg) {
     return 0;
   }
 
-  // local temporary histograms to avoid locking during processing
-  vector<uint32_t> PixelVector(mNumPixels, 0);
+  // local temporary histograms to avoid locking during processing. The pixel
+  // histogram only holds the pixels touched by this message unless they
+  // exceed the configured occupancy.
+  AdaptiveHistogram PixelHistogram(mNumPixels + 1,
+                                   mConfig.mGeometry.SparseOccupancy);
   vector<uint32_t> TofBinVector(mConfig.mTOF.BinSize, 0);
+  const bool KeepEvents = mSubscriptionCount.at(DataType::PIXEL_ID) > 0;
+  vector<uint32_t> EventPixels;
+  vector<uint32_t> EventTofBins;
+  uint64_t Accept{0};
+  uint64_t Discard{0};
+
+  // Group events by pulse if anyone is going to read them. Pulse k starts at
+  // event reference_time_index[k].
+  const auto RefTimes = EvMsg->reference_time();
+  const auto RefIndexes = EvMsg->reference_time_index();
+  const bool KeepPulses = mSubscriptionCount.at(DataType::PULSE) > 0 and
+                          RefTimes != nullptr and RefIndexes != nullptr and
+                          RefTimes->size() > 0 and
+                          RefTimes->size() == RefIndexes->size();
+  vector<PulseSummary> Pulses;
+
+  // Regions of interest drawn on a pixel map of this source. The TOF
+  // histograms of all regions are kept in one local array.
+  const auto Rois = roiMask(source);
+  const uint32_t RoiCount = Rois ? 32 - __builtin_clz(Rois->Used) : 0;
+  vector<uint32_t> RoiTofs(RoiCount * mTofBinner.bins(), 0);
+
+  // Events for the pixel x TOF cube, added under one lock after the loop
+  const bool KeepCube = mCube.enabled() and mCube.accepts(source);
+  vector<uint32_t> CubePixels;
+  vector<uint32_t> CubeTofBins;
+
+  // Wavelengths of all events, in one vectorized pass before the event loop
+  const bool Convert = mWavelength.enabled();
+  vector<uint32_t> Wavelengths;
+  if (Convert) {
+    mWavelength.convert(PixelIds->data(), TOFs->data(), PixelIds->size(),
+                        Wavelengths);
+  }
+  const bool Gated = mConfig.mTOF.GateMax > 0;
+
+  size_t PulseIndex{0};
+  if (KeepPulses) {
+    for (uint k = 0; k < RefTimes->size(); k++) {
+      Pulses.push_back(mPulses.makeSummary((*RefTimes)[k]));
+    }
+  }
 
   for (uint i = 0; i < PixelIds->size(); i++) {
     uint32_t Pixel = (*PixelIds)[i];
-    uint32_t Tof = (*TOFs)[i] / mConfig.mTOF.Scale; // ns to us
-
-    // accumulate events for 2D TOF
-    uint32_t TofBin = std::min(Tof, mConfig.mTOF.MaxValue) *
-                      (mConfig.mTOF.BinSize - 1) / mConfig.mTOF.MaxValue;
-    mPixelIDs[source].push_back(Pixel);
-    mTOFs[source].push_back(TofBin);
+    uint32_t Tof = Convert ? Wavelengths[i]
+                           : (*TOFs)[i] / mConfig.mTOF.Scale; // ns to us
+
+    // accumulate events for 2D TOF, if anyone is going to read them
+    if (KeepEvents) {
+      uint32_t TofBin = mTofBinner.valueToBin(Tof);
+      EventPixels.push_back(Pixel);
+      EventTofBins.push_back(TofBin);
+    }
 
     if ((Pixel > mMaxPixel) or (Pixel < mMinPixel)) {
-      mEventDiscard++;
+      Discard++;
     } else {
-      mEventAccept++;
+      Accept++;
 
       Pixel = Pixel - mConfig.mGeometry.Offset;
-      PixelVector[Pixel]++;
+      if (not Gated or (Tof >= mConfig.mTOF.GateMin and
+                        Tof <= mConfig.mTOF.GateMax)) {
+        PixelHistogram.add(Pixel);
+      }
 
-      Tof = std::min(Tof, mConfig.mTOF.MaxValue);
-      TofBinVector[Tof * (mConfig.mTOF.BinSize - 1) / mConfig.mTOF.MaxValue]++;
+      const uint32_t TofBin = mTofBinner.valueToBin(Tof);
+      TofBinVector[TofBin]++;
+      if (Rois) {
+        addRoiTof(*Rois, Pixel, TofBin, RoiTofs);
+      }
+      if (KeepCube) {
+        CubePixels.push_back(Pixel);
+        CubeTofBins.push_back(TofBin);
+      }
+
+      if (KeepPulses) {
+        while (PulseIndex + 1 < Pulses.size() and
+               i >= (uint)(*RefIndexes)[PulseIndex + 1]) {
+          PulseIndex++;
+        }
+        PulseSummary &Pulse = Pulses[PulseIndex];
+        Pulse.Events++;
+        Pulse.Tof[TofBin]++;
+        if (mPulses.hasPixels()) {
+          Pulse.Pixels.add(mPulses.coarsePixel(Pixel));
+        }
+      }
     }
   }
 
   // update thread safe histograms storage with new data
-  mHistograms[source].add_values(PixelVector);
-  mHistogramTOFs[source].add_values(TofBinVector);
+  mHistograms.at(source).merge(PixelHistogram);
+  mHistogramTOFs.at(source).add_values(TofBinVector);
+  if (KeepEvents) {
+    addEvents(source, EventPixels, EventTofBins);
+  }
+  if (Rois) {
+    addRoiTofs(source, *Rois, RoiTofs);
+  }
+  if (KeepCube) {
+    mCube.add(CubePixels, CubeTofBins);
+  }
+  for (const auto &Pulse : Pulses) {
+    mPulses.add(Pulse);
+  }
 
-  mEventCount += PixelIds->size();
+  mStatistics.add(PixelIds->size(), Accept, Discard);
 
   return PixelIds->size();
 }
 
 uint32_t ESSConsumer::processDA00Data(RdKafka::Message *Msg) {
   auto EvMsg = Getda00_DataArray(Msg->payload());
-  if (EvMsg->data()->size() == 0) {
+  if (EvMsg->data()->size() < 2) {
     return 0;
   }
 
@@ -177,29 +623,59 @@ uint32_t ESSConsumer::processDA00Data(RdKafka::Message *Msg) {
   const auto TimeBinsVariable = EvMsg->data()->Get(0);
   const auto DataBinsVariable = EvMsg->data()->Get(1);
 
-  auto BinEdges = getDataVector(*TimeBinsVariable);
-  auto DataBins = getDataVector(*DataBinsVariable);
-
   // Bin edges has one plus element to describe last edge compared to the data
   // which has as many elements as bins
-  if (BinEdges.size() != DataBins.size() + 1) {
-    mEventDiscard++;
+  const size_t Bins = da00Size(*DataBinsVariable);
+  if (Bins == 0 or da00Size(*TimeBinsVariable) != Bins + 1) {
+    mStatistics.add(0, 0, 1);
     return 0;
   }
 
-  int64_t MaxTime = *std::max_element(BinEdges.begin(), BinEdges.end());
-
-  if (MaxTime / mConfig.mTOF.Scale > mConfig.mTOF.MaxValue) {
+  if (not updateBinEdges(source, *TimeBinsVariable)) {
     return 0;
   }
 
-  mHistograms[source].add_values(DataBins);
-  mTOFs[source] = BinEdges;
+  // Add the counts straight from the flat buffer
+  auto &Histogram = mHistograms.at(source);
+  visitDa00(*DataBinsVariable, [&Histogram](const auto &Values) {
+    Histogram.add_values(Da00Counts<std::decay_t<decltype(Values)>>{Values});
+  });
 
-  mEventCount++;
-  mEventAccept++;
+  mStatistics.add(1, 1, 0);
 
-  return mHistograms[source].size();
+  return Bins;
+}
+
+bool ESSConsumer::updateBinEdges(const std::string &source,
+                                 const da00_Variable &Edges) {
+  const auto *Bytes = Edges.data();
+  const uint64_t Hash = fnv1a(Bytes->Data(), Bytes->size(),
+                              static_cast<uint64_t>(Edges.data_type()));
+
+  std::lock_guard<std::mutex> lock(mBinEdgesMutex);
+  BinEdgeCache &Cache = mBinEdgeCache[source];
+  if (Cache.Valid and Cache.Hash == Hash) {
+    return Cache.Accepted;
+  }
+
+  // The edges changed, convert and check them once
+  vector<double> Values;
+  visitDa00(Edges, [&Values](const auto &View) {
+    Values.resize(View.size());
+    for (size_t i = 0; i < View.size(); i++) {
+      Values[i] = static_cast<double>(View[i]);
+    }
+  });
+
+  const double MaxTime = *std::max_element(Values.begin(), Values.end());
+  Cache.Hash = Hash;
+  Cache.Valid = true;
+  Cache.Accepted = MaxTime / mConfig.mTOF.Scale <= mConfig.mTOF.MaxValue;
+  if (Cache.Accepted) {
+    mBinEdges[source] = std::move(Values);
+  }
+
+  return Cache.Accepted;
 }
 
 uint32_t ESSConsumer::processEV42Data(RdKafka::Message *Msg) {
@@ -221,34 +697,80 @@ uint32_t ESSConsumer::processEV42Data(RdKafka::Message *Msg) {
     return 0;
   }
 
-  vector<uint32_t> PixelVector(mNumPixels, 0);
+  AdaptiveHistogram PixelHistogram(mNumPixels + 1,
+                                   mConfig.mGeometry.SparseOccupancy);
   vector<uint32_t> TofBinVector(mConfig.mTOF.BinSize, 0);
+  const bool KeepEvents = mSubscriptionCount.at(DataType::PIXEL_ID) > 0;
+  vector<uint32_t> EventPixels;
+  vector<uint32_t> EventTofBins;
+  uint64_t Accept{0};
+  uint64_t Discard{0};
+
+  const auto Rois = roiMask(source);
+  const uint32_t RoiCount = Rois ? 32 - __builtin_clz(Rois->Used) : 0;
+  vector<uint32_t> RoiTofs(RoiCount * mTofBinner.bins(), 0);
+
+  // Events for the pixel x TOF cube, added under one lock after the loop
+  const bool KeepCube = mCube.enabled() and mCube.accepts(source);
+  vector<uint32_t> CubePixels;
+  vector<uint32_t> CubeTofBins;
+
+  // Wavelengths of all events, in one vectorized pass before the event loop
+  const bool Convert = mWavelength.enabled();
+  vector<uint32_t> Wavelengths;
+  if (Convert) {
+    mWavelength.convert(PixelIds->data(), TOFs->data(), PixelIds->size(),
+                        Wavelengths);
+  }
+  const bool Gated = mConfig.mTOF.GateMax > 0;
 
   for (uint i = 0; i < PixelIds->size(); i++) {
     uint32_t Pixel = (*PixelIds)[i];
-    uint32_t Tof = (*TOFs)[i] / mConfig.mTOF.Scale; // ns to us
-
-    // accumulate events for 2D TOF
-    uint32_t TofBin = std::min(Tof, mConfig.mTOF.MaxValue) *
-                      (mConfig.mTOF.BinSize - 1) / mConfig.mTOF.MaxValue;
-    mPixelIDs[source].push_back(Pixel);
-    mTOFs[source].push_back(TofBin);
+    uint32_t Tof = Convert ? Wavelengths[i]
+                           : (*TOFs)[i] / mConfig.mTOF.Scale; // ns to us
+
+    // accumulate events for 2D TOF, if anyone is going to read them
+    if (KeepEvents) {
+      uint32_t TofBin = mTofBinner.valueToBin(Tof);
+      EventPixels.push_back(Pixel);
+      EventTofBins.push_back(TofBin);
+    }
 
     if ((Pixel > mMaxPixel) or (Pixel < mMinPixel)) {
-      mEventDiscard++;
+      Discard++;
     } else {
-      mEventAccept++;
+      Accept++;
       Pixel = Pixel - mConfig.mGeometry.Offset;
-      PixelVector[Pixel]++;
-      Tof = std::min(Tof, mConfig.mTOF.MaxValue);
-      TofBinVector[Tof * (mConfig.mTOF.BinSize - 1) / mConfig.mTOF.MaxValue]++;
+      if (not Gated or (Tof >= mConfig.mTOF.GateMin and
+                        Tof <= mConfig.mTOF.GateMax)) {
+        PixelHistogram.add(Pixel);
+      }
+      const uint32_t TofBin = mTofBinner.valueToBin(Tof);
+      TofBinVector[TofBin]++;
+      if (Rois) {
+        addRoiTof(*Rois, Pixel, TofBin, RoiTofs);
+      }
+      if (KeepCube) {
+        CubePixels.push_back(Pixel);
+        CubeTofBins.push_back(TofBin);
+      }
     }
   }
 
-  mHistograms[source].add_values(PixelVector);
-  mHistogramTOFs[source].add_values(TofBinVector);
+  // update thread safe histograms storage with new data
+  mHistograms.at(source).merge(PixelHistogram);
+  mHistogramTOFs.at(source).add_values(TofBinVector);
+  if (KeepEvents) {
+    addEvents(source, EventPixels, EventTofBins);
+  }
+  if (Rois) {
+    addRoiTofs(source, *Rois, RoiTofs);
+  }
+  if (KeepCube) {
+    mCube.add(CubePixels, CubeTofBins);
+  }
 
-  mEventCount += PixelIds->size();
+  mStatistics.add(PixelIds->size(), Accept, Discard);
   return PixelIds->size();
 }
 
@@ -317,63 +839,17 @@ string ESSConsumer::randomGroupString(size_t length) {
   return str;
 }
 
-vector<int64_t>
-ESSConsumer::getDataVector(const da00_Variable &Variable) const {
-  vector<int64_t> Data;
-
-  auto data = Variable.unit()->str();
-  auto shape = Variable.shape()->Get(0);
-
-  switch (Variable.data_type()) {
-  case da00_dtype::int32: {
-    auto dataPtr = reinterpret_cast<const int32_t *>(Variable.data());
-
-    // skip the first element which is the length of the data
-    dataPtr++;
-    Data.assign(dataPtr, dataPtr + shape);
-    break;
-  }
-  case da00_dtype::int64: {
-    auto dataPtr = reinterpret_cast<const int64_t *>(Variable.data());
-
-    // skip the first element which is the length of the data
-    dataPtr++;
-    Data.assign(dataPtr, dataPtr + shape);
-    break;
-  }
-  case da00_dtype::uint32: {
-    auto dataPtr = reinterpret_cast<const uint32_t *>(Variable.data());
-
-    // skip the first element which is the length of the data
-    dataPtr++;
-    Data.assign(dataPtr, dataPtr + shape);
-    break;
-  }
-  case da00_dtype::uint64: {
-    auto dataPtr = reinterpret_cast<const uint64_t *>(Variable.data());
-
-    // skip the first element which is the length of the data
-    dataPtr++;
-    Data.assign(dataPtr, dataPtr + shape);
-    break;
-  }
-  default:
-    break;
-  }
-  return Data;
-}
-
 /// \todo is timeout reasonable?
 std::unique_ptr<RdKafka::Message> ESSConsumer::consume() {
+  if (mConsumer == nullptr) {
+    return nullptr;
+  }
   std::unique_ptr<RdKafka::Message> msg(mConsumer->consume(1000));
   return msg;
 }
 
 const ESSConsumer::TSVectorMap *ESSConsumer::getData(DataType dataType) const {
   switch (dataType) {
-  case DataType::HISTOGRAM:
-    return &mHistograms;
-
   case DataType::HISTOGRAM_TOF:
     return &mHistogramTOFs;
 
@@ -390,56 +866,153 @@ const ESSConsumer::TSVectorMap *ESSConsumer::getData(DataType dataType) const {
 }
 
 vector<uint32_t> ESSConsumer::readData(DataType dataType,
-                                       const std::string &source, bool reset) {
-  // Get non-const pointer to data container for the specified data type
-  TSVectorMap *dataMap = const_cast<TSVectorMap *>(getData(dataType));
+                                       const std::string &source,
+                                       int subscriber) {
+  if (dataType == DataType::HISTOGRAM) {
+    return readHistogram(source, subscriber).toDense();
+  }
 
-  // Check that data exists
-  if (dataMap == nullptr) {
+  if (getData(dataType) == nullptr) {
     return {};
   }
 
+  std::lock_guard<std::mutex> lock(mEpochMutex);
+  Subscriber *Reader = beginRead(subscriber, dataType);
+  if (Reader == nullptr) {
+    return {};
+  }
+
+  // Events are appended epoch after epoch, histograms are added
+  const bool Events =
+      dataType == DataType::PIXEL_ID or dataType == DataType::TOF;
+
   vector<uint32_t> result;
+  const uint64_t Seen = Reader->Seen[dataType];
+  for (auto &E : mEpochs) {
+    if (E.Version <= Seen) {
+      continue;
+    }
 
-  auto iter = dataMap->begin();
+    vector<uint32_t> EpochResult;
+    for (const auto &[key, data] : epochData(E, dataType)) {
+      // If no source is specified, combine data from all sources element-wise
+      if (source != Configuration::EMPTY_SOURCE and key != source) {
+        continue;
+      }
+      addValues(EpochResult, data);
+    }
 
-  // If a source is specified, get data for that source only
-  if (source != Configuration::EMPTY_SOURCE) {
-    // Check that data exists for the requested source
-    iter = dataMap->find(source);
-    if (iter == dataMap->cend()) {
-      return {};
+    if (result.empty()) {
+      result = std::move(EpochResult);
+    } else if (Events) {
+      result.insert(result.end(), EpochResult.begin(), EpochResult.end());
+    } else {
+      addValues(result, EpochResult);
     }
+  }
 
-    // Get data copy
-    result = iter->second;
-  } else {
-    // If no source is specified, combine data from all sources element-wise
-    // This adds values at the same index across all source vectors
-    for (const auto &[key, data] : *dataMap) {
-      if (result.empty()) {
-        result = data;
-      } else {
-        // Resize result if necessary to accommodate larger data
-        if (data.size() > result.size()) {
-          result.resize(data.size(), 0);
-        }
-        // Add values element-wise
-        for (size_t i = 0; i < data.size(); i++) {
-          result[i] += data[i];
-        }
+  Reader->Seen[dataType] = mVersion;
+  reclaimEpochs();
+
+  return result;
+}
+
+AdaptiveHistogram ESSConsumer::readHistogram(const std::string &source,
+                                             int subscriber) {
+  AdaptiveHistogram result(0, mConfig.mGeometry.SparseOccupancy);
+
+  std::lock_guard<std::mutex> lock(mEpochMutex);
+  Subscriber *Reader = beginRead(subscriber, DataType::HISTOGRAM);
+  if (Reader == nullptr) {
+    return result;
+  }
+
+  const uint64_t Seen = Reader->Seen[DataType::HISTOGRAM];
+  for (auto &E : mEpochs) {
+    if (E.Version <= Seen) {
+      continue;
+    }
+
+    // Without a source, combine the histograms of all sources
+    for (const auto &[key, data] : E.Histograms) {
+      if (source == Configuration::EMPTY_SOURCE or key == source) {
+        result.merge(data);
       }
     }
   }
 
-  // Clear data if reset is requested and all deliveries have been made
-  resetDataIfNeeded(dataMap, dataType, source, reset);
+  Reader->Seen[DataType::HISTOGRAM] = mVersion;
+  reclaimEpochs();
+
+  return result;
+}
+
+std::map<std::string, AdaptiveHistogram> ESSConsumer::takeHistograms() {
+  std::map<std::string, AdaptiveHistogram> result;
+  for (auto &[key, data] : mHistograms) {
+    result.emplace(key, data.take());
+  }
+
+  return result;
+}
+
+std::map<std::string, vector<uint32_t>>
+ESSConsumer::takeData(DataType dataType) {
+  std::map<std::string, vector<uint32_t>> result;
+  if (dataType == DataType::HISTOGRAM) {
+    for (auto &[key, data] : takeHistograms()) {
+      result[key] = data.toDense();
+    }
+    return result;
+  }
+
+  TSVectorMap *dataMap = const_cast<TSVectorMap *>(getData(dataType));
+  if (dataMap == nullptr) {
+    return result;
+  }
+
+  for (auto &[key, data] : *dataMap) {
+    result[key] = data.take();
+  }
 
   return result;
 }
 
+void ESSConsumer::addData(DataType dataType, const std::string &source,
+                          const vector<uint32_t> &data) {
+  // Apply the same source filtering as for consumed messages
+  if (!mSources.empty() && !hasSource(source)) {
+    return;
+  }
+
+  if (dataType == DataType::HISTOGRAM) {
+    if (mHistograms.find(source) == mHistograms.end()) {
+      createData(source);
+    }
+    mHistograms.at(source).add_values(data);
+    return;
+  }
+
+  TSVectorMap *dataMap = const_cast<TSVectorMap *>(getData(dataType));
+  if (dataMap == nullptr) {
+    return;
+  }
+
+  (*dataMap)[source].add_values(data);
+}
+
+void ESSConsumer::addEventCounts(uint64_t Count, uint64_t Accept,
+                                 uint64_t Discard) {
+  mStatistics.add(Count, Accept, Discard);
+}
+
 size_t ESSConsumer::getDataSize(DataType dataType,
                                 const std::string &source) const {
+  if (dataType == DataType::HISTOGRAM) {
+    const auto iter = mHistograms.find(source);
+    return (iter != mHistograms.cend()) ? iter->second.size() : 0;
+  }
+
   // Get pointer to data container for the specified data type
   const TSVectorMap *dataMap = getData(dataType);
 
@@ -455,11 +1028,160 @@ size_t ESSConsumer::getDataSize(DataType dataType,
 }
 
 size_t ESSConsumer::getBinSize(const std::string &source) const {
-  const size_t size = getDataSize(DataType::TOF, source);
+  std::lock_guard<std::mutex> lock(mBinEdgesMutex);
+  const auto iter = mBinEdges.find(source);
+  if (iter == mBinEdges.cend() or iter->second.empty()) {
+    return 0;
+  }
 
-  return size > 0 ? size - 1 : size;
+  return iter->second.size() - 1;
 };
 
+vector<double> ESSConsumer::readBinEdges(const std::string &source) const {
+  std::lock_guard<std::mutex> lock(mBinEdgesMutex);
+  const auto iter = mBinEdges.find(source);
+
+  return (iter != mBinEdges.cend()) ? iter->second : vector<double>{};
+}
+
+void ESSConsumer::setBinEdges(const std::string &source,
+                              const vector<double> &edges) {
+  std::lock_guard<std::mutex> lock(mBinEdgesMutex);
+  mBinEdges[source] = edges;
+}
+
+int ESSConsumer::addRoi(const std::string &Source,
+                        const vector<uint32_t> &Pixels) {
+  std::lock_guard<std::mutex> lock(mRoiMutex);
+
+  // Copy on write, the ingest threads keep using the old set until done
+  auto Rois = mRois ? std::make_shared<RoiSet>(*mRois)
+                    : std::make_shared<RoiSet>();
+  if (Rois->Used == ~0u) {
+    return -1;
+  }
+  const int Roi = __builtin_ctz(~Rois->Used);
+  Rois->Pixels[Roi] = Pixels;
+  Rois->Sources[Roi] = Source;
+  Rois->Used |= 1u << Roi;
+  buildRoiMasks(*Rois);
+
+  // Start the region with the counts it already has in the cube
+  mRoiTOFs[Roi].clear();
+  if (mCube.enabled() and mCube.source() == Source) {
+    mRoiTOFs[Roi] = mCube.tofSpectrum(Pixels);
+  }
+  std::atomic_store(&mRois, std::shared_ptr<const RoiSet>(Rois));
+  return Roi;
+}
+
+void ESSConsumer::removeRoi(int Roi) {
+  std::lock_guard<std::mutex> lock(mRoiMutex);
+  if (Roi < 0 or Roi >= MAX_ROIS or not mRois) {
+    return;
+  }
+
+  auto Rois = std::make_shared<RoiSet>(*mRois);
+  Rois->Pixels[Roi].clear();
+  Rois->Sources[Roi].clear();
+  Rois->Used &= ~(1u << Roi);
+  buildRoiMasks(*Rois);
+
+  mRoiTOFs[Roi].clear();
+  std::atomic_store(&mRois, Rois->Used != 0
+                                ? std::shared_ptr<const RoiSet>(Rois)
+                                : std::shared_ptr<const RoiSet>());
+}
+
+vector<uint32_t> ESSConsumer::readRoiTof(int Roi) {
+  if (Roi < 0 or Roi >= MAX_ROIS) {
+    return {};
+  }
+  return mRoiTOFs[Roi].take();
+}
+
+AdaptiveHistogram ESSConsumer::readCubePixelMap(const std::string &source,
+                                               uint32_t TofMin,
+                                               uint32_t TofMax) const {
+  if (not mCube.enabled() or mCube.source() != source) {
+    return AdaptiveHistogram();
+  }
+  return mCube.pixelMap(mTofBinner.valueToBin(TofMin),
+                        mTofBinner.valueToBin(TofMax));
+}
+
+void ESSConsumer::clearCube(const std::string &source) {
+  if (mCube.source() == source) {
+    mCube.clear();
+  }
+}
+
+void ESSConsumer::buildRoiMasks(RoiSet &Rois) const {
+  Rois.Masks.clear();
+  for (int Roi = 0; Roi < MAX_ROIS; Roi++) {
+    if (Rois.Used & (1u << Roi)) {
+      Rois.Masks[Rois.Sources[Roi]];
+    }
+  }
+
+  // Regions drawn on a map of all sources apply to every source
+  for (auto &[Source, Mask] : Rois.Masks) {
+    Mask.Bits.assign(mNumPixels + 1, 0);
+    for (int Roi = 0; Roi < MAX_ROIS; Roi++) {
+      if (not(Rois.Used & (1u << Roi)) or
+          (Rois.Sources[Roi] != Source and
+           Rois.Sources[Roi] != Configuration::EMPTY_SOURCE)) {
+        continue;
+      }
+      for (uint32_t Pixel : Rois.Pixels[Roi]) {
+        if (Pixel < Mask.Bits.size()) {
+          Mask.Bits[Pixel] |= 1u << Roi;
+        }
+      }
+      Mask.Used |= 1u << Roi;
+    }
+  }
+}
+
+const ESSConsumer::RoiMask *
+ESSConsumer::findRoiMask(const RoiSet &Rois, const std::string &source) {
+  auto It = Rois.Masks.find(source);
+  if (It == Rois.Masks.end()) {
+    It = Rois.Masks.find(std::string(Configuration::EMPTY_SOURCE));
+  }
+  return It != Rois.Masks.end() ? &It->second : nullptr;
+}
+
+std::shared_ptr<const ESSConsumer::RoiMask>
+ESSConsumer::roiMask(const std::string &source) const {
+  const auto Rois = std::atomic_load(&mRois);
+  if (not Rois) {
+    return nullptr;
+  }
+  // Shares ownership of the whole set
+  const RoiMask *Mask = findRoiMask(*Rois, source);
+  return Mask ? std::shared_ptr<const RoiMask>(Rois, Mask) : nullptr;
+}
+
+void ESSConsumer::addRoiTofs(const std::string &source, const RoiMask &Rois,
+                             const vector<uint32_t> &RoiTofs) {
+  std::lock_guard<std::mutex> lock(mRoiMutex);
+
+  // Drop the counts if the regions changed while the message was decoded
+  if (not mRois or findRoiMask(*mRois, source) != &Rois) {
+    return;
+  }
+
+  const size_t Bins = mTofBinner.bins();
+  for (size_t Roi = 0; Roi * Bins < RoiTofs.size(); Roi++) {
+    if (Rois.Used & (1u << Roi)) {
+      mRoiTOFs[Roi].add_values(
+          vector<uint32_t>(RoiTofs.begin() + Roi * Bins,
+                           RoiTofs.begin() + (Roi + 1) * Bins));
+    }
+  }
+}
+
 void ESSConsumer::addSource(const std::string &source) {
   // Empty string and EMPTY_SOURCE are ignored - they mean "no filtering"
   if (source.empty() || source == Configuration::EMPTY_SOURCE) {
@@ -467,6 +1189,24 @@ void ESSConsumer::addSource(const std::string &source) {
   }
 
   mSources.insert(source);
+  createData(source);
+}
+
+void ESSConsumer::createData(const std::string &source) {
+  mHistograms[source].setOccupancy(mConfig.mGeometry.SparseOccupancy);
+  for (auto *dataMap : {&mHistogramTOFs, &mPixelIDs, &mTOFs}) {
+    (*dataMap)[source];
+  }
+}
+
+void ESSConsumer::addEvents(const std::string &source,
+                            const vector<uint32_t> &Pixels,
+                            const vector<uint32_t> &TofBins) {
+  // Append both under one lock, so pixels and TOFs stay paired when several
+  // threads decode messages
+  std::lock_guard<std::mutex> lock(mEventsMutex);
+  mPixelIDs.at(source).append(Pixels);
+  mTOFs.at(source).append(TofBins);
 }
 
 bool ESSConsumer::hasSource(const std::string &source) const {
@@ -475,73 +1215,138 @@ bool ESSConsumer::hasSource(const std::string &source) const {
   return it != mSources.cend();
 }
 
-bool ESSConsumer::checkDelivery(DataType Type) {
-  mDeliveryCount[Type] += 1;
-  if (mDeliveryCount[Type] == mSubscriptionCount[Type]) {
-    mDeliveryCount[Type] = 0;
+std::vector<DataType> ESSConsumer::subscribedTypes(PlotType Type) {
+  switch (Type) {
+  case PlotType::TOF:
+    return {DataType::HISTOGRAM_TOF};
 
-    return true;
-  }
+  case PlotType::TOF2D:
+    return {DataType::PIXEL_ID, DataType::TOF};
 
-  return false;
-}
+  case PlotType::PIXELS:
+  case PlotType::HISTOGRAM:
+    return {DataType::HISTOGRAM};
 
-void ESSConsumer::addSubscriber(PlotType Type, bool add) {
-  // Check if we register or deregister a plot
-  const int increment = add ? 1 : -1;
+  case PlotType::PULSE_RATE:
+    return {DataType::PULSE};
 
-  // Increment the total number of plots
-  mSubscribers += increment;
-  mSubscriptionCount[DataType::ANY] += increment;
+  default:
+    return {};
+  }
+}
 
-  // Register or de-register data types for the plot type
+std::map<std::string, vector<uint32_t>> &
+ESSConsumer::epochData(Epoch &E, DataType Type) {
   switch (Type) {
-  case PlotType::TOF:
-    mSubscriptionCount[DataType::HISTOGRAM_TOF] += increment;
-    break;
+  case DataType::PIXEL_ID:
+    return E.PixelIDs;
 
-  case PlotType::TOF2D:
-    mSubscriptionCount[DataType::PIXEL_ID] += increment;
-    mSubscriptionCount[DataType::TOF] += increment;
-    break;
+  case DataType::TOF:
+    return E.TOFs;
 
-  case PlotType::PIXELS:
-    mSubscriptionCount[DataType::HISTOGRAM] += increment;
-    break;
+  default:
+    return E.HistogramTOFs;
+  }
+}
 
-  case PlotType::HISTOGRAM:
-    mSubscriptionCount[DataType::HISTOGRAM] += increment;
-    break;
+ESSConsumer::Subscriber *ESSConsumer::beginRead(int Id, DataType Type) {
+  auto It = mSubscribers.find(Id);
+  if (It == mSubscribers.end() or It->second.Seen.count(Type) == 0) {
+    return nullptr;
+  }
 
-  default:
-    break;
+  // Only seal a new epoch when there is nothing unread, so a subscriber
+  // lagging behind catches up on the epochs it missed
+  if (It->second.Seen[Type] < mVersion) {
+    return &It->second;
   }
 
-  // Uncomment to print the subscription state
-  // for (const auto& dt: DataType::types()) {
-  //   fmt::print("ESSConsumer::addSubscriber {} {}\n", Type,
-  //   mSubscriptionCount[dt]);
-  // }
+  Epoch &E = mEpochs.emplace_back();
+  E.Version = ++mVersion;
+  for (auto &[key, data] : mHistograms) {
+    if (AdaptiveHistogram Histogram = data.take(); not Histogram.empty()) {
+      E.Histograms.emplace(key, std::move(Histogram));
+    }
+  }
+  sealData(mHistogramTOFs, E.HistogramTOFs);
+  {
+    // Keep pixels and TOFs paired
+    std::lock_guard<std::mutex> lock(mEventsMutex);
+    sealData(mPixelIDs, E.PixelIDs);
+    sealData(mTOFs, E.TOFs);
+  }
+
+  return &It->second;
 }
 
-size_t ESSConsumer::subscriptionCount() const {
-  size_t count = 0;
-  for (const auto &[key, c] : mSubscriptionCount) {
-    count += c;
+void ESSConsumer::reclaimEpochs() {
+  for (DataType Type : {DataType::HISTOGRAM, DataType::HISTOGRAM_TOF,
+                        DataType::PIXEL_ID, DataType::TOF}) {
+    // Oldest version still to be read by a subscriber of this data type
+    uint64_t Oldest = mVersion;
+    for (const auto &[Id, Reader] : mSubscribers) {
+      if (auto It = Reader.Seen.find(Type); It != Reader.Seen.end()) {
+        Oldest = std::min(Oldest, It->second);
+      }
+    }
+
+    for (auto &E : mEpochs) {
+      if (E.Version > Oldest) {
+        break;
+      }
+      if (Type == DataType::HISTOGRAM) {
+        E.Histograms.clear();
+      } else {
+        epochData(E, Type).clear();
+      }
+    }
+  }
+
+  // An epoch is dropped when every data type in it has been released
+  while (not mEpochs.empty()) {
+    const Epoch &E = mEpochs.front();
+    if (not E.Histograms.empty() or not E.HistogramTOFs.empty() or
+        not E.PixelIDs.empty() or not E.TOFs.empty()) {
+      break;
+    }
+    mEpochs.pop_front();
+  }
+}
+
+int ESSConsumer::addSubscriber(PlotType Type) {
+  std::lock_guard<std::mutex> lock(mEpochMutex);
+
+  // Data sealed before the subscription is not delivered
+  const int Id = mNextSubscriber++;
+  Subscriber &Reader = mSubscribers[Id];
+  mSubscriptionCount[DataType::ANY] += 1;
+  for (DataType dt : subscribedTypes(Type)) {
+    Reader.Seen[dt] = mVersion;
+    mSubscriptionCount[dt] += 1;
   }
 
-  return count;
+  return Id;
 }
 
-void ESSConsumer::gotEventRequest() {
-  mEventRequests += 1;
+void ESSConsumer::removeSubscriber(int Subscriber) {
+  std::lock_guard<std::mutex> lock(mEpochMutex);
 
-  // Reset if all event requests have been delivered
-  if (mEventRequests == mSubscriptionCount[DataType::ANY]) {
-    mEventCount = 0;
-    mEventAccept = 0;
-    mEventDiscard = 0;
+  auto It = mSubscribers.find(Subscriber);
+  if (It == mSubscribers.end()) {
+    return;
+  }
 
-    mEventRequests = 0;
+  mSubscriptionCount[DataType::ANY] -= 1;
+  for (const auto &[dt, Version] : It->second.Seen) {
+    mSubscriptionCount[dt] -= 1;
   }
+  mSubscribers.erase(It);
+
+  // Release what only this subscriber was waiting for
+  reclaimEpochs();
+}
+
+size_t ESSConsumer::subscriptionCount() const {
+  std::lock_guard<std::mutex> lock(mEpochMutex);
+  return mSubscribers.size();
 }
@@ -10,17 +10,28 @@
 
 #pragma once
 
+#include <AdaptiveHistogram.h>
+#include <Binner.h>
+#include <EventStatistics.h>
+#include <PixelTofCube.h>
+#include <PulseRing.h>
 #include <ThreadSafeVector.h>
+#include <WavelengthConverter.h>
 #include <types/DataType.h>
 
 #include <librdkafka/rdkafkacpp.h>
 
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -68,16 +79,34 @@ public:
   /// \brief  Type used for having one threaded vector per flat buffer source
   using TSVectorMap = std::map<std::string, TSVector>;
 
+  /// \brief  One thread safe pixel histogram per flat buffer source
+  using HistogramMap = std::map<std::string, ThreadSafeHistogram>;
+
   /// \brief Constructor needs the configured Broker and Topic
   ESSConsumer(Configuration &Config,
               std::vector<std::pair<std::string, std::string>> &KafkaConfig);
 
+  /// \brief Stops and joins the backfill threads
+  ~ESSConsumer();
+
   /// \brief wrapper function for librdkafka consumer
+  /// \return the consumed message, or nullptr when viewing shared memory
   std::unique_ptr<RdKafka::Message> consume();
 
   /// \brief setup librdkafka parameters for Broker and Topic
   RdKafka::KafkaConsumer *subscribeTopic() const;
 
+  /// \brief Start replaying the configured backfill period, using up to
+  /// BACKFILL_READERS decoding threads which take one partition after
+  /// another. Live consumption continues in parallel.
+  ///
+  /// \note Call after all sources have been added
+  void startBackfill();
+
+  /// \return fraction of the backfill messages processed, 1.0 when done or
+  /// when no backfill is configured
+  double getBackfillProgress() const;
+
   /// \brief initial checks for kafka error messages
   /// \return true if message contains data, false otherwise
   bool handleMessage(RdKafka::Message *message);
@@ -86,37 +115,81 @@ public:
   /// multiple applications is possible.
   static std::string randomGroupString(size_t length);
 
-  uint64_t getEventCount() const { return mEventCount; };
-  uint64_t getEventAccept() const { return mEventAccept; };
-  uint64_t getEventDiscard() const { return mEventDiscard; };
+  /// \return cumulative event counters, these are never reset
+  uint64_t getEventCount() const { return mStatistics.totals().Count; };
+  uint64_t getEventAccept() const { return mStatistics.totals().Accept; };
+  uint64_t getEventDiscard() const { return mStatistics.totals().Discard; };
+
+  /// \return event counters and rate samples
+  EventStatistics &getStatistics() { return mStatistics; }
 
   /// \brief Add a new plot subscribing for data
   ///
   /// \param Type  The plot type
-  void addSubscriber(PlotType Type, bool add = true);
+  /// \return      Subscriber id, used for reading out data
+  int addSubscriber(PlotType Type);
+
+  /// \brief Cancel a subscription, the epochs only it had not read yet are
+  /// released. Unknown ids are ignored.
+  void removeSubscriber(int Subscriber);
 
   /// \return The current number of data subscriptions
   size_t subscriptionCount() const;
 
-  /// \brief Call this after pulling events data in order to clear all delivered
-  /// subscriptions
-  void gotEventRequest();
+  /// \brief Read out the data of a given data type which arrived since the
+  /// subscriber last read it, optionally from a specific source
+  ///
+  /// Data is sealed into readout epochs with increasing version numbers. A
+  /// read seals the data received so far only if the subscriber has already
+  /// seen the newest epoch, so subscribers may read at their own rate and
+  /// each receives every count exactly once. All data types are sealed
+  /// together, so PIXEL_ID and TOF read by one subscriber stay paired.
+  ///
+  /// \param dataType    Type of the data (HISTOGRAM, HISTOGRAM_TOF,
+  ///                    PIXEL_ID, or TOF)
+  /// \param source      Flat buffer source name. If empty (""), combines data
+  ///                    from all sources element-wise (adds values at the
+  ///                    same index across all sources)
+  /// \param subscriber  Id returned by addSubscriber()
+  /// \return            Vector containing the requested data. Returns empty
+  ///                    vector if source not found, dataType is invalid or
+  ///                    not subscribed to by the subscriber
+  std::vector<uint32_t> readData(DataType dataType, const std::string &source,
+                                 int subscriber);
+
+  /// \brief Read out the pixel histogram without converting it to a dense
+  /// vector. Parameters as for readData().
+  ///
+  /// \return  Sparse or dense histogram, empty if the source is not found
+  AdaptiveHistogram readHistogram(const std::string &source, int subscriber);
+
+  /// \brief Move out the pixel histograms accumulated since the last call for
+  /// all sources, bypassing the subscriptions. Only used when no plots
+  /// subscribe, e.g. by a shared memory publisher.
+  std::map<std::string, AdaptiveHistogram> takeHistograms();
+
+  /// \brief Move out the data accumulated since the last call for all sources,
+  /// bypassing the subscriptions, as takeHistograms()
+  ///
+  /// \param dataType  Type of the data
+  /// \return          Map from flat buffer source name to data
+  std::map<std::string, std::vector<uint32_t>> takeData(DataType dataType);
 
-  /// \brief Read out data for a given data type, optionally from a specific
-  /// source
+  /// \brief Add data which was accumulated elsewhere, e.g. by a publishing
+  /// daqlite instance, as if it had been consumed from Kafka
   ///
-  /// \param dataType  Type of the data (HISTOGRAM, HISTOGRAM_TOF,
-  ///                  PIXEL_ID, or TOF)
-  /// \param source    Flat buffer source name. If empty (""), combines data
-  ///                  from all sources element-wise (adds values at the same
-  ///                  index across all sources)
-  /// \param reset     If true and all deliveries are complete, clears
-  ///                  the internal data container(s)
-  /// \return          Vector containing the requested data. Returns empty
-  ///                  vector if source not found or dataType is invalid
-  std::vector<uint32_t> readData(DataType dataType,
-                                 const std::string &source = "",
-                                 bool reset = true);
+  /// \param dataType  Type of the data (HISTOGRAM or HISTOGRAM_TOF)
+  /// \param source    Flat buffer source name
+  /// \param data      Values to add element-wise
+  void addData(DataType dataType, const std::string &source,
+               const std::vector<uint32_t> &data);
+
+  /// \return per-pulse summaries, filled from ev44 reference times while a
+  /// plot subscribes to PULSE data
+  const PulseRing &getPulses() const { return mPulses; }
+
+  /// \brief Add event counts which were obtained elsewhere
+  void addEventCounts(uint64_t Count, uint64_t Accept, uint64_t Discard);
 
   /// \brief Get the data container size for a specific source and data type
   /// \param dataType  Type of the data
@@ -125,12 +198,54 @@ public:
   ///                  if not found
   size_t getDataSize(DataType dataType, const std::string &source = "") const;
 
-  /// \brief Get the number of bins for the TOF data container
+  /// \brief Get the number of bins of the da00 histogram
   /// \param source    Flat buffer source name
-  /// \return          Number of bins (TOF data size - 1), or 0 if source not
+  /// \return          Number of bins (bin edges - 1), or 0 if source not
   ///                  found or empty
   size_t getBinSize(const std::string &source = "") const;
 
+  /// \brief Get the bin edges of the latest da00 histogram
+  /// \param source    Flat buffer source name
+  /// \return          Bin edges, empty if no histogram was received
+  std::vector<double> readBinEdges(const std::string &source = "") const;
+
+  /// \brief Set the bin edges of the da00 histogram of a source which was
+  /// received elsewhere, e.g. by a publishing daqlite instance
+  /// \param source    Flat buffer source name
+  /// \param edges     Bin edges, one more than the number of bins
+  void setBinEdges(const std::string &source, const std::vector<double> &edges);
+
+  /// \brief Maximum number of regions of interest, one bit each per pixel
+  static constexpr int MAX_ROIS{32};
+
+  /// \brief Add a region of interest, events in its pixels are histogrammed
+  /// in a TOF histogram of their own
+  /// \param Source  Flat buffer source of the pixel map the region was drawn
+  ///                on, EMPTY_SOURCE for events of all sources
+  /// \param Pixels  Pixel ids of the region, without the geometry offset
+  /// \return        Index of the region, or -1 if MAX_ROIS are in use
+  int addRoi(const std::string &Source, const std::vector<uint32_t> &Pixels);
+
+  /// \brief Remove a region of interest and its TOF histogram
+  void removeRoi(int Roi);
+
+  /// \brief Read and reset the TOF histogram of a region of interest
+  std::vector<uint32_t> readRoiTof(int Roi);
+
+  /// \brief Read the pixel histogram of the events in a TOF window, from the
+  /// pixel x TOF cube since it was last cleared
+  /// \param source  Flat buffer source of the plot
+  /// \param TofMin  First TOF of the window, in the units of the TOF binning
+  /// \param TofMax  Last TOF of the window
+  /// \return        Empty histogram if the cube is disabled or keeps the
+  ///                events of another source
+  AdaptiveHistogram readCubePixelMap(const std::string &source,
+                                     uint32_t TofMin, uint32_t TofMax) const;
+
+  /// \brief Remove all counts from the pixel x TOF cube, if it keeps the
+  /// events of a source
+  void clearCube(const std::string &source);
+
   /// \brief Register a flat buffer source for processing
   /// \param source  The flat buffer source name to register. Empty strings are
   ///                ignored.
@@ -140,35 +255,145 @@ public:
 
 private:
   /// \brief Get a pointer to the data container map for a given data type
-  /// \param dataType  Type of the data (HISTOGRAM, HISTOGRAM_TOF, PIXEL_ID, or
-  ///                  TOF)
+  /// \param dataType  Type of the data (HISTOGRAM_TOF, PIXEL_ID, or TOF)
   /// \return          Pointer to the TSVectorMap containing data for all
   ///                  sources, or nullptr if dataType is invalid
+  ///
+  /// \note HISTOGRAM is kept in mHistograms, see readHistogram()
   const TSVectorMap *getData(DataType dataType) const;
 
+  /// \brief Create the data containers for a source up front, so decoding
+  /// threads only need lookups
+  void createData(const std::string &source);
+
+  /// \brief Append raw events for the 2D TOF plot
+  void addEvents(const std::string &source, const std::vector<uint32_t> &Pixels,
+                 const std::vector<uint32_t> &TofBins);
+
   /// \brief Check if a flat buffer source has been registered for processing
   /// \param source  The flat buffer source
   bool hasSource(const std::string &source) const;
 
   RdKafka::Conf *mConf;
   RdKafka::Conf *mTConf;
-  RdKafka::KafkaConsumer *mConsumer;
+  RdKafka::KafkaConsumer *mConsumer{nullptr};
   RdKafka::Topic *mTopic;
 
-  uint64_t mEventCount{0};
-  uint64_t mEventAccept{0};
-  uint64_t mEventDiscard{0};
+  EventStatistics mStatistics;
+
+  /// \brief Create a consumer from the configuration, without subscribing
+  RdKafka::KafkaConsumer *createConsumer() const;
+
+  /// \brief Create a consumer assigned to the current end of all partitions
+  /// and register the offset ranges to backfill
+  RdKafka::KafkaConsumer *assignBackfill();
+
+  /// \brief Offset range [Start, End) of a partition to backfill
+  struct BackfillRange {
+    int32_t Partition;
+    int64_t Start;
+    int64_t End;
+  };
+
+  /// \brief Backfill thread function, consumes the ranges not taken yet by
+  /// other backfill threads
+  void backfillRanges();
+
+  /// \brief Consume and process one range with a consumer of the calling
+  /// backfill thread
+  void backfillPartition(RdKafka::KafkaConsumer &Consumer, BackfillRange Range);
+
+  /// \brief Maximum number of backfill threads, each with its own consumer,
+  /// fewer if there are fewer cores or partitions
+  static constexpr size_t BACKFILL_READERS{8};
+
+  /// \brief Timeout for metadata and offset queries
+  static constexpr int BACKFILL_TIMEOUT_MS{5000};
+
+  /// \brief Consecutive consume timeouts before a backfill thread gives up
+  static constexpr int BACKFILL_MAX_TIMEOUTS{3};
+
+  std::vector<BackfillRange> mBackfillRanges;
+  std::vector<std::thread> mBackfillThreads;
+  std::atomic<size_t> mBackfillNext{0};
+  std::atomic<int64_t> mBackfillTotal{0};
+  std::atomic<int64_t> mBackfillDone{0};
+  std::atomic<size_t> mBackfillRunning{0};
+  std::atomic<bool> mStopBackfill{false};
+
+  /// \brief Keeps raw pixel and TOF events paired between threads
+  std::mutex mEventsMutex;
 
   // Thread safe data storage -  use a map to handle unique data for each flat
   // buffer source
-  TSVectorMap mHistograms;
+  HistogramMap mHistograms;
   TSVectorMap mHistogramTOFs;
   TSVectorMap mPixelIDs;
   TSVectorMap mTOFs;
 
+  /// \brief Region of interest bits per pixel for the events of one source
+  struct RoiMask {
+    std::vector<uint32_t> Bits; // bit k is set for pixels in region k
+    uint32_t Used{0};           // bit k is set if region k applies
+  };
+
+  /// \brief All regions of interest and their masks per source. The ingest
+  /// loop takes a reference once per message, changes replace the whole set.
+  struct RoiSet {
+    std::array<std::vector<uint32_t>, MAX_ROIS> Pixels;
+    std::array<std::string, MAX_ROIS> Sources; // EMPTY_SOURCE for all
+    uint32_t Used{0};                          // bit k is set if defined
+    /// Regions of a source together with those of all sources, the
+    /// EMPTY_SOURCE mask is used for sources without regions of their own
+    std::map<std::string, RoiMask> Masks;
+  };
+  std::shared_ptr<const RoiSet> mRois;
+
+  /// \brief Serializes changes of the regions of interest
+  std::mutex mRoiMutex;
+
+  /// \brief TOF histograms of the regions of interest
+  std::array<TSVector, MAX_ROIS> mRoiTOFs;
+
+  /// \brief Rebuild the masks per source from the regions of a set
+  void buildRoiMasks(RoiSet &Rois) const;
+
+  /// \return the mask of a set which applies to a source, or nullptr
+  static const RoiMask *findRoiMask(const RoiSet &Rois,
+                                    const std::string &source);
+
+  /// \return the regions of interest which apply to a source, or nullptr
+  std::shared_ptr<const RoiMask> roiMask(const std::string &source) const;
+
+  /// \brief Count an event in the local TOF histograms of the regions which
+  /// contain its pixel. Pixels outside all regions cost one mask lookup.
+  inline void addRoiTof(const RoiMask &Rois, uint32_t Pixel, uint32_t TofBin,
+                        std::vector<uint32_t> &RoiTofs) const {
+    uint32_t Bits = Pixel < Rois.Bits.size() ? Rois.Bits[Pixel] : 0;
+    for (; Bits != 0; Bits &= Bits - 1) {
+      RoiTofs[__builtin_ctz(Bits) * mTofBinner.bins() + TofBin]++;
+    }
+  }
+
+  /// \brief Add the local TOF histograms of a message to mRoiTOFs
+  void addRoiTofs(const std::string &source, const RoiMask &Rois,
+                  const std::vector<uint32_t> &RoiTofs);
+
   /// \brief configuration obtained from main()
   Configuration &mConfig;
 
+  /// \brief recent pulses
+  PulseRing mPulses;
+
+  /// \brief TOF to bin conversion for the configured binning
+  Binner mTofBinner;
+
+  /// \brief pixel x TOF histogram of the source of the main configuration
+  PixelTofCube mCube;
+
+  /// \brief optional TOF to wavelength conversion before binning
+  WavelengthConverter mWavelength;
+
   /// \brief all registered flat buffer sources
   std::set<std::string> mSources;
 
@@ -184,63 +409,84 @@ private:
   /// \brief histograms the DA00 TOF data bins
   uint32_t processDA00Data(RdKafka::Message *Msg);
 
-  std::vector<int64_t> getDataVector(const da00_Variable &Variable) const;
+  /// \brief Store the da00 bin edges if they changed since the last message
+  /// \return true if the edges are within the configured TOF range
+  bool updateBinEdges(const std::string &source, const da00_Variable &Edges);
+
+  /// \brief Hash of the last da00 bin edges per source and whether they were
+  /// accepted, so unchanged edges are not converted again
+  struct BinEdgeCache {
+    uint64_t Hash{0};
+    bool Valid{false};
+    bool Accepted{false};
+  };
+
+  mutable std::mutex mBinEdgesMutex;
+  std::map<std::string, BinEdgeCache> mBinEdgeCache;
+  std::map<std::string, std::vector<double>> mBinEdges;
 
   /// \brief Some stat counters
   /// \todo use or delete?
   struct Stat {
-    uint64_t MessagesRx{0};
-    uint64_t MessagesTMO{0};
-    uint64_t MessagesData{0};
-    uint64_t MessagesEOF{0};
-    uint64_t MessagesUnknown{0};
-    uint64_t MessagesOther{0};
+    std::atomic<uint64_t> MessagesRx{0};
+    std::atomic<uint64_t> MessagesTMO{0};
+    std::atomic<uint64_t> MessagesData{0};
+    std::atomic<uint64_t> MessagesEOF{0};
+    std::atomic<uint64_t> MessagesUnknown{0};
+    std::atomic<uint64_t> MessagesOther{0};
   } mKafkaStats;
 
   uint32_t mNumPixels{0}; ///< Number of pixels
   uint32_t mMinPixel{0};  ///< Offset
   uint32_t mMaxPixel{0};  ///< Number of pixels + offset
 
-  /// \brief  Reset data if requested and all deliveries have been made
-  /// \param  dataMap   The data map to reset
-  /// \param  dataType  The data type being delivered
-  /// \param  source    Source name. If empty, resets all sources; otherwise
-  ///                   resets specific source
-  /// \param  reset     Whether to reset data
-  ///
-  /// \note Only resets data when checkDelivery confirms all subscribers have
-  /// received data
-  inline void resetDataIfNeeded(TSVectorMap *dataMap, DataType dataType,
-                                const std::string &source, bool reset) {
-    if (reset && checkDelivery(dataType)) {
-      if (!source.empty()) {
-        auto iter = dataMap->find(source);
-        if (iter != dataMap->end()) {
-          iter->second.clear();
-        }
-      } else {
-        for (auto &[key, data] : *dataMap) {
-          data.clear();
-        }
-      }
-    }
-  }
-
-  /// \brief  Check if all deliveries have been made for a given data type
-  /// \param  Type  Check for this data type
-  /// \return true if all deliveries are done
-  bool checkDelivery(DataType Type);
-
-  /// \brief Number of plots subscribing to ESSConsumer data (is incremented
-  ///        when calling addSubscriber)
-  size_t mSubscribers{0};
-
-  /// \brief  Count the current number of request for event stats
-  size_t mEventRequests{0};
-
-  /// \brief The number of subscribers for each data type
-  std::map<DataType, size_t> mSubscriptionCount;
-
-  /// \brief The number of deliveries made so far for different data types
-  std::map<DataType, size_t> mDeliveryCount;
+  /// \brief Data sealed by a readout. Containers are moved out of the open
+  /// maps, nothing is copied until a subscriber reads the epoch.
+  struct Epoch {
+    uint64_t Version{0};
+    std::map<std::string, AdaptiveHistogram> Histograms;
+    std::map<std::string, std::vector<uint32_t>> HistogramTOFs;
+    std::map<std::string, std::vector<uint32_t>> PixelIDs;
+    std::map<std::string, std::vector<uint32_t>> TOFs;
+  };
+
+  /// \brief A registered plot and the newest epoch version it has read for
+  /// each data type it subscribes to
+  struct Subscriber {
+    std::map<DataType, uint64_t> Seen;
+  };
+
+  /// \return the data types delivered to a plot type
+  static std::vector<DataType> subscribedTypes(PlotType Type);
+
+  /// \brief Seal the open data into a new epoch if the subscriber has seen
+  /// the newest one, called with mEpochMutex held
+  /// \return the subscriber, or nullptr if the id is unknown
+  Subscriber *beginRead(int Id, DataType Type);
+
+  /// \brief Release the data which all subscribers of its data type have
+  /// seen and drop empty epochs, called with mEpochMutex held
+  void reclaimEpochs();
+
+  /// \return the epoch data of a data type, HISTOGRAM excluded
+  static std::map<std::string, std::vector<uint32_t>> &epochData(Epoch &E,
+                                                                 DataType Type);
+
+  /// \brief Serializes readouts and subscription changes
+  mutable std::mutex mEpochMutex;
+
+  /// \brief Version of the newest epoch, 0 before the first readout
+  uint64_t mVersion{0};
+
+  /// \brief Sealed epochs not yet read by all subscribers, oldest first
+  std::deque<Epoch> mEpochs;
+
+  /// \brief Registered plots by subscriber id
+  std::map<int, Subscriber> mSubscribers;
+  int mNextSubscriber{0};
+
+  /// \brief The number of subscribers for each data type, changed under
+  /// mEpochMutex but read by the decoding threads without it. All types
+  /// are added on construction, so only the counts change.
+  std::map<DataType, std::atomic<size_t>> mSubscriptionCount;
 };
@@ -0,0 +1,119 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file EventStatistics.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <EventStatistics.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+/// \brief Hands out counter slots to threads
+std::atomic<size_t> NextThread{0};
+
+int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+} // namespace
+
+EventStatistics::Slot &EventStatistics::slot() {
+  static thread_local const size_t Index =
+      NextThread.fetch_add(1, std::memory_order_relaxed) % MAX_THREADS;
+  return mSlots[Index];
+}
+
+EventStatistics::Totals EventStatistics::totals() const {
+  Totals Sum;
+  for (const auto &Counters : mSlots) {
+    Sum.Count += Counters.Count.load(std::memory_order_relaxed);
+    Sum.Accept += Counters.Accept.load(std::memory_order_relaxed);
+    Sum.Discard += Counters.Discard.load(std::memory_order_relaxed);
+  }
+  return Sum;
+}
+
+void EventStatistics::sample() {
+  const int64_t Now = nowNs();
+  const Totals Current = totals();
+
+  // The first call only sets the starting point
+  if (mLastTimeNs == 0) {
+    mLastTimeNs = Now;
+    mLastTotals = Current;
+    return;
+  }
+
+  const double Seconds = (Now - mLastTimeNs) / 1e9;
+  if (Seconds <= 0) {
+    return;
+  }
+
+  const double CountRate = (Current.Count - mLastTotals.Count) / Seconds;
+  const uint64_t Samples = mSampleCount.load(std::memory_order_relaxed);
+  mEwma = Samples == 0 ? CountRate
+                       : EWMA_WEIGHT * CountRate + (1 - EWMA_WEIGHT) * mEwma;
+
+  Sample &New = mSamples[Samples % MAX_SAMPLES];
+  New.TimeNs.store(Now, std::memory_order_relaxed);
+  New.Count.store(CountRate, std::memory_order_relaxed);
+  New.Accept.store((Current.Accept - mLastTotals.Accept) / Seconds,
+                   std::memory_order_relaxed);
+  New.Discard.store((Current.Discard - mLastTotals.Discard) / Seconds,
+                    std::memory_order_relaxed);
+  New.CountEwma.store(mEwma, std::memory_order_relaxed);
+  mSampleCount.store(Samples + 1, std::memory_order_release);
+
+  mLastTimeNs = Now;
+  mLastTotals = Current;
+}
+
+EventStatistics::Rates EventStatistics::rates() const {
+  Rates Result;
+  const uint64_t Samples = mSampleCount.load(std::memory_order_acquire);
+  if (Samples == 0) {
+    return Result;
+  }
+
+  const Sample &Newest = mSamples[(Samples - 1) % MAX_SAMPLES];
+  Result.Count = Newest.Count.load(std::memory_order_relaxed);
+  Result.Accept = Newest.Accept.load(std::memory_order_relaxed);
+  Result.Discard = Newest.Discard.load(std::memory_order_relaxed);
+  Result.CountEwma = Newest.CountEwma.load(std::memory_order_relaxed);
+
+  Result.CountMin = Result.Count;
+  Result.CountMax = Result.Count;
+  const size_t Stored = std::min<uint64_t>(Samples, MAX_SAMPLES);
+  for (size_t i = 0; i < Stored; i++) {
+    const double Rate = mSamples[i].Count.load(std::memory_order_relaxed);
+    Result.CountMin = std::min(Result.CountMin, Rate);
+    Result.CountMax = std::max(Result.CountMax, Rate);
+  }
+
+  return Result;
+}
+
+std::vector<std::pair<double, double>> EventStatistics::history() const {
+  std::vector<std::pair<double, double>> Result;
+  const uint64_t Samples = mSampleCount.load(std::memory_order_acquire);
+  if (Samples == 0) {
+    return Result;
+  }
+
+  const int64_t Newest =
+      mSamples[(Samples - 1) % MAX_SAMPLES].TimeNs.load(std::memory_order_relaxed);
+  const size_t Stored = std::min<uint64_t>(Samples, MAX_SAMPLES);
+  Result.reserve(Stored);
+  for (uint64_t i = Samples - Stored; i < Samples; i++) {
+    const Sample &Old = mSamples[i % MAX_SAMPLES];
+    Result.emplace_back(
+        (Old.TimeNs.load(std::memory_order_relaxed) - Newest) / 1e9,
+        Old.Count.load(std::memory_order_relaxed));
+  }
+
+  return Result;
+}
@@ -0,0 +1,107 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file EventStatistics.h
+///
+/// \brief Lock-free event counters and a ring of per-interval rate samples
+///
+/// Decoding threads add to their own cache line padded counters, so the live
+/// consumer and the backfill threads never share a cache line. The counters
+/// are cumulative and never reset. Once per interval the worker thread sums
+/// the counters and stores a sample with the rates and a smoothed (EWMA)
+/// rate in a small ring. The GUI reads the samples without locking; in the
+/// worst case it sees the oldest sample while it is being replaced.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class EventStatistics {
+public:
+  /// \brief Number of counter slots, threads beyond this share slots
+  static constexpr size_t MAX_THREADS{16};
+
+  /// \brief Number of samples kept for min/max and the strip chart
+  static constexpr size_t MAX_SAMPLES{300};
+
+  /// \brief Weight of the newest sample in the smoothed rate
+  static constexpr double EWMA_WEIGHT{0.2};
+
+  /// \brief Cumulative counts
+  struct Totals {
+    uint64_t Count{0};
+    uint64_t Accept{0};
+    uint64_t Discard{0};
+  };
+
+  /// \brief Rates in events/s
+  struct Rates {
+    double Count{0};
+    double Accept{0};
+    double Discard{0};
+
+    /// \brief Smoothed, minimum and maximum event rate over the samples
+    double CountEwma{0};
+    double CountMin{0};
+    double CountMax{0};
+  };
+
+  /// \brief Add counts from the calling thread
+  inline void add(uint64_t Count, uint64_t Accept, uint64_t Discard) {
+    Slot &Counters = slot();
+    Counters.Count.fetch_add(Count, std::memory_order_relaxed);
+    Counters.Accept.fetch_add(Accept, std::memory_order_relaxed);
+    Counters.Discard.fetch_add(Discard, std::memory_order_relaxed);
+  }
+
+  /// \return sum of all counters
+  Totals totals() const;
+
+  /// \brief Store a sample of the rates since the previous call. Must only be
+  /// called from one thread.
+  void sample();
+
+  /// \return rates of the newest sample, with EWMA and min/max over all
+  /// samples
+  Rates rates() const;
+
+  /// \return seconds relative to the newest sample and event rate, oldest
+  /// first
+  std::vector<std::pair<double, double>> history() const;
+
+private:
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> Count{0};
+    std::atomic<uint64_t> Accept{0};
+    std::atomic<uint64_t> Discard{0};
+  };
+
+  struct Sample {
+    std::atomic<int64_t> TimeNs{0};
+    std::atomic<double> Count{0};
+    std::atomic<double> Accept{0};
+    std::atomic<double> Discard{0};
+    std::atomic<double> CountEwma{0};
+  };
+
+  /// \return counters of the calling thread
+  Slot &slot();
+
+  std::array<Slot, MAX_THREADS> mSlots;
+
+  std::array<Sample, MAX_SAMPLES> mSamples;
+
+  /// \brief Number of samples taken, published after a sample is written
+  std::atomic<uint64_t> mSampleCount{0};
+
+  /// \brief Sampling thread only: totals and time of the previous sample
+  Totals mLastTotals;
+  int64_t mLastTimeNs{0};
+  double mEwma{0};
+};
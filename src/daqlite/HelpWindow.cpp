@@ -91,6 +91,7 @@ HelpWindow::HelpWindow(QWidget *parent)
     {"Reset view",          "Ctrl+R",          "Cmd+R"},
     {"Store current view",  "Ctrl+S",          "Cmd+S"},
     {"Draw zoom rectangle", "Ctrl+Left mouse", "Cmd+Left mouse"},
+    {"Select region of interest", "Shift+Left mouse", "Shift+Left mouse"},
     {"Invert gradient",     "Alt+I",           "Opt+I"},
     {"Log scale",           "Alt+L",           "Opt+L"},
     {"Auto scale axes",     "Alt+X or Alt+Y",  "Opt+X or Opt+Y"},
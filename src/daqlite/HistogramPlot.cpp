@@ -29,7 +29,8 @@
 using std::vector;
 
 HistogramPlot::HistogramPlot(Configuration &Config, ESSConsumer &Consumer)
-    : AbstractPlot(PlotType::HISTOGRAM, Consumer, Config) {
+    : AbstractPlot(PlotType::HISTOGRAM, Consumer, Config)
+    , HistogramYAxisValues(Config, "histogram", 0) {
   // Register callback functions for events
   connect(this, &QCustomPlot::mouseMove, this, &HistogramPlot::showPointToolTip);
   setAttribute(Qt::WA_AlwaysShowToolTips);
@@ -38,7 +39,10 @@ HistogramPlot::HistogramPlot(Configuration &Config, ESSConsumer &Consumer)
 
   LogicalGeometry = new ESSGeometry(geom.XDim, geom.YDim, geom.ZDim, 1);
 
-  HistogramYAxisValues.resize(mConfig.mTOF.BinSize);
+  // The number of bins is given by the data, unless resuming from file
+  if (HistogramYAxisValues.size() == 0) {
+    HistogramYAxisValues.resize(mConfig.mTOF.BinSize);
+  }
 
   // this will also allow rescaling the color scale by dragging/zooming
   setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
@@ -85,7 +89,12 @@ void HistogramPlot::plotDetectorImage(bool) {
   setCustomParameters();
   mGraph->data()->clear();
 
-  for (unsigned int i = 0; i < HistogramYAxisValues.size(); i++) {
+  // The bin edges are only known once data has arrived
+  const size_t Bins =
+      HistogramXAxisValues.empty()
+          ? 0
+          : std::min(HistogramYAxisValues.size(), HistogramXAxisValues.size() - 1);
+  for (unsigned int i = 0; i < Bins; i++) {
     // calculate the middle x value of the bin to place the data point
     auto binWidth = HistogramXAxisValues[i + 1] - HistogramXAxisValues[i];
     auto middleXValue = HistogramXAxisValues[i] + binWidth / 2.0;
@@ -121,14 +130,18 @@ void HistogramPlot::updateData() {
 
   // continue the the update only if we have data available from the consumer
   const std::string source = mConfig.mPlot.Source;
-  if (mConsumer.getDataSize(DataType::HISTOGRAM, source) == 0 or mConsumer.getDataSize(DataType::TOF, source) == 0) {
+  if (mConsumer.getDataSize(DataType::HISTOGRAM, source) == 0 or mConsumer.getBinSize(source) == 0) {
     return;
   }
 
-  vector<uint32_t> YAxisValues = mConsumer.readData(DataType::HISTOGRAM, source);
-  auto TofValues = mConsumer.readData(DataType::TOF, source, false);
+  vector<uint32_t> YAxisValues = mConsumer.readData(DataType::HISTOGRAM, source, mSubscriber);
+
+  // Nothing new for this subscriber since the last update
+  if (YAxisValues.empty()) {
+    return;
+  }
 
-  HistogramXAxisValues = TofValues;
+  HistogramXAxisValues = mConsumer.readBinEdges(source);
   if (YAxisValues.size() != HistogramXAxisValues.size() - 1) {
     fmt::print("HistogramPlot::updateData() - Y axis values does not match x "
                "axis values. Skip processing!\n");
@@ -139,7 +152,7 @@ void HistogramPlot::updateData() {
   //
   int64_t nsBetweenClear = 1000000000LL * mConfig.mPlot.ClearEverySeconds;
   if (mConfig.mPlot.ClearPeriodic and (elapsed.count() >= nsBetweenClear)) {
-    std::fill(HistogramYAxisValues.begin(), HistogramYAxisValues.end(), 0);
+    HistogramYAxisValues.clear();
     std::fill(HistogramXAxisValues.begin(), HistogramXAxisValues.end(), 0);
     t1 = std::chrono::high_resolution_clock::now();
   }
@@ -157,7 +170,7 @@ void HistogramPlot::updateData() {
 }
 
 void HistogramPlot::clearDetectorImage() {
-  std::fill(HistogramYAxisValues.begin(), HistogramYAxisValues.end(), 0);
+  HistogramYAxisValues.clear();
   plotDetectorImage(true);
 }
 
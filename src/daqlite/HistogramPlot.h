@@ -10,6 +10,7 @@
 #pragma once
 
 #include <AbstractPlot.h>
+#include <MappedHistogram.h>
 
 #include <stdint.h>
 #include <vector>
@@ -48,8 +49,9 @@ private:
   // QCustomPlot variables
   QCPGraph *mGraph{nullptr};
 
-  std::vector<uint32_t> HistogramYAxisValues;
-  std::vector<uint32_t> HistogramXAxisValues;
+  /// \brief accumulated values, optionally persistent
+  MappedHistogram HistogramYAxisValues;
+  std::vector<double> HistogramXAxisValues;
 
   /// \brief for calculating x, y, z from pixelid
   ESSGeometry *LogicalGeometry;
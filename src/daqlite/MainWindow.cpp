@@ -12,17 +12,22 @@
 #include <HelpWindow.h>
 #include <HistogramPlot.h>
 #include <PixelsPlot.h>
+#include <PlotScheduler.h>
+#include <PulseRatePlot.h>
 #include <TofPlot.h>
 #include <WorkerThread.h>
 
 #include <types/Gradients.h>
 
+#include <QPlot/qcustomplot/qcustomplot.h>
+
 #include <fmt/core.h>
 
 #include <QApplication>
 #include <QTextEdit>
 #include <QMetaType>
 #include <QPushButton>
+#include <QTabWidget>
 #include <QPixmap>
 #include <QImage>
 #include <QToolButton>
@@ -39,6 +44,9 @@ class QWidget;
 // Initialize helper to nullptr
 HelpWindow *MainWindow::Helper = nullptr;
 
+// Created with the first window that sets a refresh rate
+PlotScheduler *MainWindow::Scheduler = nullptr;
+
 MainWindow::MainWindow(const Configuration &Config, WorkerThread *Worker, QWidget *parent)
   : QMainWindow(parent)
   , ui(new Ui::MainWindow)
@@ -48,9 +56,13 @@ MainWindow::MainWindow(const Configuration &Config, WorkerThread *Worker, QWidge
   , mGradientIconSize(QSize(128, 24)) {
   ui->setupUi(this);
   setupPlots();
+  if (mConfig.mPlot.RateChart) {
+    setupRateChart();
+  }
 
   ui->lblDescriptionText->setText(mConfig.mPlot.PlotTitle.c_str());
   ui->lblEventRateText->setText("0");
+  ui->progressBackfill->setVisible(mConfig.mKafka.BackfillSeconds > 0);
 
   // Connect all windows buttons
   auto signal = &QPushButton::clicked;
@@ -107,6 +119,11 @@ MainWindow::MainWindow(const Configuration &Config, WorkerThread *Worker, QWidge
 }
 
 MainWindow::~MainWindow() {
+  if (Scheduler != nullptr) {
+    for (const auto &Plot : Plots) {
+      Scheduler->remove(Plot.get());
+    }
+  }
   delete ui;
 }
 
@@ -147,6 +164,18 @@ void MainWindow::setupPlots() {
     ui->gradientLine->setVisible(false);
   }
 
+  else if (Type == PlotType::PULSE_RATE) {
+    Plots.push_back(std::make_unique<PulseRatePlot>(
+        mConfig, mWorker->getConsumer()));
+
+    ui->gridLayout->addWidget(Plots.back().get(), 0, 0, 1, 1);
+
+    // Hide irrelevant buttons for the strip chart
+    ui->comboGradient->setVisible(false);
+    ui->checkBoxInvert->setVisible(false);
+    ui->gradientLine->setVisible(false);
+  }
+
   else if (Type == PlotType::PIXELS) {
 
     // Always create the XY plot
@@ -155,8 +184,9 @@ void MainWindow::setupPlots() {
         PixelsPlot::ProjectionXY));
     ui->gridLayout->addWidget(Plots.back().get(), 0, 0, 1, 1);
 
-    // If detector is 3D, also create XZ and YZ
-    if (mConfig.mGeometry.ZDim > 1) {
+    // If detector is 3D, also create XZ and YZ, unless it has a display map
+    if (mConfig.mGeometry.ZDim > 1 and
+        mConfig.mGeometry.DisplayMapFile.empty()) {
       Plots.push_back(std::make_unique<PixelsPlot>(
           mConfig, mWorker->getConsumer(),
           PixelsPlot::ProjectionXZ));
@@ -166,6 +196,12 @@ void MainWindow::setupPlots() {
           PixelsPlot::ProjectionYZ));
       ui->gridLayout->addWidget(Plots.back().get(), 0, 2, 1, 1);
     }
+
+    // Regions of interest selected on any projection get a TOF plot
+    for (auto &Plot : Plots) {
+      connect(static_cast<PixelsPlot *>(Plot.get()), &PixelsPlot::regionAdded,
+              this, &MainWindow::addRoiPlot);
+    }
   }
 
   else {
@@ -181,6 +217,89 @@ void MainWindow::setupPlots() {
 
   ui->lblBinSizeText->setVisible(PlotType == PlotType::HISTOGRAM);
   ui->lblBinSize->setVisible(PlotType == PlotType::HISTOGRAM);
+
+  for (auto &Plot : Plots) {
+    schedulePlot(Plot.get());
+  }
+}
+
+void MainWindow::schedulePlot(AbstractPlot *Plot) {
+  if (mConfig.mPlot.RefreshHz <= 0.0) {
+    return;
+  }
+
+  if (Scheduler == nullptr) {
+    Scheduler = new PlotScheduler(QApplication::instance());
+  }
+  Scheduler->add(Plot, mConfig.mPlot.RefreshHz, mConfig.mPlot.RefreshPriority);
+}
+
+void MainWindow::setupRateChart() {
+  mRateChart = new QCustomPlot(this);
+  mRateChart->addGraph();
+  mRateChart->graph(0)->setName("Events/s");
+  mRateChart->xAxis->setLabel("Time relative to now (s)");
+  mRateChart->yAxis->setLabel("Events/s");
+  mRateChart->setFixedHeight(150);
+
+  // Below the plots, across all columns
+  ui->gridLayout->addWidget(mRateChart, 1, 0, 1, -1);
+}
+
+void MainWindow::updateRateChart() {
+  auto History = mWorker->getConsumer().getStatistics().history();
+
+  QVector<double> Times;
+  QVector<double> Rates;
+  double MaxRate{0};
+  for (const auto &[Time, Rate] : History) {
+    Times.push_back(Time);
+    Rates.push_back(Rate);
+    MaxRate = std::max(MaxRate, Rate);
+  }
+
+  mRateChart->graph(0)->setData(Times, Rates, true);
+  mRateChart->xAxis->setRange(Times.empty() ? -1.0 : std::min(Times.front(), -1.0), 0);
+  mRateChart->yAxis->setRange(0, std::max(MaxRate * 1.05, 1.0));
+  mRateChart->replot();
+}
+
+void MainWindow::addRoiPlot(int Roi, const QString &Name) {
+  if (mRoiTabs == nullptr) {
+    mRoiTabs = new QTabWidget(this);
+    mRoiTabs->setTabsClosable(true);
+    connect(mRoiTabs, &QTabWidget::tabCloseRequested, this,
+            &MainWindow::removeRoiPlot);
+
+    // Below the plots and the rate chart, across all columns
+    ui->gridLayout->addWidget(mRoiTabs, 2, 0, 1, -1);
+  }
+
+  Plots.push_back(
+      std::make_unique<TofPlot>(mConfig, mWorker->getConsumer(), Roi));
+  mRoiTabs->addTab(Plots.back().get(), Name);
+  mRoiTabs->setCurrentWidget(Plots.back().get());
+  schedulePlot(Plots.back().get());
+}
+
+void MainWindow::removeRoiPlot(int Index) {
+  auto *Plot = static_cast<TofPlot *>(mRoiTabs->widget(Index));
+  mWorker->getConsumer().removeRoi(Plot->getRoi());
+  mWorker->getConsumer().removeSubscriber(Plot->getSubscriber());
+  if (Scheduler != nullptr) {
+    Scheduler->remove(Plot);
+  }
+
+  // Deleting the plot also removes its tab
+  Plots.erase(std::find_if(Plots.begin(), Plots.end(),
+                           [Plot](const auto &P) { return P.get() == Plot; }));
+  // The tab widget is still emitting tabCloseRequested, delete it afterwards
+  if (mRoiTabs->count() == 0) {
+    ui->gridLayout->removeWidget(mRoiTabs);
+    mRoiTabs->hide();
+    mRoiTabs->deleteLater();
+    mRoiTabs = nullptr;
+  }
 }
 
 void MainWindow::startKafkaConsumerThread() {
@@ -189,23 +308,36 @@ void MainWindow::startKafkaConsumerThread() {
           &MainWindow::handleKafkaData);
 }
 
-void MainWindow::handleKafkaData(int ElapsedCountMS) {
+void MainWindow::handleKafkaData(int) {
   auto &Consumer = mWorker->getConsumer();
 
-  uint64_t EventRate = Consumer.getEventCount() * 1000ULL / ElapsedCountMS;
-  uint64_t EventAccept = Consumer.getEventAccept() * 1000ULL / ElapsedCountMS;
-  uint64_t EventDiscardRate = Consumer.getEventDiscard() * 1000ULL / ElapsedCountMS;
+  // Rates are sampled by the worker thread, no need to synchronize with it
+  const auto Rates = Consumer.getStatistics().rates();
   uint32_t BinSize = Consumer.getBinSize(mConfig.mPlot.Source);
 
-  ui->lblEventRateText->setText(QString::number(EventRate));
-  ui->lblAcceptRateText->setText(QString::number(EventAccept));
-  ui->lblDiscardedPixelsText->setText(QString::number(EventDiscardRate));
+  ui->lblEventRateText->setText(QString("%1 (avg %2, min %3, max %4)")
+                                    .arg(uint64_t(Rates.Count))
+                                    .arg(uint64_t(Rates.CountEwma))
+                                    .arg(uint64_t(Rates.CountMin))
+                                    .arg(uint64_t(Rates.CountMax)));
+  ui->lblAcceptRateText->setText(QString::number(uint64_t(Rates.Accept)));
+  ui->lblDiscardedPixelsText->setText(QString::number(uint64_t(Rates.Discard)));
   ui->lblBinSizeText->setText(QString("%1 %2").arg(BinSize).arg(mCount));
 
-  for (auto &Plot : Plots) {
-    Plot->updateData();
+  // Show backfill progress until done
+  const double Backfill = Consumer.getBackfillProgress();
+  ui->progressBackfill->setValue(static_cast<int>(100 * Backfill));
+  ui->progressBackfill->setVisible(Backfill < 1.0);
+
+  // Plots with a refresh rate of their own are updated by the scheduler
+  if (mConfig.mPlot.RefreshHz <= 0.0) {
+    for (auto &Plot : Plots) {
+      Plot->updateData();
+    }
+  }
+  if (mRateChart != nullptr) {
+    updateRateChart();
   }
-  Consumer.gotEventRequest();
 
   mCount += 1;
 }
@@ -317,7 +449,10 @@ void MainWindow::closeEvent(QCloseEvent *) {
   // If a windows is closed, we inform consumer to cancel the subscription
   // for the plot
   for (const auto &Plot: Plots) {
-    mWorker->getConsumer().addSubscriber(Plot->getPlotType(), false);
+    mWorker->getConsumer().removeSubscriber(Plot->getSubscriber());
+    if (Scheduler != nullptr) {
+      Scheduler->remove(Plot.get());
+    }
   }
 
   // Close daqlite, if no subscribers are left
@@ -19,8 +19,11 @@
 // Forward declarations
 class AbstractPlot;
 class HelpWindow;
+class PlotScheduler;
+class QCustomPlot;
 class QLineEdit;
 class QObject;
+class QTabWidget;
 class QToolButton;
 class QWidget;
 class WorkerThread;
@@ -46,6 +49,15 @@ public:
   /// \brief create the plot widgets
   void setupPlots();
 
+  /// \brief update a plot at plot.refresh_hz, if it is set
+  void schedulePlot(AbstractPlot *Plot);
+
+  /// \brief create the event rate strip chart below the plots
+  void setupRateChart();
+
+  /// \brief redraw the event rate strip chart
+  void updateRateChart();
+
   /// \brief spin up a thread for consuming topic
   void startKafkaConsumerThread();
 
@@ -77,17 +89,34 @@ public slots:
   /// Display the help window
   void showHelp();
 
+  /// \brief Show the TOF histogram of a new region of interest in a tab
+  /// \param Roi   Index of the region in the consumer
+  /// \param Name  Tab title
+  void addRoiPlot(int Roi, const QString &Name);
+
+  /// \brief Remove the region of interest shown in a tab
+  void removeRoiPlot(int Index);
+
 private:
   Ui::MainWindow *ui;
 
   std::vector<std::unique_ptr<AbstractPlot>> Plots;
 
+  /// \brief Optional event rate strip chart
+  QCustomPlot *mRateChart{nullptr};
+
+  /// \brief TOF plots of regions of interest, created with the first region
+  QTabWidget *mRoiTabs{nullptr};
+
   /// \brief Configuration obtained from ctor
   Configuration mConfig;
 
   /// \brief
   static HelpWindow *Helper;
 
+  /// \brief Updates plots with a refresh rate, shared by all windows
+  static PlotScheduler *Scheduler;
+
   // Pointer to worker thread
   WorkerThread *mWorker;
 
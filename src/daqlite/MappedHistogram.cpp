@@ -0,0 +1,210 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file MappedHistogram.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <MappedHistogram.h>
+
+#include <Configuration.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+constexpr char MAGIC[8] = {'D', 'Q', 'L', 'H', 'I', 'S', 'T', '1'};
+constexpr uint32_t VERSION{1};
+
+/// \brief Make a string usable as part of a file name
+std::string fileNamePart(std::string Name) {
+  std::replace_if(
+      Name.begin(), Name.end(),
+      [](unsigned char c) { return not(std::isalnum(c) or c == '-' or c == '_'); },
+      '_');
+  return Name;
+}
+} // namespace
+
+// clang-format off
+MappedHistogram::MappedHistogram(const Configuration &Config,
+                                 const std::string &DataName, size_t Bins)
+    : mConfig(Config) {
+  // clang-format on
+  const std::string &Directory = mConfig.mPlot.PersistentDirectory;
+
+  if (not Directory.empty() and not DataName.empty()) {
+    const std::string Source = mConfig.mPlot.Source == Configuration::EMPTY_SOURCE
+                                   ? std::string("all")
+                                   : mConfig.mPlot.Source;
+    mPath = fmt::format("{}/{}.{}.{}.hist", Directory,
+                        fileNamePart(mConfig.mName), fileNamePart(Source),
+                        fileNamePart(DataName));
+
+    mFd = open(mPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (mFd < 0) {
+      throw std::runtime_error(fmt::format("Unable to open histogram file {}: {}",
+                                           mPath, strerror(errno)));
+    }
+
+    // Another instance adding into the same file would double count
+    if (flock(mFd, LOCK_EX | LOCK_NB) != 0) {
+      fmt::print("Histogram file {} is in use by another plot or daqlite "
+                 "instance, keeping this histogram in memory\n", mPath);
+      close(mFd);
+      mFd = -1;
+      mPath.clear();
+    }
+  }
+
+  map(Bins);
+}
+
+MappedHistogram::~MappedHistogram() {
+  unmap();
+  if (mFd >= 0) {
+    close(mFd);
+  }
+}
+
+MappedHistogram::Header MappedHistogram::makeHeader(size_t Bins) const {
+  Header Hdr{};
+  memcpy(Hdr.Magic, MAGIC, sizeof(MAGIC));
+  Hdr.Version = VERSION;
+  Hdr.HeaderSize = sizeof(Header);
+  Hdr.Bins = Bins;
+  Hdr.XDim = mConfig.mGeometry.XDim;
+  Hdr.YDim = mConfig.mGeometry.YDim;
+  Hdr.ZDim = mConfig.mGeometry.ZDim;
+  Hdr.Offset = mConfig.mGeometry.Offset;
+  Hdr.TofScale = mConfig.mTOF.Scale;
+  Hdr.TofMaxValue = mConfig.mTOF.MaxValue;
+  Hdr.TofBinSize = mConfig.mTOF.BinSize;
+
+  // FNV-1a of the edges, so a changed non-uniform binning is not resumed
+  if (not mConfig.mTOF.BinEdges.empty()) {
+    uint32_t Hash{2166136261u};
+    const auto *Bytes =
+        reinterpret_cast<const uint8_t *>(mConfig.mTOF.BinEdges.data());
+    for (size_t i = 0; i < mConfig.mTOF.BinEdges.size() * sizeof(double); i++) {
+      Hash = (Hash ^ Bytes[i]) * 16777619u;
+    }
+    Hdr.TofEdgesHash = Hash;
+  }
+  return Hdr;
+}
+
+void MappedHistogram::map(size_t Bins) {
+  // Anonymous memory when not persistent
+  if (mFd < 0) {
+    mMappingSize = std::max<size_t>(Bins, 1) * sizeof(uint32_t);
+    mMapping = mmap(nullptr, mMappingSize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mMapping == MAP_FAILED) {
+      throw std::runtime_error("Unable to allocate histogram memory");
+    }
+    mData = static_cast<uint32_t *>(mMapping);
+    mBins = Bins;
+    return;
+  }
+
+  // Reuse the file if it was written for the same geometry and binning.
+  // Zero bins means the number of bins is taken from the file.
+  Header Existing{};
+  struct stat Stat{};
+  const bool Readable = fstat(mFd, &Stat) == 0 and
+                        pread(mFd, &Existing, sizeof(Header), 0) == sizeof(Header);
+  if (Bins == 0 and Readable) {
+    Bins = Existing.Bins;
+  }
+
+  const Header Expected = makeHeader(Bins);
+  const bool Matching =
+      Readable and
+      Stat.st_size == (off_t)(sizeof(Header) + Bins * sizeof(uint32_t)) and
+      memcmp(&Existing, &Expected, sizeof(Header)) == 0;
+
+  // The slices of a sliding window are not stored, so old counts could never
+  // expire from the window
+  mResumed = Matching and mConfig.mPlot.WindowSeconds == 0;
+
+  if (not mResumed) {
+    if (Matching) {
+      fmt::print("Histogram file {} not resumed for a sliding window plot\n",
+                 mPath);
+    } else if (Stat.st_size > 0) {
+      fmt::print("Histogram file {} does not match the configuration, "
+                 "starting from zero\n", mPath);
+    }
+    if (ftruncate(mFd, 0) != 0 or
+        ftruncate(mFd, sizeof(Header) + std::max<size_t>(Bins, 1) * sizeof(uint32_t)) != 0 or
+        pwrite(mFd, &Expected, sizeof(Header), 0) != sizeof(Header)) {
+      throw std::runtime_error(fmt::format(
+          "Unable to initialize histogram file {}: {}", mPath, strerror(errno)));
+    }
+  } else {
+    fmt::print("Resuming histogram from {}\n", mPath);
+  }
+
+  // An empty mapping is not possible
+  mMappingSize = sizeof(Header) + std::max<size_t>(Bins, 1) * sizeof(uint32_t);
+  mMapping = mmap(nullptr, mMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                  mFd, 0);
+  if (mMapping == MAP_FAILED) {
+    throw std::runtime_error(fmt::format("Unable to map histogram file {}: {}",
+                                         mPath, strerror(errno)));
+  }
+  mData = reinterpret_cast<uint32_t *>(static_cast<char *>(mMapping) +
+                                       sizeof(Header));
+  mBins = Bins;
+}
+
+void MappedHistogram::unmap() {
+  if (mMapping == nullptr) {
+    return;
+  }
+
+  if (mFd >= 0) {
+    msync(mMapping, mMappingSize, MS_ASYNC);
+  }
+  munmap(mMapping, mMappingSize);
+  mMapping = nullptr;
+  mData = nullptr;
+  mBins = 0;
+}
+
+void MappedHistogram::resize(size_t Bins) {
+  if (Bins == mBins) {
+    return;
+  }
+
+  // Keep the counts of the bins which remain
+  std::vector<uint32_t> Counts(begin(), begin() + std::min(Bins, mBins));
+
+  unmap();
+  if (mFd >= 0) {
+    // Make sure the header no longer matches, so the file is reinitialized
+    if (ftruncate(mFd, 0) != 0) {
+      throw std::runtime_error(fmt::format(
+          "Unable to resize histogram file {}: {}", mPath, strerror(errno)));
+    }
+  }
+  map(Bins);
+
+  std::copy(Counts.begin(), Counts.end(), mData);
+}
+
+void MappedHistogram::clear() {
+  std::fill(begin(), end(), 0);
+}
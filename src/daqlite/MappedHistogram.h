@@ -0,0 +1,109 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file MappedHistogram.h
+///
+/// \brief Plot accumulator optionally backed by a memory mapped file
+///
+/// Without a file the histogram lives in anonymous memory. With a file, the
+/// counts are written straight into the page cache, so they survive a daqlite
+/// restart or crash and are picked up again without any parsing or loading.
+/// A small header stores the geometry and TOF binning the counts belong to,
+/// and a file with a different header is started from zero. A file is locked
+/// while mapped, so a second plot or instance with the same file keeps its
+/// histogram in anonymous memory instead.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Forward declarations
+class Configuration;
+
+class MappedHistogram {
+public:
+  /// \brief File header, the counts follow directly after it
+  struct Header {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t HeaderSize;
+    uint64_t Bins;
+    int32_t XDim;
+    int32_t YDim;
+    int32_t ZDim;
+    int32_t Offset;
+    uint32_t TofScale;
+    uint32_t TofMaxValue;
+    uint32_t TofBinSize;
+    uint32_t TofEdgesHash; // zero for uniform TOF binning
+  };
+
+  /// \brief Create a histogram with a number of bins
+  /// \param Config    Plot configuration, provides geometry and TOF binning
+  ///                  and the directory for persistent histograms
+  /// \param DataName  Name of the data in the plot, e.g. "tof". Used for the
+  ///                  file name, together with config name and source.
+  ///                  Histograms without a name are never persistent
+  /// \param Bins      Initial number of bins. If zero, a persistent histogram
+  ///                  takes the number of bins from its file
+  MappedHistogram(const Configuration &Config, const std::string &DataName,
+                  size_t Bins);
+
+  /// \brief Flushes and unmaps the data
+  ~MappedHistogram();
+
+  MappedHistogram(const MappedHistogram &) = delete;
+  MappedHistogram &operator=(const MappedHistogram &) = delete;
+
+  /// \brief Change the number of bins, keeping existing counts
+  void resize(size_t Bins);
+
+  /// \brief Set all counts to zero
+  void clear();
+
+  uint32_t &operator[](size_t Index) { return mData[Index]; }
+  const uint32_t &operator[](size_t Index) const { return mData[Index]; }
+
+  uint32_t *data() { return mData; }
+  const uint32_t *data() const { return mData; }
+
+  size_t size() const { return mBins; }
+
+  uint32_t *begin() { return mData; }
+  uint32_t *end() { return mData + mBins; }
+  const uint32_t *begin() const { return mData; }
+  const uint32_t *end() const { return mData + mBins; }
+
+  /// \return true if counts from a previous run were picked up
+  bool resumed() const { return mResumed; }
+
+  /// \return the backing file, or an empty string if not persistent
+  const std::string &path() const { return mPath; }
+
+private:
+  /// \brief Map Bins counts, from the file if persistent
+  void map(size_t Bins);
+
+  /// \brief Unmap the current mapping
+  void unmap();
+
+  /// \return header matching the configuration and a number of bins
+  Header makeHeader(size_t Bins) const;
+
+  const Configuration &mConfig;
+
+  std::string mPath;
+  int mFd{-1};
+
+  /// \brief Start of the mapping, i.e. the header if persistent
+  void *mMapping{nullptr};
+  size_t mMappingSize{0};
+
+  uint32_t *mData{nullptr};
+  size_t mBins{0};
+
+  bool mResumed{false};
+};
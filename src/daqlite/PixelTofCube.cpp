@@ -0,0 +1,195 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file PixelTofCube.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <PixelTofCube.h>
+
+#include <Configuration.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <map>
+
+PixelTofCube::PixelTofCube(const Configuration &Config)
+    : mSource(Config.mPlot.Source)
+    , mPixels(Config.mGeometry.XDim * Config.mGeometry.YDim *
+                  Config.mGeometry.ZDim +
+              1)
+    , mTofBins(std::max(Config.mTOF.BinSize, 1u))
+    , mBudget(size_t(Config.mCube.MemoryMB) << 20) {
+  if (enabled()) {
+    allocate();
+  }
+}
+
+bool PixelTofCube::accepts(const std::string &Source) const {
+  return mSource == Configuration::EMPTY_SOURCE or Source == mSource;
+}
+
+void PixelTofCube::allocate() {
+  mCoarseBins = ((mTofBins - 1) >> mTofShift) + 1;
+  mPixelBlocks = ((mPixels - 1) >> BLOCK_BITS) + 1;
+  mTofBlocks = ((mCoarseBins - 1) >> BLOCK_BITS) + 1;
+
+  mBlocks.clear();
+  mBlocks.resize(size_t(mPixelBlocks) * mTofBlocks);
+  mBytes = mBlocks.size() * sizeof(mBlocks[0]);
+}
+
+void PixelTofCube::add(const std::vector<uint32_t> &Pixels,
+                       const std::vector<uint32_t> &TofBins) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (not enabled()) {
+    return;
+  }
+
+  const size_t Events = std::min(Pixels.size(), TofBins.size());
+  for (size_t i = 0; i < Events; i++) {
+    if (Pixels[i] >= mPixels or TofBins[i] >= mTofBins) {
+      continue;
+    }
+    const uint32_t CoarseBin = TofBins[i] >> mTofShift;
+    AdaptiveHistogram &Block = block(Pixels[i], CoarseBin);
+    const size_t Before = Block.bytes();
+    Block.add(cell(Pixels[i], CoarseBin));
+    mBytes += Block.bytes() - Before;
+  }
+
+  while (mBytes > mBudget and mCoarseBins > 1) {
+    coarsen();
+  }
+
+  // Coarser TOF bins do not help any further, so stop growing instead
+  if (mBytes > mBudget) {
+    fmt::print("Pixel x TOF cube over budget with a single TOF bin, "
+               "disabling it\n");
+    allocate();
+    mBudget = 0;
+  }
+}
+
+void PixelTofCube::coarsen() {
+  auto Blocks = std::move(mBlocks);
+  const uint32_t TofBlocks = mTofBlocks;
+
+  mTofShift++;
+  allocate();
+  fmt::print("Pixel x TOF cube over budget, using {} TOF bins\n", mCoarseBins);
+
+  for (size_t i = 0; i < Blocks.size(); i++) {
+    if (not Blocks[i]) {
+      continue;
+    }
+    const uint32_t FirstPixel = (i / TofBlocks) << BLOCK_BITS;
+    const uint32_t FirstBin = (i % TofBlocks) << BLOCK_BITS;
+    Blocks[i]->forEach([&](uint32_t Index, uint32_t Count) {
+      const uint32_t Pixel = FirstPixel + (Index >> BLOCK_BITS);
+      const uint32_t CoarseBin = (FirstBin + (Index & BLOCK_MASK)) >> 1;
+      block(Pixel, CoarseBin).add(cell(Pixel, CoarseBin), Count);
+    });
+    Blocks[i].reset();
+  }
+
+  mBytes = mBlocks.size() * sizeof(mBlocks[0]);
+  for (const auto &Block : mBlocks) {
+    mBytes += Block ? Block->bytes() : 0;
+  }
+}
+
+std::vector<uint32_t>
+PixelTofCube::tofSpectrum(const std::vector<uint32_t> &Pixels) const {
+  // One bit per pixel of each pixel block, so every block is visited once
+  std::map<uint32_t, uint64_t> Selected;
+  for (uint32_t Pixel : Pixels) {
+    if (Pixel < mPixels) {
+      Selected[Pixel >> BLOCK_BITS] |= uint64_t(1) << (Pixel & BLOCK_MASK);
+    }
+  }
+
+  std::vector<uint32_t> Coarse;
+  uint32_t Shift{0};
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Coarse.assign(mCoarseBins, 0);
+    Shift = mTofShift;
+    for (const auto &[PixelBlock, Mask] : Selected) {
+      for (uint32_t TofBlock = 0; TofBlock < mTofBlocks; TofBlock++) {
+        const auto &Block = mBlocks[size_t(PixelBlock) * mTofBlocks + TofBlock];
+        if (not Block) {
+          continue;
+        }
+        const uint32_t FirstBin = TofBlock << BLOCK_BITS;
+        Block->forEach([&, Mask = Mask](uint32_t Index, uint32_t Count) {
+          if ((Mask >> (Index >> BLOCK_BITS)) & 1) {
+            Coarse[FirstBin + (Index & BLOCK_MASK)] += Count;
+          }
+        });
+      }
+    }
+  }
+
+  // Spread coarse bins evenly over the configured bins
+  std::vector<uint32_t> Spectrum(mTofBins, 0);
+  for (uint32_t Bin = 0; Bin < Coarse.size(); Bin++) {
+    const uint32_t First = Bin << Shift;
+    const uint32_t Last = std::min((Bin + 1) << Shift, mTofBins);
+    const uint32_t Width = Last - First;
+    for (uint32_t Fine = First; Fine < Last; Fine++) {
+      Spectrum[Fine] = Coarse[Bin] / Width +
+                       ((Fine - First) < Coarse[Bin] % Width ? 1 : 0);
+    }
+  }
+  return Spectrum;
+}
+
+AdaptiveHistogram PixelTofCube::pixelMap(uint32_t FirstBin,
+                                         uint32_t LastBin) const {
+  AdaptiveHistogram Result(mPixels);
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (mCoarseBins == 0) {
+    return Result;
+  }
+  const uint32_t First = FirstBin >> mTofShift;
+  const uint32_t Last = std::min(LastBin >> mTofShift, mCoarseBins - 1);
+  for (uint32_t PixelBlock = 0; PixelBlock < mPixelBlocks; PixelBlock++) {
+    for (uint32_t TofBlock = First >> BLOCK_BITS;
+         TofBlock <= (Last >> BLOCK_BITS) and TofBlock < mTofBlocks;
+         TofBlock++) {
+      const auto &Block = mBlocks[size_t(PixelBlock) * mTofBlocks + TofBlock];
+      if (not Block) {
+        continue;
+      }
+      Block->forEach([&](uint32_t Index, uint32_t Count) {
+        const uint32_t Bin = (TofBlock << BLOCK_BITS) + (Index & BLOCK_MASK);
+        if (Bin >= First and Bin <= Last) {
+          Result.add((PixelBlock << BLOCK_BITS) + (Index >> BLOCK_BITS),
+                     Count);
+        }
+      });
+    }
+  }
+  return Result;
+}
+
+void PixelTofCube::clear() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (enabled()) {
+    mTofShift = 0;
+    allocate();
+  }
+}
+
+size_t PixelTofCube::bytes() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mBytes;
+}
+
+uint32_t PixelTofCube::tofShift() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mTofShift;
+}
@@ -0,0 +1,122 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file PixelTofCube.h
+///
+/// \brief Sparse pixel x TOF bin histogram for slicing on demand
+///
+/// The cube is split in blocks of 64 pixels x 64 TOF bins. A block is only
+/// allocated when the first event hits it, and is itself an AdaptiveHistogram
+/// which stays a compact hash of the hit cells until it is well occupied.
+/// The TOF spectrum of any set of pixels, e.g. of a new region of interest,
+/// and the pixel map of any TOF window are then sliced out of the cube
+/// without replaying events.
+///
+/// When the cube exceeds cube.memory_mb, the TOF axis is made twice as coarse
+/// by merging pairs of bins, until it fits again. Spectra are still returned
+/// with the configured TOF binning, the counts of a coarse bin are spread
+/// evenly over the bins it covers. A cube which does not fit even with a
+/// single TOF bin is disabled.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <AdaptiveHistogram.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Forward declarations
+class Configuration;
+
+class PixelTofCube {
+public:
+  /// \brief Cube for the pixels of the geometry and the configured TOF bins
+  /// of the plot source, disabled unless cube.memory_mb is set
+  PixelTofCube(const Configuration &Config);
+
+  /// \return true if events should be added
+  bool enabled() const { return mBudget.load() > 0; }
+
+  /// \return flat buffer source of the events, EMPTY_SOURCE for all sources
+  const std::string &source() const { return mSource; }
+
+  /// \return true if the events of a source belong in the cube
+  bool accepts(const std::string &Source) const;
+
+  /// \brief Add events, coarsening the TOF axis if over the memory budget
+  /// \param Pixels   Pixel ids, without the geometry offset
+  /// \param TofBins  TOF bin of each event
+  void add(const std::vector<uint32_t> &Pixels,
+           const std::vector<uint32_t> &TofBins);
+
+  /// \return summed TOF histogram of a set of pixels
+  std::vector<uint32_t> tofSpectrum(const std::vector<uint32_t> &Pixels) const;
+
+  /// \return pixel histogram of the events with FirstBin <= TOF bin <= LastBin.
+  /// After coarsening, coarse bins which overlap the window are included.
+  AdaptiveHistogram pixelMap(uint32_t FirstBin, uint32_t LastBin) const;
+
+  /// \brief Remove all counts and return to the configured TOF binning
+  void clear();
+
+  /// \return approximate memory used by the cube
+  size_t bytes() const;
+
+  /// \return number of times the TOF axis was made twice as coarse
+  uint32_t tofShift() const;
+
+private:
+  /// \brief log2 of the block size along both axes
+  static constexpr uint32_t BLOCK_BITS{6};
+  static constexpr uint32_t BLOCK_MASK{(1u << BLOCK_BITS) - 1};
+
+  /// \brief A hash slot takes two words, a dense cell one
+  static constexpr double BLOCK_OCCUPANCY{0.25};
+
+  /// \brief Allocate the block table for the current TOF binning
+  void allocate();
+
+  /// \brief Make the TOF axis twice as coarse, called with mMutex held
+  void coarsen();
+
+  /// \return block for a pixel and coarse TOF bin, allocated if needed
+  inline AdaptiveHistogram &block(uint32_t Pixel, uint32_t CoarseBin) {
+    auto &Block = mBlocks[(Pixel >> BLOCK_BITS) * mTofBlocks +
+                          (CoarseBin >> BLOCK_BITS)];
+    if (not Block) {
+      Block = std::make_unique<AdaptiveHistogram>(1u << (2 * BLOCK_BITS),
+                                                  BLOCK_OCCUPANCY);
+    }
+    return *Block;
+  }
+
+  /// \return index of a cell within its block
+  static uint32_t cell(uint32_t Pixel, uint32_t CoarseBin) {
+    return (Pixel & BLOCK_MASK) << BLOCK_BITS | (CoarseBin & BLOCK_MASK);
+  }
+
+  mutable std::mutex mMutex;
+
+  const std::string mSource;
+  uint32_t mPixels{0};
+  uint32_t mTofBins{0};
+  /// \brief Zero if disabled, set to zero when the cube can not fit
+  std::atomic<size_t> mBudget{0};
+
+  uint32_t mTofShift{0};
+  uint32_t mCoarseBins{0};
+  uint32_t mPixelBlocks{0};
+  uint32_t mTofBlocks{0};
+
+  /// \brief Pixel block major, null for blocks without counts
+  std::vector<std::unique_ptr<AdaptiveHistogram>> mBlocks;
+
+  /// \brief Memory used by the blocks and the block table
+  size_t mBytes{0};
+};
@@ -16,6 +16,7 @@
 #include <types/PlotType.h>
 
 #include <algorithm>
+#include <cmath>
 #include <fmt/format.h>
 #include <ratio>
 #include <string>
@@ -27,6 +28,10 @@ using std::vector;
 PixelsPlot::PixelsPlot(Configuration &Config, ESSConsumer &Consumer,
                        Projection Proj)
     : AbstractPlot(PlotType::PIXELS, Consumer, Config)
+    , HistogramData(Config, projectionName(Proj),
+                    Config.mGeometry.XDim * Config.mGeometry.YDim *
+                        Config.mGeometry.ZDim + 1)
+    , mWindow(Config, HistogramData.size())
     , mProjection(Proj) {
 // clang-format on
 
@@ -36,10 +41,10 @@ PixelsPlot::PixelsPlot(Configuration &Config, ESSConsumer &Consumer,
 
   auto &geom = mConfig.mGeometry;
   LogicalGeometry = new ESSGeometry(geom.XDim, geom.YDim, geom.ZDim, 1);
-  HistogramData.resize(LogicalGeometry->max_pixel() + 1);
 
   // this will also allow rescaling the color scale by dragging/zooming
   setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+  mRegionsEnabled = true;
 
   axisRect()->setupFullAxesBox(true);
 
@@ -51,8 +56,17 @@ PixelsPlot::PixelsPlot(Configuration &Config, ESSConsumer &Consumer,
 
   mColorMap = new QCPColorMap(xAxis, yAxis);
 
-  // we want the color map to have nx * ny data points
-  if (mProjection == ProjectionXY) {
+  // we want the color map to have nx * ny data points, or the cells of the
+  // display map
+  if (mProjection == ProjectionXY and not geom.DisplayMapFile.empty()) {
+    mDisplayMap = std::make_unique<DisplayMap>(geom.DisplayMapFile);
+    mCellData.assign(mDisplayMap->width() * mDisplayMap->height(), 0);
+    xAxis->setLabel("X");
+    yAxis->setLabel("Y");
+    mColorMap->data()->setSize(mDisplayMap->width(), mDisplayMap->height());
+    mColorMap->data()->setRange(QCPRange(0, mDisplayMap->width() - 1),
+                                QCPRange(0, mDisplayMap->height() - 1));
+  } else if (mProjection == ProjectionXY) {
     xAxis->setLabel("X");
     yAxis->setLabel("Y");
     mColorMap->data()->setSize(geom.XDim, geom.YDim);
@@ -99,9 +113,25 @@ PixelsPlot::PixelsPlot(Configuration &Config, ESSConsumer &Consumer,
   // rescale the key (x) and value (y) axes so the whole color map is visible:
   rescaleAxes();
 
+  // Show counts picked up from a previous run
+  if (HistogramData.resumed()) {
+    plotDetectorImage(true);
+  }
+
   t1 = std::chrono::high_resolution_clock::now();
 }
 
+std::string PixelsPlot::projectionName(Projection Proj) {
+  switch (Proj) {
+  case ProjectionXZ:
+    return "pixels_xz";
+  case ProjectionYZ:
+    return "pixels_yz";
+  default:
+    return "pixels_xy";
+  }
+}
+
 void PixelsPlot::setCustomParameters() {
   // set the color gradient of the color map to one of the presets:
   QCPColorGradient Gradient(getColorGradient(mConfig.mPlot.ColorGradient));
@@ -137,38 +167,62 @@ QCPColorGradient PixelsPlot::getColorGradient(const std::string &GradientName) {
 }
 
 void PixelsPlot::clearDetectorImage() {
-  std::fill(HistogramData.begin(), HistogramData.end(), 0);
+  HistogramData.clear();
+  mWindow.clear();
+  mConsumer.clearCube(mConfig.mPlot.Source);
   plotDetectorImage(true);
 }
 
+void PixelsPlot::setPixelCell(uint32_t Pixel, int64_t Delta) {
+  if (mDisplayMap) {
+    const uint32_t Cell = mDisplayMap->cell(Pixel);
+    if (Cell == DisplayMap::NO_CELL) {
+      return;
+    }
+    mCellData[Cell] += Delta;
+    mColorMap->data()->setCell(Cell % mDisplayMap->width(),
+                               Cell / mDisplayMap->width(), mCellData[Cell]);
+    return;
+  }
+
+  // if scales match the dimensions (xdim 400, range 0, 399) then cell indexes
+  // and coordinates match.
+  auto xIndex = LogicalGeometry->x(Pixel);
+  auto yIndex = LogicalGeometry->y(Pixel);
+  auto zIndex = LogicalGeometry->z(Pixel);
+
+  if (mProjection == ProjectionXY) {
+    mColorMap->data()->setCell(xIndex, yIndex, HistogramData[Pixel]);
+  } else if (mProjection == ProjectionXZ) {
+    mColorMap->data()->setCell(xIndex, zIndex, HistogramData[Pixel]);
+  } else {
+    mColorMap->data()->setCell(yIndex, zIndex, HistogramData[Pixel]);
+  }
+}
+
 void PixelsPlot::plotDetectorImage(bool Force) {
   setCustomParameters();
 
-  // if scales match the dimensions (xdim 400, range 0, 399) then cell indexes
-  // and coordinates match. PixelId 0 does not exist.
-  for (unsigned int i = 1; i < HistogramData.size(); i++) {
-    if ((HistogramData[i] != 0) or (Force)) {
-      auto xIndex = LogicalGeometry->x(i);
-      auto yIndex = LogicalGeometry->y(i);
-      auto zIndex = LogicalGeometry->z(i);
-
-      // here we could
-      // x, y, z = pos(i)
-
-      if (mProjection == ProjectionXY) {
-        // printf("XY: x,y,z %d, %d, %d: count %d\n", xIndex, yIndex, zIndex,
-        // HistogramData[i]);
-        mColorMap->data()->setCell(xIndex, yIndex, HistogramData[i]);
-      } else if (mProjection == ProjectionXZ) {
-        // printf("XZ: x,y,z %d, %d, %d: count %d\n", xIndex, yIndex, zIndex,
-        // HistogramData[i]);
-        mColorMap->data()->setCell(xIndex, zIndex, HistogramData[i]);
-      } else {
-        // printf("YZ: x,y,z %d, %d, %d: count %d\n", xIndex, yIndex, zIndex,
-        // HistogramData[i]);
-        mColorMap->data()->setCell(yIndex, zIndex, HistogramData[i]);
+  // Display map cells are summed again from all pixels, then all are drawn
+  if (mDisplayMap) {
+    std::fill(mCellData.begin(), mCellData.end(), 0);
+    for (uint32_t i = 1; i < HistogramData.size(); i++) {
+      const uint32_t Cell = mDisplayMap->cell(i);
+      if (Cell != DisplayMap::NO_CELL) {
+        mCellData[Cell] += HistogramData[i];
       }
     }
+    for (size_t Cell = 0; Cell < mCellData.size(); Cell++) {
+      mColorMap->data()->setCell(Cell % mDisplayMap->width(),
+                                 Cell / mDisplayMap->width(), mCellData[Cell]);
+    }
+  }
+
+  // PixelId 0 does not exist.
+  for (unsigned int i = 1; not mDisplayMap and i < HistogramData.size(); i++) {
+    if ((HistogramData[i] != 0) or (Force)) {
+      setPixelCell(i, HistogramData[i]);
+    }
   }
 
   // rescale the data dimension (color) such that all data points lie in the
@@ -185,26 +239,108 @@ void PixelsPlot::updateData() {
   // update histogram data from Consumer according to the source specified in
   // the config
   const std::string source = mConfig.mPlot.Source;
-  vector<uint32_t> Histogram = mConsumer.readData(DataType::HISTOGRAM, source);
+  AdaptiveHistogram Histogram = mConsumer.readHistogram(source, mSubscriber);
 
   int64_t nsBetweenClear = 1000000000LL * mConfig.mPlot.ClearEverySeconds;
   if (mConfig.mPlot.ClearPeriodic and (elapsed.count() >= nsBetweenClear)) {
     t1 = std::chrono::high_resolution_clock::now();
-    std::fill(HistogramData.begin(), HistogramData.end(), 0);
+    HistogramData.clear();
+    mWindow.clear();
+    mConsumer.clearCube(source);
 
     // Periodically clear the histogram
     plotDetectorImage(true);
   }
 
-  // Accumulate counts, PixelId 0 does not exist
-  for (unsigned int i = 1; i < Histogram.size(); i++) {
-    HistogramData[i] += Histogram[i];
+  // With a cube TOF window the whole map is sliced out of the cube instead
+  if (mConfig.mCube.TofMax > 0) {
+    HistogramData.clear();
+    mConsumer
+        .readCubePixelMap(source, mConfig.mCube.TofMin, mConfig.mCube.TofMax)
+        .forEach([this](uint32_t Pixel, uint32_t Count) {
+          if (Pixel != 0 and Pixel < HistogramData.size()) {
+            HistogramData[Pixel] = Count;
+          }
+        });
+    plotDetectorImage(true);
+    return;
   }
-  plotDetectorImage(false);
+
+  // Accumulate counts and update the cells of the pixels which received
+  // events, PixelId 0 does not exist
+  setCustomParameters();
+  Histogram.forEach([this](uint32_t Pixel, uint32_t Count) {
+    if (Pixel == 0 or Pixel >= HistogramData.size()) {
+      return;
+    }
+    HistogramData[Pixel] += Count;
+    mWindow.add(Pixel, Count);
+    setPixelCell(Pixel, Count);
+  });
+
+  // Subtract counts which have left the sliding window
+  mWindow.expire([this](uint32_t Pixel, uint32_t Count) {
+    HistogramData[Pixel] -= Count;
+    setPixelCell(Pixel, -int64_t(Count));
+  });
+
+  // rescale the data dimension (color) such that all data points lie in the
+  // span visualized by the color gradient:
+  mColorMap->rescaleDataRange(true);
+
+  replot();
 
   return;
 }
 
+void PixelsPlot::selectRegion(const QRectF &Region) {
+  // Cell indexes and coordinates match, see setPixelCell()
+  const int Left = std::round(Region.left());
+  const int Right = std::round(Region.right());
+  const int Top = std::round(Region.top());
+  const int Bottom = std::round(Region.bottom());
+
+  vector<uint32_t> Pixels;
+  for (uint32_t Pixel = 1; Pixel < HistogramData.size(); Pixel++) {
+    int A = LogicalGeometry->x(Pixel);
+    int B = LogicalGeometry->y(Pixel);
+    if (mDisplayMap) {
+      const uint32_t Cell = mDisplayMap->cell(Pixel);
+      if (Cell == DisplayMap::NO_CELL) {
+        continue;
+      }
+      A = Cell % mDisplayMap->width();
+      B = Cell / mDisplayMap->width();
+    } else if (mProjection == ProjectionXZ) {
+      B = LogicalGeometry->z(Pixel);
+    } else if (mProjection == ProjectionYZ) {
+      A = LogicalGeometry->y(Pixel);
+      B = LogicalGeometry->z(Pixel);
+    }
+    if (A >= Left and A <= Right and B >= Top and B <= Bottom) {
+      Pixels.push_back(Pixel);
+    }
+  }
+
+  if (Pixels.empty()) {
+    return;
+  }
+
+  const int Roi = mConsumer.addRoi(mConfig.mPlot.Source, Pixels);
+  if (Roi < 0) {
+    fmt::print("No more than {} regions of interest\n", ESSConsumer::MAX_ROIS);
+    return;
+  }
+
+  emit regionAdded(Roi, QString("%1 %2-%3, %4 %5-%6")
+                            .arg(xAxis->label())
+                            .arg(Left)
+                            .arg(Right)
+                            .arg(yAxis->label())
+                            .arg(Top)
+                            .arg(Bottom));
+}
+
 // MouseOver, display coordinate and data in tooltip
 void PixelsPlot::showPointToolTip(QMouseEvent *event) {
   int x = this->xAxis->pixelToCoord(event->pos().x());
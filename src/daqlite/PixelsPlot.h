@@ -9,11 +9,15 @@
 #pragma once
 
 #include <AbstractPlot.h>
+#include <DisplayMap.h>
+#include <MappedHistogram.h>
+#include <SlidingWindow.h>
 
 #include <QPlot/qcustomplot/qcustomplot.h>
 
 #include <stdint.h>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -31,8 +35,8 @@ public:
   /// \brief plot needs the configurable plotting options
   PixelsPlot(Configuration &Config, ESSConsumer&, Projection Proj);
 
-  /// \brief adds histogram data, clears periodically then calls
-  /// plotDetectorImage()
+  /// \brief adds histogram data and clears periodically. Only the cells of
+  /// pixels which received events are updated
   void updateData() override;
 
   /// \brief Support for different gradients
@@ -51,16 +55,44 @@ public:
 public slots:
   void showPointToolTip(QMouseEvent *event);
 
+signals:
+  /// \brief A region of interest was added to the consumer
+  /// \param Roi   Index of the region in the consumer
+  /// \param Name  Description of the region for display
+  void regionAdded(int Roi, const QString &Name);
+
 private:
+  /// \brief Add the pixels under a Shift + mouse rectangle as a region of
+  /// interest, all pixels along the projected axis are included
+  void selectRegion(const QRectF &Region) override;
+
+  /// \return name of the projection used for persistent histograms
+  static std::string projectionName(Projection Proj);
+
+  /// \brief copy the accumulated counts of a pixel to its color map cell
+  /// \param Delta  Change of the pixel counts, needed to keep the sum of
+  ///               several pixels in one display map cell
+  void setPixelCell(uint32_t Pixel, int64_t Delta);
+
   // QCustomPlot variables
   QCPColorScale *mColorScale{nullptr};
   QCPColorMap *mColorMap{nullptr};
 
-  std::vector<uint32_t> HistogramData;
+  /// \brief accumulated counts, optionally persistent
+  MappedHistogram HistogramData;
+
+  /// \brief recent deltas, to show a sliding window if configured
+  SlidingWindow mWindow;
 
   /// \brief for calculating x, y, z from pixelid
   ESSGeometry *LogicalGeometry;
 
+  /// \brief optional layout from geometry.display_map_file, XY plot only
+  std::unique_ptr<DisplayMap> mDisplayMap;
+
+  /// \brief summed counts per display map cell
+  std::vector<int64_t> mCellData;
+
   //
   Projection mProjection;
 
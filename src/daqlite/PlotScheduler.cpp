@@ -0,0 +1,93 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file PlotScheduler.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <PlotScheduler.h>
+
+#include <AbstractPlot.h>
+
+#include <algorithm>
+#include <tuple>
+
+PlotScheduler::PlotScheduler(QObject *parent) : QObject(parent) {
+  mTimer.setSingleShot(true);
+  mTimer.setTimerType(Qt::PreciseTimer);
+  connect(&mTimer, &QTimer::timeout, this, &PlotScheduler::run);
+  mClock.start();
+}
+
+void PlotScheduler::add(AbstractPlot *Plot, double RefreshHz, int Priority) {
+  const int64_t PeriodNs = static_cast<int64_t>(1e9 / RefreshHz);
+  mEntries.push_back({Plot, PeriodNs, Priority, mClock.nsecsElapsed(), 0});
+  schedule();
+}
+
+void PlotScheduler::remove(AbstractPlot *Plot) {
+  auto Found = [Plot](const Entry &E) { return E.Plot == Plot; };
+  mEntries.erase(std::remove_if(mEntries.begin(), mEntries.end(), Found),
+                 mEntries.end());
+  schedule();
+}
+
+void PlotScheduler::run() {
+  const int64_t Now = mClock.nsecsElapsed();
+
+  std::vector<Entry *> Due;
+  for (auto &E : mEntries) {
+    if (E.DueNs <= Now) {
+      Due.push_back(&E);
+    }
+  }
+
+  // Starving plots first, then by priority, then cheapest first
+  std::sort(Due.begin(), Due.end(), [Now](const Entry *A, const Entry *B) {
+    const bool StarvingA = Now - A->DueNs >= A->PeriodNs;
+    const bool StarvingB = Now - B->DueNs >= B->PeriodNs;
+    return std::make_tuple(not StarvingA, -A->Priority, A->CostNs) <
+           std::make_tuple(not StarvingB, -B->Priority, B->CostNs);
+  });
+
+  int64_t Spent = 0;
+  for (Entry *E : Due) {
+    // Leave the rest for the next turn, but always make progress
+    if (Spent >= BUDGET_NS) {
+      break;
+    }
+
+    const int64_t Start = mClock.nsecsElapsed();
+    E->Plot->updateData();
+    const int64_t End = mClock.nsecsElapsed();
+
+    const int64_t Cost = End - Start;
+    E->CostNs = E->CostNs == 0 ? Cost : (3 * E->CostNs + Cost) / 4;
+    Spent += Cost;
+
+    // Keep the cadence, but do not catch up on missed updates, and leave at
+    // least as much time to the others as the update took
+    int64_t Next = E->DueNs + E->PeriodNs;
+    if (Next <= End) {
+      Next = End + E->PeriodNs;
+    }
+    E->DueNs = std::max(Next, End + E->CostNs);
+  }
+
+  schedule();
+}
+
+void PlotScheduler::schedule() {
+  if (mEntries.empty()) {
+    mTimer.stop();
+    return;
+  }
+
+  int64_t Next = mEntries.front().DueNs;
+  for (const auto &E : mEntries) {
+    Next = std::min(Next, E.DueNs);
+  }
+
+  const int64_t DelayMs = (Next - mClock.nsecsElapsed()) / 1000000;
+  mTimer.start(static_cast<int>(std::max<int64_t>(0, DelayMs)));
+}
@@ -0,0 +1,65 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file PlotScheduler.h
+///
+/// \brief Updates plots at their own refresh rates on the GUI thread
+///
+/// Plots with a plot.refresh_hz are not updated together with the worker
+/// thread, but whenever they are due. Each turn of the event loop updates
+/// the due plots in order of plot.refresh_priority, cheapest first, until a
+/// time budget is used up; the rest follow in the next turn, after user input
+/// has been handled. Update times are measured, and a plot is never due again
+/// before as much time has passed as its last update took, so expensive
+/// windows can not starve cheap ones. A plot which has waited a full period
+/// beyond its due time goes first.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+#include <cstdint>
+#include <vector>
+
+// Forward declarations
+class AbstractPlot;
+
+class PlotScheduler : public QObject {
+  Q_OBJECT
+
+public:
+  explicit PlotScheduler(QObject *parent = nullptr);
+
+  /// \brief Update a plot RefreshHz times per second
+  /// \param Priority  Plots with higher priority are updated first
+  void add(AbstractPlot *Plot, double RefreshHz, int Priority);
+
+  /// \brief Stop updating a plot, unknown plots are ignored
+  void remove(AbstractPlot *Plot);
+
+private slots:
+  /// \brief Update the plots which are due
+  void run();
+
+private:
+  /// \brief Time spent on updates per turn of the event loop
+  static constexpr int64_t BUDGET_NS{40000000};
+
+  struct Entry {
+    AbstractPlot *Plot;
+    int64_t PeriodNs;
+    int Priority;
+    int64_t DueNs;
+    int64_t CostNs; // smoothed update time
+  };
+
+  /// \brief Start the timer for the next due plot
+  void schedule();
+
+  QTimer mTimer;
+  QElapsedTimer mClock;
+  std::vector<Entry> mEntries;
+};
@@ -0,0 +1,183 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file PulseRatePlot.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <PulseRatePlot.h>
+
+#include <AbstractPlot.h>
+#include <Configuration.h>
+#include <ESSConsumer.h>
+#include <types/PlotType.h>
+
+#include <QPlot/qcustomplot/qcustomplot.h>
+#include <QEvent>
+
+#include <algorithm>
+
+PulseRatePlot::PulseRatePlot(Configuration &Config, ESSConsumer &Consumer)
+    : AbstractPlot(PlotType::PULSE_RATE, Consumer, Config)
+    , mBinner(Config) {
+  // Register callback functions for events
+  connect(this, &QCustomPlot::mouseMove, this,
+          &PulseRatePlot::showPointToolTip);
+  setAttribute(Qt::WA_AlwaysShowToolTips);
+
+  setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+
+  axisRect()->setupFullAxesBox(true);
+
+  mGraph = new QCPGraph(xAxis, yAxis);
+  mGraph->setBrush(QBrush(QColor(0, 0, 255, 20)));
+  mGraph->setLineStyle(QCPGraph::lsLine);
+  mGraph->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssCircle, 3));
+
+  if (mConfig.mPlot.XAxis.empty()) {
+    xAxis->setLabel("Pulse time relative to newest pulse (s)");
+  } else {
+    xAxis->setLabel(mConfig.mPlot.XAxis.c_str());
+  }
+  yAxis->setLabel("Events per pulse");
+
+  // Shift + left mouse selects a window of pulses to merge
+  mRegionsEnabled = true;
+
+  mTofRect = new QCPAxisRect(this);
+  plotLayout()->addElement(1, 0, mTofRect);
+  mTofRect->setupFullAxesBox(true);
+  mTofGraph = new QCPGraph(mTofRect->axis(QCPAxis::atBottom),
+                           mTofRect->axis(QCPAxis::atLeft));
+  mTofGraph->setBrush(QBrush(QColor(0, 0, 255, 20)));
+  mTofGraph->setLineStyle(mBinner.uniform() ? QCPGraph::lsStepCenter
+                                            : QCPGraph::lsStepLeft);
+  mTofRect->axis(QCPAxis::atBottom)->setLabel("TOF (μs), Shift + drag above to select pulses");
+  mTofRect->axis(QCPAxis::atLeft)->setLabel("Counts");
+
+  const PulseRing &Pulses = mConsumer.getPulses();
+  if (Pulses.hasPixels()) {
+    mPixelRect = new QCPAxisRect(this);
+    plotLayout()->addElement(2, 0, mPixelRect);
+    mPixelMap = new QCPColorMap(mPixelRect->axis(QCPAxis::atBottom),
+                                mPixelRect->axis(QCPAxis::atLeft));
+    mPixelMap->data()->setSize(Pulses.coarseXDim(), Pulses.coarseYDim());
+    mPixelMap->data()->setRange(QCPRange(0, Pulses.coarseXDim() - 1),
+                                QCPRange(0, Pulses.coarseYDim() - 1));
+    mPixelMap->setGradient(QCPColorGradient::gpHot);
+    mPixelMap->setInterpolate(false);
+    mPixelMap->setTightBoundary(false);
+    mPixelRect->axis(QCPAxis::atBottom)->setLabel("Coarse pixel x");
+    mPixelRect->axis(QCPAxis::atLeft)->setLabel("Coarse pixel y");
+    mPixelRect->axis(QCPAxis::atBottom)->setRange(-0.5, Pulses.coarseXDim() - 0.5);
+    mPixelRect->axis(QCPAxis::atLeft)->setRange(-0.5, Pulses.coarseYDim() - 0.5);
+  }
+
+  setCustomParameters();
+}
+
+void PulseRatePlot::setCustomParameters() {
+  if (mConfig.mPlot.LogScale) {
+    yAxis->setScaleType(QCPAxis::stLogarithmic);
+  } else {
+    yAxis->setScaleType(QCPAxis::stLinear);
+  }
+}
+
+void PulseRatePlot::plotDetectorImage(bool) {
+  setCustomParameters();
+  mGraph->data()->clear();
+
+  const auto Counts = mConsumer.getPulses().counts();
+  if (Counts.empty()) {
+    plotPulseWindow();
+    replot();
+    return;
+  }
+
+  // Reference times are in ns, show seconds before the newest pulse
+  const int64_t Newest = Counts.back().first;
+  mNewest = Newest;
+  uint64_t MaxY{0};
+  for (const auto &[Time, Events] : Counts) {
+    if (Time <= mClearedTime) {
+      continue;
+    }
+    mGraph->addData((Time - Newest) / 1e9, Events);
+    MaxY = std::max(MaxY, Events);
+  }
+
+  const double Oldest = (Counts.front().first - Newest) / 1e9;
+  xAxis->setRange(std::min(Oldest, -1.0), 0);
+  yAxis->setRange(0, MaxY * 1.05);
+
+  plotPulseWindow();
+  replot();
+}
+
+void PulseRatePlot::selectRegion(const QRectF &Region) {
+  mPulseWindow = std::make_pair(mNewest + int64_t(Region.left() * 1e9),
+                                mNewest + int64_t(Region.right() * 1e9));
+  plotDetectorImage(true);
+}
+
+void PulseRatePlot::plotPulseWindow() {
+  mTofGraph->data()->clear();
+  if (mPixelMap != nullptr) {
+    mPixelMap->data()->fill(0);
+  }
+  if (not mPulseWindow) {
+    return;
+  }
+
+  // The window is kept in reference times, so it moves back in the strip
+  // chart as new pulses arrive, and empties once its pulses left the ring
+  const auto [First, Last] = *mPulseWindow;
+  const PulseSummary Merged =
+      mConsumer.getPulses().merge(std::max(First, mClearedTime + 1), Last);
+
+  uint32_t MaxY{0};
+  for (uint32_t i = 0; i < Merged.Tof.size(); i++) {
+    const double x = mBinner.uniform()
+                         ? double(i) * mConfig.mTOF.MaxValue / mConfig.mTOF.BinSize
+                         : mBinner.lowerEdge(i);
+    mTofGraph->addData(x, Merged.Tof[i]);
+    MaxY = std::max(MaxY, Merged.Tof[i]);
+  }
+  mTofRect->axis(QCPAxis::atBottom)
+      ->setLabel(QString("TOF (μs) of %1 events in pulses %2 s to %3 s")
+                     .arg(Merged.Events)
+                     .arg((First - mNewest) / 1e9)
+                     .arg((Last - mNewest) / 1e9));
+  mTofGraph->rescaleKeyAxis();
+  mTofRect->axis(QCPAxis::atLeft)->setRange(0, MaxY * 1.05);
+
+  if (mPixelMap != nullptr) {
+    const uint32_t Columns = mConsumer.getPulses().coarseXDim();
+    Merged.Pixels.forEach([this, Columns](uint32_t Bin, uint32_t Count) {
+      mPixelMap->data()->setCell(Bin % Columns, Bin / Columns, Count);
+    });
+    mPixelMap->rescaleDataRange(true);
+  }
+}
+
+void PulseRatePlot::updateData() {
+  plotDetectorImage(false);
+}
+
+void PulseRatePlot::clearDetectorImage() {
+  mPulseWindow.reset();
+  const auto Counts = mConsumer.getPulses().counts();
+  if (not Counts.empty()) {
+    mClearedTime = Counts.back().first;
+  }
+  plotDetectorImage(true);
+}
+
+// MouseOver, display coordinate and data in tooltip
+void PulseRatePlot::showPointToolTip(QMouseEvent *event) {
+  double x = this->xAxis->pixelToCoord(event->pos().x());
+  double y = this->yAxis->pixelToCoord(event->pos().y());
+
+  setToolTip(QString("Time: %1 s, Events: %2").arg(x).arg(int64_t(y)));
+}
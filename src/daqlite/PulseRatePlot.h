@@ -0,0 +1,76 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file PulseRatePlot.h
+///
+/// \brief Strip chart of the number of events per pulse
+///
+/// A window of pulses selected with Shift + left mouse is merged into a TOF
+/// spectrum, and a coarse pixel map if pulse.pixel_binning is set, shown
+/// below the strip chart.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <AbstractPlot.h>
+#include <Binner.h>
+
+#include <optional>
+#include <stdint.h>
+#include <utility>
+
+// Forward declarations
+class Configuration;
+class ESSConsumer;
+class QCPAxisRect;
+class QCPColorMap;
+class QCPGraph;
+class QMouseEvent;
+
+class PulseRatePlot : public AbstractPlot {
+  Q_OBJECT
+public:
+  /// \brief plot needs the configurable plotting options
+  PulseRatePlot(Configuration &Config, ESSConsumer &Consumer);
+
+  /// \brief redraws the pulses currently held by the consumer
+  void updateData() override;
+
+  /// \brief update plot based on (possibly dynamic) config settings
+  void setCustomParameters();
+
+  /// \brief hides the pulses received so far
+  void clearDetectorImage() override;
+
+public slots:
+  void showPointToolTip(QMouseEvent *event);
+
+private:
+  /// \brief updates the image
+  /// \param Force unused, the strip chart is always redrawn
+  void plotDetectorImage(bool Force) override;
+
+  /// \brief Select the pulses between the horizontal edges of the region
+  void selectRegion(const QRectF &Region) override;
+
+  /// \brief Draw the merged pulses of the selected window
+  void plotPulseWindow();
+
+  // QCustomPlot variables
+  QCPGraph *mGraph{nullptr};
+  QCPAxisRect *mTofRect{nullptr};
+  QCPGraph *mTofGraph{nullptr};
+  QCPAxisRect *mPixelRect{nullptr};
+  QCPColorMap *mPixelMap{nullptr};
+
+  Binner mBinner;
+
+  /// \brief Reference time of the newest pulse drawn, in ns
+  int64_t mNewest{0};
+
+  /// \brief First and last reference time of the selected pulses, in ns
+  std::optional<std::pair<int64_t, int64_t>> mPulseWindow;
+
+  /// \brief pulses up to this reference time are not shown after a clear
+  int64_t mClearedTime{INT64_MIN};
+};
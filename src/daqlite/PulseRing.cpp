@@ -0,0 +1,102 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file PulseRing.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <PulseRing.h>
+
+#include <Configuration.h>
+
+#include <algorithm>
+
+PulseRing::PulseRing(const Configuration &Config)
+    : mRing(std::max<uint32_t>(Config.mPulse.RingSize, 1))
+    , mTofBins(Config.mTOF.BinSize)
+    , mXDim(std::max(Config.mGeometry.XDim, 1))
+    , mYDim(std::max(Config.mGeometry.YDim, 1))
+    , mBinning(Config.mPulse.PixelBinning) {
+  if (mBinning > 0) {
+    mCoarseXDim = (mXDim + mBinning - 1) / mBinning;
+    mCoarseYDim = (mYDim + mBinning - 1) / mBinning;
+  }
+}
+
+PulseSummary PulseRing::makeSummary(int64_t ReferenceTime) const {
+  PulseSummary Pulse;
+  Pulse.ReferenceTime = ReferenceTime;
+  Pulse.Tof.assign(mTofBins, 0);
+  Pulse.Pixels = AdaptiveHistogram(mCoarseXDim * mCoarseYDim);
+  return Pulse;
+}
+
+void PulseRing::add(const PulseSummary &Pulse) {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  // A pulse split over several messages is normally among the newest pulses
+  const size_t Depth = std::min(mCount, MERGE_DEPTH);
+  for (size_t i = 1; i <= Depth; i++) {
+    PulseSummary &Stored = mRing[(mNext + mRing.size() - i) % mRing.size()];
+    if (Stored.ReferenceTime != Pulse.ReferenceTime) {
+      continue;
+    }
+
+    Stored.Events += Pulse.Events;
+    for (size_t Bin = 0; Bin < std::min(Stored.Tof.size(), Pulse.Tof.size());
+         Bin++) {
+      Stored.Tof[Bin] += Pulse.Tof[Bin];
+    }
+    Stored.Pixels.merge(Pulse.Pixels);
+    return;
+  }
+
+  mRing[mNext] = Pulse;
+  mNext = (mNext + 1) % mRing.size();
+  mCount = std::min(mCount + 1, mRing.size());
+}
+
+std::vector<std::pair<int64_t, uint64_t>> PulseRing::counts() const {
+  std::vector<std::pair<int64_t, uint64_t>> Result;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Result.reserve(mCount);
+    for (size_t i = mCount; i > 0; i--) {
+      const PulseSummary &Pulse =
+          mRing[(mNext + mRing.size() - i) % mRing.size()];
+      Result.emplace_back(Pulse.ReferenceTime, Pulse.Events);
+    }
+  }
+
+  // Messages from different producers can arrive slightly out of order
+  std::sort(Result.begin(), Result.end());
+  return Result;
+}
+
+PulseSummary PulseRing::merge(int64_t First, int64_t Last) const {
+  PulseSummary Result = makeSummary(First);
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (size_t i = 0; i < mCount; i++) {
+    const PulseSummary &Pulse = mRing[(mNext + mRing.size() - mCount + i) %
+                                      mRing.size()];
+    if (Pulse.ReferenceTime < First or Pulse.ReferenceTime > Last) {
+      continue;
+    }
+
+    Result.Events += Pulse.Events;
+    for (size_t Bin = 0; Bin < std::min(Result.Tof.size(), Pulse.Tof.size());
+         Bin++) {
+      Result.Tof[Bin] += Pulse.Tof[Bin];
+    }
+    Result.Pixels.merge(Pulse.Pixels);
+  }
+
+  return Result;
+}
+
+void PulseRing::clear() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mNext = 0;
+  mCount = 0;
+}
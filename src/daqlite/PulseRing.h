@@ -0,0 +1,101 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file PulseRing.h
+///
+/// \brief Bounded ring of per-pulse summaries built from ev44 reference times
+///
+/// The consumer groups the events of each ev44 message by pulse, using
+/// reference_time and reference_time_index, and stores one summary per pulse:
+/// the number of accepted events, a TOF histogram and optionally a coarse
+/// pixel map. Events of a pulse which is split over several messages end up
+/// in the same summary. Plots only merge the small summaries, the per event
+/// work is done once while decoding.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <AdaptiveHistogram.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Forward declarations
+class Configuration;
+
+/// \brief Data of one pulse
+struct PulseSummary {
+  /// \brief Pulse time in ns since epoch, as in ev44 reference_time
+  int64_t ReferenceTime{0};
+
+  /// \brief Number of accepted events
+  uint64_t Events{0};
+
+  /// \brief TOF histogram with the configured TOF binning
+  std::vector<uint32_t> Tof;
+
+  /// \brief Coarse pixel map, empty unless pulse.pixel_binning is set
+  AdaptiveHistogram Pixels;
+};
+
+class PulseRing {
+public:
+  /// \brief Ring with pulse.ring_size entries and the TOF binning and
+  /// geometry of the configuration
+  PulseRing(const Configuration &Config);
+
+  /// \return an empty summary for a pulse, with histograms of the right size
+  PulseSummary makeSummary(int64_t ReferenceTime) const;
+
+  /// \return coarse pixel map bin for a pixel (1 based, without offset)
+  inline uint32_t coarsePixel(uint32_t Pixel) const {
+    const uint32_t X = (Pixel - 1) % mXDim;
+    const uint32_t Y = (Pixel - 1) / mXDim % mYDim;
+    return (Y / mBinning) * mCoarseXDim + X / mBinning;
+  }
+
+  /// \return true if summaries include a coarse pixel map
+  bool hasPixels() const { return mBinning > 0; }
+
+  /// \brief Add a pulse, merging with a stored pulse of the same time and
+  /// evicting the oldest pulse if the ring is full
+  void add(const PulseSummary &Pulse);
+
+  /// \return reference time and event count of all stored pulses, in time
+  /// order
+  std::vector<std::pair<int64_t, uint64_t>> counts() const;
+
+  /// \return sum of all stored pulses with First <= reference time <= Last
+  PulseSummary merge(int64_t First, int64_t Last) const;
+
+  /// \brief Remove all pulses
+  void clear();
+
+  /// \return number of coarse pixel map columns and rows
+  uint32_t coarseXDim() const { return mCoarseXDim; }
+  uint32_t coarseYDim() const { return mCoarseYDim; }
+
+private:
+  /// \brief Number of recent pulses searched for a pulse split over messages
+  static constexpr size_t MERGE_DEPTH{16};
+
+  mutable std::mutex mMutex;
+
+  std::vector<PulseSummary> mRing;
+
+  /// \brief Slot for the next new pulse
+  size_t mNext{0};
+
+  /// \brief Number of stored pulses
+  size_t mCount{0};
+
+  uint32_t mTofBins{0};
+  uint32_t mXDim{1};
+  uint32_t mYDim{1};
+  uint32_t mBinning{0};
+  uint32_t mCoarseXDim{0};
+  uint32_t mCoarseYDim{0};
+};
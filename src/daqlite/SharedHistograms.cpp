@@ -0,0 +1,347 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file SharedHistograms.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <SharedHistograms.h>
+
+#include <Configuration.h>
+#include <ESSConsumer.h>
+#include <types/DataType.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+
+namespace {
+constexpr char MAGIC[8] = {'D', 'Q', 'L', 'S', 'H', 'M', '0', '1'};
+constexpr uint32_t VERSION{2};
+
+/// \brief Number of reader attempts before giving up on a copy
+constexpr int MAX_READ_ATTEMPTS{1000};
+
+/// \brief Viewer reattaches if no new epoch is seen for this many calls
+constexpr int STALE_SYNCHRONIZATIONS{5};
+} // namespace
+
+SharedHistograms::SharedHistograms(const Configuration &Config,
+                                   const std::vector<std::string> &Sources)
+    : mName(Config.mSharedMemory.Name)
+    , mPublisher(Config.mSharedMemory.Mode == PUBLISH) {
+  auto &geom = Config.mGeometry;
+
+  // PixelId 0 does not exist, index 1 to N holds the pixel counts
+  mPixelBins = geom.XDim * geom.YDim * geom.ZDim + 1;
+  mTofBins = Config.mTOF.BinSize;
+
+  // A da00 histogram shares the pixel counts, so it has at most as many bins
+  mEdgeCapacity = std::min(mPixelBins, MAX_EDGE_BINS) + 1;
+
+  if (mPublisher) {
+    create(Sources);
+  } else {
+    attach();
+  }
+}
+
+SharedHistograms::~SharedHistograms() {
+  detach();
+  if (mPublisher) {
+    shm_unlink(mName.c_str());
+  }
+}
+
+size_t SharedHistograms::segmentSize(size_t SourceCount) const {
+  return sizeof(Header) +
+         SourceCount * (mPixelBins + mTofBins) * sizeof(uint64_t) +
+         SourceCount * mEdgeCapacity * sizeof(double);
+}
+
+uint64_t *SharedHistograms::histograms(size_t SourceIndex) const {
+  auto Base = reinterpret_cast<char *>(mHeader) + sizeof(Header);
+  return reinterpret_cast<uint64_t *>(Base) +
+         SourceIndex * (mPixelBins + mTofBins);
+}
+
+double *SharedHistograms::edges(size_t SourceIndex) const {
+  auto Base = reinterpret_cast<char *>(histograms(mHeader->SourceCount));
+  return reinterpret_cast<double *>(Base) + SourceIndex * mEdgeCapacity;
+}
+
+void SharedHistograms::create(const std::vector<std::string> &Sources) {
+  std::vector<std::string> Names = Sources;
+  if (Names.empty()) {
+    Names.emplace_back(Configuration::EMPTY_SOURCE);
+  }
+
+  if (Names.size() > MAX_SOURCES) {
+    throw std::runtime_error(
+        fmt::format("Too many sources for shared memory ({} > {})",
+                    Names.size(), MAX_SOURCES));
+  }
+
+  // Remove a segment left behind by a crashed publisher
+  shm_unlink(mName.c_str());
+
+  int Fd = shm_open(mName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (Fd < 0) {
+    throw std::runtime_error(fmt::format(
+        "Unable to create shared memory {}: {}", mName, strerror(errno)));
+  }
+
+  mSize = segmentSize(Names.size());
+  if (ftruncate(Fd, mSize) != 0) {
+    close(Fd);
+    throw std::runtime_error(fmt::format(
+        "Unable to size shared memory {}: {}", mName, strerror(errno)));
+  }
+
+  void *Addr = mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+  close(Fd);
+  if (Addr == MAP_FAILED) {
+    throw std::runtime_error(fmt::format(
+        "Unable to map shared memory {}: {}", mName, strerror(errno)));
+  }
+
+  // The segment is zero filled by ftruncate(), so only the header needs setup
+  mHeader = new (Addr) Header();
+  mHeader->Version = VERSION;
+  mHeader->PixelBins = mPixelBins;
+  mHeader->TofBins = mTofBins;
+  mHeader->SourceCount = Names.size();
+  mHeader->EdgeCapacity = mEdgeCapacity;
+  mHeader->Session =
+      (static_cast<uint64_t>(getpid()) << 32) ^
+      static_cast<uint64_t>(
+          std::chrono::system_clock::now().time_since_epoch().count());
+  for (size_t i = 0; i < Names.size(); i++) {
+    strncpy(mHeader->Sources[i], Names[i].c_str(), MAX_SOURCE_NAME - 1);
+  }
+
+  // Readers check the magic, so write it once everything else is in place
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(mHeader->Magic, MAGIC, sizeof(MAGIC));
+  mHeader->Sequence.store(0, std::memory_order_release);
+
+  fmt::print("Publishing histograms to shared memory {} ({} bytes)\n", mName,
+             mSize);
+}
+
+bool SharedHistograms::attach() {
+  int Fd = shm_open(mName.c_str(), O_RDONLY, 0);
+  if (Fd < 0) {
+    return false;
+  }
+
+  struct stat Stat;
+  if (fstat(Fd, &Stat) != 0 or Stat.st_size < (off_t)sizeof(Header)) {
+    close(Fd);
+    return false;
+  }
+
+  void *Addr = mmap(nullptr, Stat.st_size, PROT_READ, MAP_SHARED, Fd, 0);
+  close(Fd);
+  if (Addr == MAP_FAILED) {
+    return false;
+  }
+
+  auto Segment = reinterpret_cast<Header *>(Addr);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  bool Valid = memcmp(Segment->Magic, MAGIC, sizeof(MAGIC)) == 0 and
+               Segment->Version == VERSION and
+               Segment->SourceCount <= MAX_SOURCES and
+               (size_t)Stat.st_size >= segmentSize(Segment->SourceCount);
+
+  if (Valid and (Segment->PixelBins != mPixelBins or
+                 Segment->TofBins != mTofBins or
+                 Segment->EdgeCapacity != mEdgeCapacity)) {
+    fmt::print("Shared memory {} geometry/TOF binning ({}, {}) does not match "
+               "configuration ({}, {})\n",
+               mName, Segment->PixelBins, Segment->TofBins, mPixelBins,
+               mTofBins);
+    Valid = false;
+  }
+
+  if (not Valid) {
+    munmap(Addr, Stat.st_size);
+    return false;
+  }
+
+  mHeader = Segment;
+  mSize = Stat.st_size;
+
+  // A new publisher starts counting from zero
+  if (mHeader->Session != mSession) {
+    size_t Values = mHeader->SourceCount * (mPixelBins + mTofBins);
+    mLast.assign(Values, 0);
+    std::fill(std::begin(mLastCounts), std::end(mLastCounts), 0);
+    mEdges.assign(mHeader->SourceCount, {});
+    mSession = mHeader->Session;
+    mSequence = 1;
+    fmt::print("Viewing histograms from shared memory {}\n", mName);
+  }
+  mCurrent.resize(mLast.size());
+
+  return true;
+}
+
+void SharedHistograms::detach() {
+  if (mHeader != nullptr) {
+    munmap(mHeader, mSize);
+    mHeader = nullptr;
+    mSize = 0;
+  }
+}
+
+void SharedHistograms::synchronize(ESSConsumer &Consumer) {
+  if (mPublisher) {
+    publish(Consumer);
+  } else {
+    view(Consumer);
+  }
+}
+
+void SharedHistograms::publish(ESSConsumer &Consumer) {
+  // Collect data outside the write section to keep it short
+  auto Pixels = Consumer.takeHistograms();
+  auto Tofs = Consumer.takeData(DataType::HISTOGRAM_TOF);
+  std::vector<std::vector<double>> Edges(mHeader->SourceCount);
+  for (size_t i = 0; i < mHeader->SourceCount; i++) {
+    Edges[i] = Consumer.readBinEdges(mHeader->Sources[i]);
+    if (Edges[i].size() > mEdgeCapacity) {
+      Edges[i].clear();
+    }
+  }
+
+  auto &Sequence = mHeader->Sequence;
+  const uint64_t Seq = Sequence.load(std::memory_order_relaxed);
+  Sequence.store(Seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for (size_t i = 0; i < mHeader->SourceCount; i++) {
+    uint64_t *Values = histograms(i);
+
+    // Only the pixels which received events are touched
+    if (auto It = Pixels.find(mHeader->Sources[i]); It != Pixels.end()) {
+      It->second.forEach([this, Values](uint32_t Pixel, uint32_t Count) {
+        if (Pixel < mPixelBins) {
+          Values[Pixel] += Count;
+        }
+      });
+    }
+
+    Values += mPixelBins;
+    if (auto It = Tofs.find(mHeader->Sources[i]); It != Tofs.end()) {
+      const size_t Bins = std::min<size_t>(It->second.size(), mTofBins);
+      for (size_t j = 0; j < Bins; j++) {
+        Values[j] += It->second[j];
+      }
+    }
+
+    mHeader->EdgeCounts[i] = Edges[i].size();
+    std::copy(Edges[i].begin(), Edges[i].end(), edges(i));
+  }
+
+  mHeader->EventCount = Consumer.getEventCount();
+  mHeader->EventAccept = Consumer.getEventAccept();
+  mHeader->EventDiscard = Consumer.getEventDiscard();
+  mHeader->Epoch++;
+
+  Sequence.store(Seq + 2, std::memory_order_release);
+}
+
+void SharedHistograms::view(ESSConsumer &Consumer) {
+  if (mHeader == nullptr and not attach()) {
+    return;
+  }
+
+  // A publisher which went away leaves a stale segment, so try reattaching
+  // by name until a live one shows up. Nothing is copied meanwhile.
+  auto &Sequence = mHeader->Sequence;
+  if (Sequence.load(std::memory_order_acquire) == mSequence) {
+    if (++mStaleCount >= STALE_SYNCHRONIZATIONS) {
+      mStaleCount = 0;
+      detach();
+    }
+    return;
+  }
+
+  uint64_t Counts[3];
+  uint32_t EdgeCounts[MAX_SOURCES];
+  std::vector<double> Edges(mHeader->SourceCount * mEdgeCapacity);
+  bool Copied{false};
+
+  const size_t Bytes = mCurrent.size() * sizeof(uint64_t);
+  for (int Attempt = 0; Attempt < MAX_READ_ATTEMPTS and not Copied; Attempt++) {
+    const uint64_t Seq = Sequence.load(std::memory_order_acquire);
+    if (Seq & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    Counts[0] = mHeader->EventCount;
+    Counts[1] = mHeader->EventAccept;
+    Counts[2] = mHeader->EventDiscard;
+    memcpy(EdgeCounts, mHeader->EdgeCounts, sizeof(EdgeCounts));
+    memcpy(mCurrent.data(), histograms(0), Bytes);
+    memcpy(Edges.data(), edges(0), Edges.size() * sizeof(double));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    Copied = Sequence.load(std::memory_order_relaxed) == Seq;
+    mSequence = Seq;
+  }
+
+  if (not Copied) {
+    return;
+  }
+  mStaleCount = 0;
+
+  std::vector<uint32_t> Delta;
+  for (size_t i = 0; i < mHeader->SourceCount; i++) {
+    const std::string Source(mHeader->Sources[i]);
+    const size_t Base = i * (mPixelBins + mTofBins);
+
+    // The edges come first, so that a HistogramPlot never sees counts without their edges
+    const double *First = Edges.data() + i * mEdgeCapacity;
+    const size_t EdgeCount = std::min(EdgeCounts[i], mEdgeCapacity);
+    if (not std::equal(First, First + EdgeCount, mEdges[i].begin(),
+                       mEdges[i].end())) {
+      mEdges[i].assign(First, First + EdgeCount);
+      Consumer.setBinEdges(Source, mEdges[i]);
+    }
+
+    for (auto [Type, Offset, Bins] :
+         {std::make_tuple(DataType::HISTOGRAM, size_t{0}, mPixelBins),
+          std::make_tuple(DataType::HISTOGRAM_TOF, size_t{mPixelBins},
+                          mTofBins)}) {
+      const auto Current = mCurrent.begin() + Base + Offset;
+      if (std::equal(Current, Current + Bins, mLast.begin() + Base + Offset)) {
+        continue;
+      }
+
+      Delta.resize(Bins);
+      std::transform(Current, Current + Bins, mLast.begin() + Base + Offset,
+                     Delta.begin(), std::minus<uint64_t>());
+      Consumer.addData(DataType(Type), Source, Delta);
+    }
+  }
+
+  Consumer.addEventCounts(Counts[0] - mLastCounts[0],
+                          Counts[1] - mLastCounts[1],
+                          Counts[2] - mLastCounts[2]);
+  std::copy(std::begin(Counts), std::end(Counts), std::begin(mLastCounts));
+  mLast.swap(mCurrent);
+}
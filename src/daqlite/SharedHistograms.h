@@ -0,0 +1,162 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file SharedHistograms.h
+///
+/// \brief Publication of daqlite histograms through POSIX shared memory
+///
+/// One daqlite instance running in 'publish' mode consumes the Kafka topic
+/// and writes cumulative per-source pixel histograms and TOF spectra into a
+/// shared memory segment. Any number of daqlite instances running in 'view'
+/// mode attach to the segment read-only and feed the deltas into their own
+/// ESSConsumer, so the plots work unchanged without decoding the stream.
+///
+/// Consistency between the single writer and the readers is provided by a
+/// seqlock: the writer makes the sequence number odd while updating and even
+/// when done, readers retry their copy if the sequence changed meanwhile.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Forward declarations
+class Configuration;
+class ESSConsumer;
+
+class SharedHistograms {
+public:
+  /// \brief Shared memory mode names used in configuration and command line
+  static constexpr const char *PUBLISH{"publish"};
+  static constexpr const char *VIEW{"view"};
+
+  /// \brief Maximum number of flat buffer sources in a segment
+  static constexpr size_t MAX_SOURCES{16};
+
+  /// \brief Maximum source name length including the terminating zero
+  static constexpr size_t MAX_SOURCE_NAME{64};
+
+  /// \brief Maximum number of da00 histogram bins whose edges are published
+  static constexpr uint32_t MAX_EDGE_BINS{1 << 16};
+
+  /// \brief Layout of the segment header, followed by the histograms
+  ///
+  /// For each source the segment holds PixelBins pixel counts followed by
+  /// TofBins TOF counts, all as cumulative uint64_t values. These are
+  /// followed by EdgeCapacity double values per source for the bin edges of
+  /// its latest da00 histogram, which shares the pixel counts.
+  struct Header {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t PixelBins;
+    uint32_t TofBins;
+    uint32_t SourceCount;
+    uint32_t EdgeCapacity;
+
+    /// \brief Number of da00 bin edges per source, 0 if none were received
+    /// or there are more than fit
+    uint32_t EdgeCounts[MAX_SOURCES];
+
+    /// \brief Identifies the publisher instance, changes on restart
+    uint64_t Session;
+
+    /// \brief Seqlock sequence number, odd while the writer is updating
+    std::atomic<uint64_t> Sequence;
+
+    /// \brief Number of completed publications
+    uint64_t Epoch;
+
+    /// \brief Cumulative event counters
+    uint64_t EventCount;
+    uint64_t EventAccept;
+    uint64_t EventDiscard;
+
+    char Sources[MAX_SOURCES][MAX_SOURCE_NAME];
+  };
+
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "Seqlock requires lock free 64 bit atomics");
+
+  /// \brief Create (publish) or prepare to attach to (view) a segment
+  /// \param Config  Configuration holding the shared memory options and the
+  ///                geometry and TOF binning of the histograms
+  /// \param Sources Flat buffer sources to publish, ignored when viewing.
+  ///                If empty all data is published as one combined source
+  SharedHistograms(const Configuration &Config,
+                   const std::vector<std::string> &Sources);
+
+  /// \brief Unmaps the segment, the publisher also removes it
+  ~SharedHistograms();
+
+  SharedHistograms(const SharedHistograms &) = delete;
+  SharedHistograms &operator=(const SharedHistograms &) = delete;
+
+  /// \return true when running as the ingesting publisher
+  bool isPublisher() const { return mPublisher; }
+
+  /// \brief Called periodically from the worker thread
+  ///
+  /// The publisher moves the data accumulated by the consumer into the
+  /// segment. A viewer copies the segment and adds the increase since its
+  /// previous call to the consumer.
+  void synchronize(ESSConsumer &Consumer);
+
+private:
+  /// \brief Create, size and map the segment for writing
+  void create(const std::vector<std::string> &Sources);
+
+  /// \brief Try to map an existing segment for reading
+  /// \return true if a compatible segment is mapped
+  bool attach();
+
+  /// \brief Unmap the segment if mapped
+  void detach();
+
+  /// \brief Add the consumer data to the segment under the seqlock
+  void publish(ESSConsumer &Consumer);
+
+  /// \brief Copy the segment under the seqlock and forward the increase
+  void view(ESSConsumer &Consumer);
+
+  /// \return pointer to the first histogram value for a source
+  uint64_t *histograms(size_t SourceIndex) const;
+
+  /// \return pointer to the first da00 bin edge for a source
+  double *edges(size_t SourceIndex) const;
+
+  /// \return total segment size in bytes
+  size_t segmentSize(size_t SourceCount) const;
+
+  /// \brief Name of the POSIX shared memory object
+  std::string mName;
+
+  bool mPublisher{false};
+
+  uint32_t mPixelBins{0};
+  uint32_t mTofBins{0};
+  uint32_t mEdgeCapacity{0};
+
+  /// \brief Mapped segment, nullptr when not mapped
+  Header *mHeader{nullptr};
+  size_t mSize{0};
+
+  /// \brief Viewer: session and sequence number of the previous copy, the
+  /// sequence is odd until the first copy of a session
+  uint64_t mSession{0};
+  uint64_t mSequence{1};
+
+  /// \brief Viewer: number of calls without a new publication
+  int mStaleCount{0};
+
+  /// \brief Viewer: segment copies, previous and current
+  std::vector<uint64_t> mLast;
+  std::vector<uint64_t> mCurrent;
+  uint64_t mLastCounts[3]{0, 0, 0};
+
+  /// \brief Viewer: da00 bin edges per source as last given to the consumer
+  std::vector<std::vector<double>> mEdges;
+};
@@ -0,0 +1,40 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file SlidingWindow.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <SlidingWindow.h>
+
+#include <Configuration.h>
+
+#include <cmath>
+
+SlidingWindow::SlidingWindow(const Configuration &Config, size_t Bins) {
+  const double Window = Config.mPlot.WindowSeconds;
+  const double Slice = Config.mPlot.WindowSliceSeconds;
+  if (Window <= 0.0 or Slice <= 0.0) {
+    return;
+  }
+
+  const size_t Slices = std::max(1.0, std::ceil(Window / Slice));
+  mSlices.assign(Slices,
+                 AdaptiveHistogram(Bins, Config.mGeometry.SparseOccupancy));
+  mSliceDuration = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(Slice));
+  mSliceStart = Clock::now();
+}
+
+void SlidingWindow::add(const AdaptiveHistogram &Delta) {
+  if (enabled()) {
+    mSlices[mCurrent].merge(Delta);
+  }
+}
+
+void SlidingWindow::clear() {
+  for (auto &Slice : mSlices) {
+    Slice.clear();
+  }
+  mSliceStart = Clock::now();
+}
@@ -0,0 +1,85 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file SlidingWindow.h
+///
+/// \brief Ring of per-interval histogram deltas for 'last N seconds' plots
+///
+/// A plot adds each new delta both to its accumulated histogram and to the
+/// current slice of the window. When a slice has aged out of the window its
+/// counts are handed back to the plot to be subtracted again. The cost per
+/// update is proportional to the number of bins which changed, not to the
+/// size of the histogram.
+///
+/// The window covers window_seconds split into slices of window_slice_seconds.
+/// Shorter slices make the window edge more precise but use more memory, as
+/// every slice keeps its own (sparse) delta histogram.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <AdaptiveHistogram.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Forward declarations
+class Configuration;
+
+class SlidingWindow {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// \brief Window as configured for the plot, disabled if window_seconds is 0
+  /// \param Config  Plot configuration
+  /// \param Bins    Number of bins of the plot histogram
+  SlidingWindow(const Configuration &Config, size_t Bins);
+
+  /// \return true if the plot shows a sliding window
+  bool enabled() const { return not mSlices.empty(); }
+
+  /// \brief Record counts added to the plot histogram
+  void add(const AdaptiveHistogram &Delta);
+
+  /// \brief Record counts added to a single bin
+  void add(uint32_t Index, uint32_t Count) {
+    if (enabled()) {
+      mSlices[mCurrent].add(Index, Count);
+    }
+  }
+
+  /// \brief Rotate the ring and hand expired counts back to the plot
+  /// \param Fn  Called as Fn(Index, Count) for every expired bin, the plot
+  ///            subtracts Count from its histogram
+  template <typename Function> void expire(Function &&Fn) {
+    if (not enabled()) {
+      return;
+    }
+
+    const Clock::time_point Now = Clock::now();
+    size_t Rotations = 0;
+    while (Now - mSliceStart >= mSliceDuration and Rotations < mSlices.size()) {
+      mCurrent = (mCurrent + 1) % mSlices.size();
+      mSlices[mCurrent].forEach(Fn);
+      mSlices[mCurrent].clear();
+      mSliceStart += mSliceDuration;
+      Rotations++;
+    }
+
+    // All slices have expired, start over from now
+    if (Now - mSliceStart >= mSliceDuration) {
+      mSliceStart = Now;
+    }
+  }
+
+  /// \brief Forget all slices, used when the plot histogram is cleared
+  void clear();
+
+private:
+  std::vector<AdaptiveHistogram> mSlices;
+  size_t mCurrent{0};
+  Clock::duration mSliceDuration{};
+  Clock::time_point mSliceStart;
+};
@@ -41,6 +41,13 @@ public:
     mVector.emplace_back(std::forward<Args>(args)...);
   }
 
+  /// \brief Appends all values of another vector to the end of the vector.
+  /// \param other The vector containing values to be appended.
+  void append(const std::vector<DataType> &other) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mVector.insert(mVector.end(), other.begin(), other.end());
+  }
+
   /// \brief Reserves storage for at least the specified number of elements.
   /// \param capacity The number of elements to reserve space for.
   void reserve(const size_t capacity) {
@@ -78,6 +85,15 @@ public:
     return mVector.size();
   }
 
+  /// \brief Moves the contents out, leaving the vector empty.
+  /// \return The previous contents of the vector.
+  std::vector<DataType> take() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::vector<DataType> result;
+    result.swap(mVector);
+    return result;
+  }
+
   /// \brief Clears all elements from the vector.
   void clear() {
     std::lock_guard<std::mutex> lock(mMutex);
@@ -11,6 +11,7 @@
 #include <types/PlotType.h>
 #include <Configuration.h>
 #include <ESSConsumer.h>
+#include <WavelengthConverter.h>
 
 #include <logical_geometry/ESSGeometry.h>
 
@@ -24,8 +25,20 @@
 
 using std::vector;
 
-TofPlot::TofPlot(Configuration &Config, ESSConsumer &Consumer)
-    : AbstractPlot(PlotType::TOF, Consumer, Config) {
+TofPlot::TofPlot(Configuration &Config, ESSConsumer &Consumer, int Roi)
+    // Regions of interest read their own spectra with readRoiTof, so they
+    // subscribe to no data, which would otherwise never be released
+    : AbstractPlot(Roi < 0 ? PlotType::TOF : PlotType::NONE, Consumer, Config)
+    // Regions of interest are not persistent, nor are their histograms
+    , HistogramTofData(Config, Roi < 0 ? "tof" : "", Config.mTOF.BinSize)
+    , mWindow(Config, HistogramTofData.size())
+    , mBinner(Config)
+    , mRoi(Roi) {
+  // Wavelengths are binned in 1/1000 Å but shown in Å
+  if (not mConfig.mTOF.FlightPathFile.empty()) {
+    mXScale = 1.0 / WavelengthConverter::UNITS_PER_ANGSTROM;
+  }
+
   // Register callback functions for events
   connect(this, &QCustomPlot::mouseMove, this, &TofPlot::showPointToolTip);
   setAttribute(Qt::WA_AlwaysShowToolTips);
@@ -33,8 +46,6 @@ TofPlot::TofPlot(Configuration &Config, ESSConsumer &Consumer)
   auto &geom = mConfig.mGeometry;
   LogicalGeometry = new ESSGeometry(geom.XDim, geom.YDim, geom.ZDim, 1);
 
-  HistogramTofData.resize(mConfig.mTOF.BinSize);
-
   // this will also allow rescaling the color scale by dragging/zooming
   setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
 
@@ -49,13 +60,21 @@ TofPlot::TofPlot(Configuration &Config, ESSConsumer &Consumer)
   mGraph = new QCPGraph(xAxis, yAxis);
   // mGraph->setLineStyle(QCPGraph::lsNone);
   mGraph->setBrush(QBrush(QColor(0, 0, 255, 20)));
-  mGraph->setLineStyle(QCPGraph::lsStepCenter);
-  mGraph->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssCircle, 5));
+  if (mBinner.uniform()) {
+    mGraph->setLineStyle(QCPGraph::lsStepCenter);
+    mGraph->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssCircle, 5));
+  } else {
+    // One point per lower bin edge plus the last upper edge
+    mGraph->setLineStyle(QCPGraph::lsStepLeft);
+  }
+  if (mConfig.mTOF.Binning == "log") {
+    xAxis->setScaleType(QCPAxis::stLogarithmic);
+  }
 
   // we want the color map to have nx * ny data points
 
   if (mConfig.mPlot.XAxis.empty()) {
-    xAxis->setLabel("TOF (μs)");
+    xAxis->setLabel(mXScale == 1.0 ? "TOF (μs)" : "Wavelength (Å)");
   } else {
     xAxis->setLabel(mConfig.mPlot.XAxis.c_str());
   }
@@ -80,20 +99,37 @@ void TofPlot::plotDetectorImage(bool Force) {
   setCustomParameters();
   mGraph->data()->clear();
   uint32_t MaxY{0};
-  for (unsigned int i = 0; i < HistogramTofData.size(); i++) {
+
+  // Variable width bins are drawn as steps between the bin edges, which
+  // needs every bin
+  if (not mBinner.uniform()) {
+    for (unsigned int i = 0; i < HistogramTofData.size(); i++) {
+      MaxY = std::max(MaxY, HistogramTofData[i]);
+      mGraph->addData(mBinner.lowerEdge(i) * mXScale, HistogramTofData[i]);
+    }
+    const uint32_t Last = HistogramTofData.size() - 1;
+    mGraph->addData(mBinner.upperEdge(Last) * mXScale,
+                    HistogramTofData[Last]);
+  }
+
+  for (unsigned int i = 0; mBinner.uniform() and i < HistogramTofData.size();
+       i++) {
     if ((HistogramTofData[i] != 0) or (Force)) {
       uint32_t x = i * mConfig.mTOF.MaxValue / mConfig.mTOF.BinSize;
       uint32_t y = HistogramTofData[i];
       if (y > MaxY) {
         MaxY = y;
       }
-      mGraph->addData(x, y);
+      mGraph->addData(x * mXScale, y);
     }
   }
 
   // yAxis->rescale();
-  if (mConfig.mTOF.AutoScaleX) {
-    xAxis->setRange(0, mConfig.mTOF.MaxValue * 1.05);
+  if (mConfig.mTOF.AutoScaleX and mBinner.uniform()) {
+    xAxis->setRange(0, mConfig.mTOF.MaxValue * mXScale * 1.05);
+  } else if (mConfig.mTOF.AutoScaleX) {
+    xAxis->setRange(mBinner.lowerEdge(0) * mXScale,
+                    mBinner.upperEdge(mBinner.bins() - 1) * mXScale);
   }
   if (mConfig.mTOF.AutoScaleY) {
     yAxis->setRange(0, MaxY * 1.05);
@@ -108,32 +144,58 @@ void TofPlot::updateData() {
 
   // Get histogram data from Consumer and clear it
   const std::string source = mConfig.mPlot.Source;
-  vector<uint32_t> HistogramTof = mConsumer.readData(DataType::HISTOGRAM_TOF, source);
+  vector<uint32_t> HistogramTof =
+      mRoi < 0 ? mConsumer.readData(DataType::HISTOGRAM_TOF, source, mSubscriber)
+               : mConsumer.readRoiTof(mRoi);
 
   // Periodically clear the histogram
   int64_t nsBetweenClear = 1000000000LL * mConfig.mPlot.ClearEverySeconds;
   if (mConfig.mPlot.ClearPeriodic and (elapsed.count() >= nsBetweenClear)) {
-    std::fill(HistogramTofData.begin(), HistogramTofData.end(), 0);
+    HistogramTofData.clear();
+    mWindow.clear();
+    mConsumer.clearCube(source);
     t1 = std::chrono::high_resolution_clock::now();
   }
 
-  // Accumulate counts, PixelId 0 does not exist
-  for (unsigned int i = 1; i < HistogramTof.size(); i++) {
+  // Accumulate counts, bin 0 is the first TOF bin
+  const size_t Bins = std::min(HistogramTof.size(), HistogramTofData.size());
+  for (unsigned int i = 0; i < Bins; i++) {
     HistogramTofData[i] += HistogramTof[i];
+    if (HistogramTof[i] != 0) {
+      mWindow.add(i, HistogramTof[i]);
+    }
   }
+
+  // Subtract counts which have left the sliding window
+  mWindow.expire([this](uint32_t Bin, uint32_t Count) {
+    HistogramTofData[Bin] -= Count;
+  });
   plotDetectorImage(false);
 
   return;
 }
 
 void TofPlot::clearDetectorImage() {
-  std::fill(HistogramTofData.begin(), HistogramTofData.end(), 0);
+  HistogramTofData.clear();
+  mWindow.clear();
+  mConsumer.clearCube(mConfig.mPlot.Source);
   plotDetectorImage(true);
 }
 
 // MouseOver, display coordinate and data in tooltip
 void TofPlot::showPointToolTip(QMouseEvent *event) {
-  int x = this->xAxis->pixelToCoord(event->pos().x());
+  int x = this->xAxis->pixelToCoord(event->pos().x()) / mXScale;
+
+  if (not mBinner.uniform()) {
+    const uint32_t Bin = mBinner.valueToBin(std::max(x, 0));
+    const uint32_t Count =
+        Bin < HistogramTofData.size() ? HistogramTofData[Bin] : 0;
+    setToolTip(QString("Tof: %1 - %2 Count: %3")
+                   .arg(mBinner.lowerEdge(Bin) * mXScale)
+                   .arg(mBinner.upperEdge(Bin) * mXScale)
+                   .arg(Count));
+    return;
+  }
 
   // Calculate x coord width of the graphical representation of the column
   int xCoordStep = int(mConfig.mTOF.MaxValue / mConfig.mTOF.BinSize);
@@ -148,5 +210,7 @@ void TofPlot::showPointToolTip(QMouseEvent *event) {
   const bool empty = mGraph->data()->isEmpty();
   double count = (empty) ? 0 : mGraph->data()->at(xCoordDataIndex)->mainValue();
 
-  setToolTip(QString("Tof: %1 Count: %2").arg(xCoordTofValue).arg(count));
+  setToolTip(QString("Tof: %1 Count: %2")
+                 .arg(xCoordTofValue * mXScale)
+                 .arg(count));
 }
\ No newline at end of file
@@ -9,6 +9,9 @@
 #pragma once
 
 #include <AbstractPlot.h>
+#include <Binner.h>
+#include <MappedHistogram.h>
+#include <SlidingWindow.h>
 
 #include <stdint.h>
 #include <vector>
@@ -28,7 +31,12 @@ class TofPlot : public AbstractPlot {
 public:
 
   /// \brief plot needs the configurable plotting options
-  TofPlot(Configuration &Config, ESSConsumer &Consumer);
+  /// \param Roi  Index of a region of interest in the consumer to plot its
+  ///             TOF histogram, or -1 for the whole source
+  TofPlot(Configuration &Config, ESSConsumer &Consumer, int Roi = -1);
+
+  /// \return index of the plotted region of interest, or -1
+  int getRoi() const { return mRoi; }
 
   /// \brief adds histogram data, clears periodically then calls
   /// plotDetectorImage()
@@ -51,7 +59,20 @@ private:
   // QCustomPlot variables
   QCPGraph *mGraph{nullptr};
 
-  std::vector<uint32_t> HistogramTofData;
+  /// \brief accumulated counts, optionally persistent
+  MappedHistogram HistogramTofData;
+
+  /// \brief recent deltas, to show a sliding window if configured
+  SlidingWindow mWindow;
+
+  /// \brief TOF bin edges, for plotting variable width bins
+  Binner mBinner;
+
+  /// \brief Region of interest, or -1 for the whole source
+  int mRoi{-1};
+
+  /// \brief Factor from binned values to x axis values, for wavelengths
+  double mXScale{1.0};
 
   /// \brief for calculating x, y, z from pixelid
   ESSGeometry *LogicalGeometry;
@@ -0,0 +1,59 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file WavelengthConverter.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include <WavelengthConverter.h>
+
+#include <Configuration.h>
+#include <JsonFile.h>
+
+#include <fmt/format.h>
+
+#include <stdexcept>
+
+namespace {
+/// \brief h / m_n in 1/1000 Å * m / us
+constexpr double PLANCK_OVER_NEUTRON_MASS{3.956034};
+} // namespace
+
+WavelengthConverter::WavelengthConverter(const Configuration &Config)
+    : mOffset(Config.mGeometry.Offset) {
+  const std::string &FileName = Config.mTOF.FlightPathFile;
+  if (FileName.empty()) {
+    return;
+  }
+
+  nlohmann::json Root = from_json_file(FileName);
+  std::vector<double> Paths;
+  if (Root.contains("flight_path")) {
+    Paths = Root["flight_path"].get<std::vector<double>>();
+  } else if (Root.contains("l2")) {
+    Paths = Root["l2"].get<std::vector<double>>();
+    const double L1 = Root.value("l1", 0.0);
+    for (auto &Path : Paths) {
+      Path += L1;
+    }
+  } else {
+    throw std::runtime_error(
+        fmt::format("No flight_path or l2 in flight path file {}", FileName));
+  }
+
+  const auto &Geometry = Config.mGeometry;
+  const size_t Pixels = Geometry.XDim * Geometry.YDim * Geometry.ZDim;
+  if (Paths.size() != Pixels) {
+    fmt::print("Flight path file {} has {} pixels, the geometry {}\n",
+               FileName, Paths.size(), Pixels);
+  }
+
+  // Raw TOF is in 1/Scale us, pixel ids start from 1
+  mFactors.assign(Pixels + 2, 0.0f);
+  for (size_t i = 0; i < std::min(Paths.size(), Pixels); i++) {
+    if (Paths[i] > 0) {
+      mFactors[i + 1] =
+          PLANCK_OVER_NEUTRON_MASS / (Config.mTOF.Scale * Paths[i]);
+    }
+  }
+}
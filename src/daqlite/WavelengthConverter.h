@@ -0,0 +1,70 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file WavelengthConverter.h
+///
+/// \brief Per-pixel TOF to neutron wavelength conversion
+///
+/// The wavelength of a neutron is proportional to its time of flight divided
+/// by its flight path L1 + L2, which differs per pixel. The flight paths are
+/// read once from a JSON file and turned into one multiplication factor per
+/// pixel, so converting an event is a table lookup and a multiply. Converted
+/// values are in units of 1/1000 Å and are binned with the TOF binning of the
+/// configuration, e.g. max_value 10000 for 10 Å.
+///
+/// The flight path file holds either the total path of every pixel or a
+/// common L1 and the L2 of every pixel, in meters, starting from pixel 1
+///
+///     {"flight_path": [21.3, 21.3, ...]}
+///     {"l1": 20.0, "l2": [1.3, 1.3, ...]}
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Forward declarations
+class Configuration;
+
+class WavelengthConverter {
+public:
+  /// \brief Converted values per Å
+  static constexpr double UNITS_PER_ANGSTROM{1000.0};
+
+  /// \brief Converter for the tof.flight_path_file of the configuration,
+  /// disabled if no file is configured
+  WavelengthConverter(const Configuration &Config);
+
+  /// \return true if TOF is converted to wavelength
+  bool enabled() const { return not mFactors.empty(); }
+
+  /// \brief Convert raw TOF values (as in the flat buffers, before scaling)
+  /// to wavelength. Pixels outside the geometry or without a flight path
+  /// give wavelength 0. The loop has no branches and vectorizes.
+  /// \param Pixels  Pixel ids, with the geometry offset
+  /// \param Tofs    Raw TOF of each event
+  /// \param Events  Number of events
+  /// \param Values  Wavelengths, resized to Events
+  template <typename PixelType, typename TofType>
+  void convert(const PixelType *Pixels, const TofType *Tofs, size_t Events,
+               std::vector<uint32_t> &Values) const {
+    Values.resize(Events);
+    const uint32_t Last = mFactors.size() - 1;
+    for (size_t i = 0; i < Events; i++) {
+      const uint32_t Index =
+          std::min<uint32_t>(uint32_t(Pixels[i]) - mOffset, Last);
+      Values[i] =
+          static_cast<uint32_t>(std::max(0.0f, float(Tofs[i]) * mFactors[Index]));
+    }
+  }
+
+private:
+  /// \brief Factor for each pixel id without offset, with an extra zero at
+  /// the end for pixels outside the geometry
+  std::vector<float> mFactors;
+
+  uint32_t mOffset{0};
+};
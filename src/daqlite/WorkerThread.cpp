@@ -16,10 +16,20 @@ void WorkerThread::run() {
   auto t2 = std::chrono::high_resolution_clock::now();
   auto t1 = std::chrono::high_resolution_clock::now();
 
+  const bool Viewer = Shared and not Shared->isPublisher();
+
+  // Replays recent data in the background, if configured
+  Consumer->startBackfill();
+
   while (true) {
-    auto Msg = Consumer->consume();
+    // A viewer has nothing to consume, the data arrives through shared memory
+    if (Viewer) {
+      msleep(100);
+    } else {
+      auto Msg = Consumer->consume();
 
-    Consumer->handleMessage(Msg.get());
+      Consumer->handleMessage(Msg.get());
+    }
 
     t2 = std::chrono::high_resolution_clock::now();
     std::chrono::duration<int64_t, std::nano> elapsed = t2 - t1;
@@ -27,6 +37,10 @@ void WorkerThread::run() {
     /// once every ~ 1 second, copy the histograms and tell main thread
     /// that plots can be updated.
     if (elapsed.count() >= 1000000000LL) {
+      if (Shared) {
+        Shared->synchronize(*Consumer);
+      }
+      Consumer->getStatistics().sample();
 
       int ElapsedCountMS = elapsed.count()/1000000;
       emit resultReady(ElapsedCountMS);
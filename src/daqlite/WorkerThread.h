@@ -8,6 +8,9 @@
 /// ESSConsumer::handleMessage() to histogram the pixelids. Once every second
 /// the plotting thread (qt main thread?) is
 /// notified to update and plot new data.
+///
+/// When shared memory is configured, the histograms are published to (or
+/// read from) the shared memory segment at the same cadence.
 //===----------------------------------------------------------------------===//
 
 #pragma once
@@ -15,11 +18,14 @@
 #include <Configuration.h>
 #include <ESSConsumer.h>
 #include <KafkaConfig.h>
+#include <SharedHistograms.h>
 
 #include <QThread>
 
 #include <memory>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 class WorkerThread : public QThread {
   Q_OBJECT
@@ -32,6 +38,13 @@ public:
     Consumer = std::make_unique<ESSConsumer>(Config, KafkaCfg.CfgParms);
   };
 
+  /// \brief Enable publishing to or viewing from shared memory, must be
+  /// called before the thread is started
+  /// \param Sources  Flat buffer sources to publish
+  void setupSharedMemory(const std::vector<std::string> &Sources) {
+    Shared = std::make_unique<SharedHistograms>(mConfig, Sources);
+  }
+
   ~WorkerThread() {
     this->terminate();
     this->wait();
@@ -60,4 +73,7 @@ private:
 
   /// \brief Kafka consumer
   std::unique_ptr<ESSConsumer> Consumer;
+
+  /// \brief Optional shared memory publisher or viewer
+  std::unique_ptr<SharedHistograms> Shared;
 };
@@ -10,6 +10,7 @@
 
 #include <Configuration.h>
 #include <MainWindow.h>
+#include <SharedHistograms.h>
 #include <WorkerThread.h>
 
 #include <QApplication>
@@ -21,7 +22,9 @@
 #include <fmt/format.h>
 
 #include <stdio.h>
+#include <algorithm>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -48,6 +51,22 @@ namespace {
       }
     }
   }
+
+  /// \brief Apply and validate the shared memory mode
+  ///
+  /// \param CLI     Command line options
+  /// \param Config  Plot configuration
+  void setSharedMemoryOptions(const QCommandLineParser &CLI, Configuration &Config) {
+    if (CLI.isSet("s")) {
+      Config.mSharedMemory.Mode = CLI.value("s").toStdString();
+    }
+
+    const std::string &Mode = Config.mSharedMemory.Mode;
+    if (!Mode.empty() && Mode != SharedHistograms::PUBLISH && Mode != SharedHistograms::VIEW) {
+      throw std::runtime_error(fmt::format("Invalid shared memory mode '{}', use '{}' or '{}'",
+                               Mode, SharedHistograms::PUBLISH, SharedHistograms::VIEW));
+    }
+  }
 }
 
 int main(int argc, char *argv[]) {
@@ -64,6 +83,7 @@ int main(int argc, char *argv[]) {
     {"b", "Kafka broker",             "unusedDefault"},
     {"t", "Kafka topic",              "unusedDefault"},
     {"k", "Kafka configuration file", "unusedDefault"},
+    {"s", "Shared memory mode (publish or view)", "unusedDefault"},
   };
   for (const auto& [key, info, unused]: Options) {
     QCommandLineOption option(key, info, unused);
@@ -81,14 +101,39 @@ int main(int argc, char *argv[]) {
   std::vector<Configuration> confs = Configuration::getConfigurations(FileName);
   Configuration MainConfig = confs.front();
   setKafkaOptions(CLI, MainConfig);
+  setSharedMemoryOptions(CLI, MainConfig);
 
   // Setup worker thread
   std::shared_ptr<WorkerThread> Worker = std::make_shared<WorkerThread>(MainConfig);
 
+  // ---------------------------------------------------------------------------
+  // Shared memory publisher: consume and publish the sources of all plots, but
+  // create no windows
+  if (MainConfig.mSharedMemory.Mode == SharedHistograms::PUBLISH) {
+    std::vector<std::string> Sources;
+    for (const auto &Config : confs) {
+      const std::string &Source = Config.mPlot.Source;
+      if (Source != Configuration::EMPTY_SOURCE &&
+          std::find(Sources.begin(), Sources.end(), Source) == Sources.end()) {
+        Worker->getConsumer().addSource(Source);
+        Sources.push_back(Source);
+      }
+    }
+    Worker->setupSharedMemory(Sources);
+    Worker->start();
+
+    return app.exec();
+  }
+
+  if (MainConfig.mSharedMemory.Mode == SharedHistograms::VIEW) {
+    Worker->setupSharedMemory({});
+  }
+
   // Setup a window for each plot
   for (size_t i=0; i < confs.size(); ++i) {
     Configuration Config = confs[i];
     setKafkaOptions(CLI, MainConfig);
+    setSharedMemoryOptions(CLI, Config);
 
     MainWindow* w = new MainWindow(Config, Worker.get());
     w->setWindowTitle(QString::fromStdString(Config.mPlot.WindowTitle));
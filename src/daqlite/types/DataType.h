@@ -25,12 +25,13 @@ public:
     TOF = 0x03,
     HISTOGRAM = 0x04,
     HISTOGRAM_TOF = 0x05,
-    PIXEL_ID = 0x06
+    PIXEL_ID = 0x06,
+    PULSE = 0x07
   };
 
   // Max and min enum values
   static constexpr int MIN = Types::NONE;
-  static constexpr int MAX = Types::PIXEL_ID;
+  static constexpr int MAX = Types::PULSE;
 
   // Construct from string
   DataType(const std::string &type) {
@@ -63,6 +64,10 @@ public:
       mDataType = Types::PIXEL_ID;
     }
 
+    else if (lower == "pulse") {
+      mDataType = Types::PULSE;
+    }
+
     else {
       throw std::invalid_argument("Invalid DataType string: " + type);
     }
@@ -108,6 +113,10 @@ public:
         result = "PIXEL_ID";
         break;
 
+      case Types::PULSE:
+        result = "PULSE";
+        break;
+
       default:
         break;
     }
@@ -122,7 +131,8 @@ public:
       Types::TOF,
       Types::HISTOGRAM,
       Types::HISTOGRAM_TOF,
-      Types::PIXEL_ID
+      Types::PIXEL_ID,
+      Types::PULSE
     };
   }
 
@@ -25,12 +25,13 @@ public:
     TOF2D = 0x03,
     TOF = 0x04,
     PIXELS = 0x05,
-    HISTOGRAM = 0x06
+    HISTOGRAM = 0x06,
+    PULSE_RATE = 0x07
   };
 
   // Max and min enum values
   static constexpr int MIN = Types::NONE;
-  static constexpr int MAX = Types::HISTOGRAM;
+  static constexpr int MAX = Types::PULSE_RATE;
 
   // Construct from string
   PlotType(const std::string &type) {
@@ -63,6 +64,10 @@ public:
       mPlotType = Types::HISTOGRAM;
     }
 
+    else if (lower == "pulserate") {
+      mPlotType = Types::PULSE_RATE;
+    }
+
     else {
       throw std::invalid_argument("Invalid PlotType string: " + type);
     }
@@ -108,6 +113,10 @@ public:
         result = "HISTOGRAM";
         break;
 
+      case Types::PULSE_RATE:
+        result = "PULSE_RATE";
+        break;
+
       default:
         break;
     }
@@ -122,7 +131,8 @@ public:
       Types::TOF2D,
       Types::TOF,
       Types::PIXELS,
-      Types::HISTOGRAM
+      Types::HISTOGRAM,
+      Types::PULSE_RATE
     };
   }
 
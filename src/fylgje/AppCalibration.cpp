@@ -8,6 +8,7 @@
 #include <QTableWidget>
 #include <QStringList>
 #include <QLineEdit>
+#include <QSignalBlocker>
 
 #include "AppWindow.h"
 #include "./ui_AppWindow.h"
@@ -91,6 +92,10 @@ void MainWindow::setup_calibration_table(){
     layout->addWidget(calibration_table);
   }
   calibration_table->setHorizontalHeaderLabels(headers);
+  // the items edit the calibration units directly, after which the histograms need the new calibration
+  connect(calibration_table, &QTableWidget::itemChanged, this, [&](QTableWidgetItem *){
+    data->recalibrate();
+  });
 
   setup_calibration_table_items();
 }
@@ -102,6 +107,8 @@ void MainWindow::setup_calibration_table_items(){
   // It's not clear if this item management would be handled by setItem internally:
   for (auto & item: calibration_table_items) delete item;
   calibration_table_items.clear();
+  // recalibrate once all items are in place, rather than for every item
+  QSignalBlocker blocker(calibration_table);
   for (int group=0; group<configuration.Instrument.groups; ++group){
     for (int unit=0; unit<configuration.Instrument.units_per_group; ++unit){
       auto arc = group / 9;
@@ -115,6 +122,7 @@ void MainWindow::setup_calibration_table_items(){
       }
     }
   }
+  data->recalibrate();
 }
 
 void MainWindow::save_calibration() {
@@ -3,13 +3,23 @@
 //
 /// \file
 //
-/// \brief GUI interface for saving stored data to HDF5 files
+/// \brief GUI interface for saving stored data to HDF5 files, and comparing with data loaded from them
 //===----------------------------------------------------------------------===//
 #include "AppWindow.h"
 #include "./ui_AppWindow.h"
 
 void MainWindow::setup_data(){
   connect(ui->actionSaveHDF5, &QAction::triggered, this, &MainWindow::save_data);
+  connect(ui->actionLoadReferenceHDF5, &QAction::triggered, this, &MainWindow::load_reference);
+  connect(ui->actionClearReference, &QAction::triggered, this, &MainWindow::clear_reference);
+  for (auto action: {ui->actionOverlayReference, ui->actionSubtractReference}){
+    connect(action, &QAction::toggled, this, [this, action](bool checked){select_reference(action, checked);});
+  }
+  if (configuration.Autosave.IntervalSeconds > 0){
+    auto *timer = new QTimer(this);
+    connect(timer, &QTimer::timeout, this, &MainWindow::autosave_data);
+    timer->start(static_cast<int>(configuration.Autosave.IntervalSeconds * 1000));
+  }
 }
 
 void MainWindow::save_data() {
@@ -22,13 +32,141 @@ void MainWindow::save_data() {
   if (ext != ".h5" || ext != ".hdf5"){
     p.replace_extension(path(".h5"));
   }
-  try{
-    data->save_to(p);
-  } catch (const std::runtime_error & ex){
+  export_data(p, true);
+}
+
+void MainWindow::autosave_data() {
+  // every autosave goes to a new file, named by its UTC time
+  auto now = QDateTime::currentDateTimeUtc().toString("yyyyMMdd'T'hhmmss'Z'").toStdString();
+  auto p = std::filesystem::path(configuration.Autosave.Directory) / fmt::format("{}_{}.h5", configuration.Autosave.Prefix, now);
+  export_data(p, false);
+}
+
+bool MainWindow::export_data(const std::filesystem::path & p, bool interactive) {
+  auto name = QString::fromStdString(std::string(p));
+  if (exporter){
+    ui->statusbar->showMessage(tr("Not saving %1 while still saving %2").arg(name, QString::fromStdString(std::string(exporter->path()))), 5000);
+    return false;
+  }
+  exporter = new ExportThread(data, p, this);
+  connect(exporter, &ExportThread::progress, this, [this, name](int done, int total){
+    ui->statusbar->showMessage(tr("Saving %1: %2%").arg(name).arg(100 * done / total));
+  });
+  connect(exporter, &ExportThread::failed, this, [this, name, interactive](const QString & message){
+    if (!interactive){
+      ui->statusbar->showMessage(tr("Saving %1 failed: %2").arg(name, message));
+      return;
+    }
     QMessageBox msgBox;
-    auto txt = fmt::format("Saving data to {} failed", std::string(p));
+    auto txt = fmt::format("Saving data to {} failed", name.toStdString());
     msgBox.setText(txt.c_str());
-    msgBox.setDetailedText(ex.what());
+    msgBox.setDetailedText(message);
     msgBox.exec();
+  });
+  connect(exporter, &QThread::finished, this, [this, name](){
+    if (exporter->succeeded()) ui->statusbar->showMessage(tr("Saved %1").arg(name), 5000);
+    exporter->deleteLater();
+    exporter = nullptr;
+  });
+  exporter->start();
+  return true;
+}
+
+void MainWindow::load_reference() {
+  using namespace std::filesystem;
+  auto q_filename = QFileDialog::getOpenFileName(this, tr("Load Reference Data"), "", tr("HDF5 files (*.h5 *.H5 *.hdf5 *.HDF5)"));
+  auto p = path(q_filename.toStdString());
+  if (!p.has_filename()) return;
+  auto name = QString::fromStdString(std::string(p));
+  // the HDF5 library is used by one thread at a time
+  if (exporter){
+    ui->statusbar->showMessage(tr("Not loading %1 while still saving %2").arg(name, QString::fromStdString(std::string(exporter->path()))), 5000);
+    return;
   }
-}
\ No newline at end of file
+  try {
+    auto loaded = ::bifrost::data::Manager::load_from(p, calibration);
+    if (loaded->arc_count() != data->arc_count() || loaded->triplet_count() != data->triplet_count()){
+      throw std::runtime_error(fmt::format("The file holds {} arcs of {} triplets, instead of {} arcs of {} triplets",
+                                           loaded->arc_count(), loaded->triplet_count(), data->arc_count(), data->triplet_count()));
+    }
+    reference = std::move(loaded);
+  } catch (const std::exception & e) {
+    QMessageBox msgBox;
+    auto txt = fmt::format("Loading reference data from {} failed", name.toStdString());
+    msgBox.setText(txt.c_str());
+    msgBox.setDetailedText(e.what());
+    msgBox.exec();
+    return;
+  }
+  for (auto action: {ui->actionOverlayReference, ui->actionSubtractReference, ui->actionClearReference}){
+    action->setEnabled(true);
+  }
+  ui->statusbar->showMessage(tr("Loaded reference %1").arg(name), 5000);
+  plot();
+}
+
+void MainWindow::clear_reference() {
+  reference.reset();
+  reference_image.reset();
+  for (auto action: {ui->actionOverlayReference, ui->actionSubtractReference, ui->actionClearReference}){
+    action->setEnabled(false);
+  }
+  plot();
+}
+
+void MainWindow::select_reference(QAction * selected, bool checked) {
+  // the reference is either overlaid or subtracted, or neither
+  if (checked) {
+    for (auto action: {ui->actionOverlayReference, ui->actionSubtractReference}){
+      if (action != selected) action->setChecked(false);
+    }
+  }
+  if (reference) plot();
+}
+
+bool MainWindow::subtract_reference() const {
+  return reference && ui->actionSubtractReference->isChecked();
+}
+
+double MainWindow::lowest_intensity(double intensity) const {
+  return subtract_reference() ? -intensity : 0.0;
+}
+
+::bifrost::data::Manager::D1 MainWindow::data_1D(int arc, int triplet, int_t t, ::bifrost::data::Filter which) {
+  auto values = data->data_1D(arc, triplet, t, which);
+  if (subtract_reference()){
+    reference->set_bins(*data);
+    auto subtrahend = reference->data_1D(arc, triplet, t, which);
+    if (subtrahend.size() == values.size()){
+      std::transform(values.begin(), values.end(), subtrahend.begin(), values.begin(), std::minus<>());
+    }
+  }
+  return values;
+}
+
+::bifrost::data::Manager::D2 * MainWindow::data_2D(int arc, int triplet, int_t t, ::bifrost::data::Filter which, ::bifrost::data::Manager::D2 * into) {
+  auto values = data->data_2D(arc, triplet, t, which, into);
+  if (subtract_reference()){
+    reference->set_bins(*data);
+    if (!reference_image) reference_image = std::make_unique<::bifrost::data::Manager::D2>(1, 1, QCPRange(0, 1), QCPRange(0, 1));
+    auto subtrahend = reference->data_2D(arc, triplet, t, which, reference_image.get());
+    for (int ix=0; ix < values->keySize(); ++ix){
+      for (int iy=0; iy < values->valueSize(); ++iy){
+        values->setCell(ix, iy, values->cell(ix, iy) - subtrahend->cell(ix, iy));
+      }
+    }
+  }
+  return values;
+}
+
+void MainWindow::plot_reference_1D(int i, int j, int arc, int triplet, int_t t) {
+  using ::bifrost::data::Filter;
+  std::optional<std::vector<double>> all{std::nullopt}, included{std::nullopt}, excluded{std::nullopt};
+  if (reference && ui->actionOverlayReference->isChecked()){
+    reference->set_bins(*data);
+    if (ui->filter1Everything->isChecked()) all = reference->data_1D(arc, triplet, t, Filter::none);
+    if (ui->filter1Included->isChecked()) included = reference->data_1D(arc, triplet, t, Filter::positive);
+    if (ui->filter1Excluded->isChecked()) excluded = reference->data_1D(arc, triplet, t, Filter::negative);
+  }
+  plots->plot_references(i, j, data->axis(t), all, included, excluded);
+}
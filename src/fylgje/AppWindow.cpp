@@ -124,45 +124,89 @@ void MainWindow::setup_time_limits(){
   }
   connect(ui->timeBeginning, &QDateTimeEdit::dateTimeChanged, this, &MainWindow::set_time_early);
   connect(ui->timeEnding, &QDateTimeEdit::dateTimeChanged, this, &MainWindow::set_time_late);
+  // editing a time steps through many ranges, only the last of which is consumed
+  backfill_timer = new QTimer(this);
+  backfill_timer->setSingleShot(true);
+  backfill_timer->setInterval(500);
+  connect(backfill_timer, &QTimer::timeout, this, &MainWindow::start_backfill);
 }
 
 
 void MainWindow::set_time_live(){
   time_status = Time::Live;
+  stop_backfill();
   auto now = QDateTime::currentDateTimeUtc();
   for (auto & dt: {ui->timeBeginning, ui->timeEnding}){
     dt->setDateTime(now);
     dt->setEnabled(false);
   }
+  consumer->Consumer->pause(false);
   consumer->Consumer->consumeForever();
   consumer->Consumer->consumeFrom(now.toMSecsSinceEpoch());
 }
 void MainWindow::set_time_historical(){
   time_status = Time::Historical;
+  // the histograms hold the selected time range only, consumed by start_backfill
+  consumer->Consumer->pause(true);
   for (auto & dt: {ui->timeBeginning, ui->timeEnding}){
     dt->setEnabled(true);
   }
 }
 void MainWindow::set_time_fixed(){
   time_status = Time::Fixed;
+  stop_backfill();
   for (auto & dt: {ui->timeBeginning, ui->timeEnding}){
     dt->setEnabled(false);
   }
+  consumer->Consumer->pause(false);
   consumer->Consumer->consumeUntil(ui->timeEnding->dateTime().toMSecsSinceEpoch());
   consumer->Consumer->consumeFrom(ui->timeBeginning->dateTime().toMSecsSinceEpoch());
 }
 
-void MainWindow::set_time_early(const QDateTime & time){
-  if (time_status == Time::Historical){
-    reset();
-    consumer->consume_from(time.toMSecsSinceEpoch());
-  }
+void MainWindow::set_time_early(const QDateTime &){
+  if (time_status == Time::Historical) backfill_timer->start();
+}
+
+void MainWindow::set_time_late(const QDateTime &){
+  if (time_status == Time::Historical) backfill_timer->start();
 }
 
-void MainWindow::set_time_late(const QDateTime & time){
-  if (time_status == Time::Historical){
-    consumer->consume_until(time.toMSecsSinceEpoch());
+void MainWindow::start_backfill(){
+  stop_backfill();
+  auto from = ui->timeBeginning->dateTime();
+  auto until = ui->timeEnding->dateTime();
+  if (from >= until){
+    ui->statusbar->showMessage(tr("The time range is empty"), 5000);
+    return;
   }
+  reset();
+  auto range = tr("%1 to %2").arg(from.toString(Qt::ISODate), until.toString(Qt::ISODate));
+  auto thread = new BackfillThread(consumer->Consumer, from.toMSecsSinceEpoch(), until.toMSecsSinceEpoch(), this);
+  // the messages are histogrammed in turn, unless ingest threads histogram the arcs in parallel
+  auto threads = configuration.Kafka.IngestThreads;
+  auto ingest = threads > 1 ? tr("histogramming the arcs on up to %1 threads").arg(threads) : tr("histogramming one message at a time");
+  connect(thread, &BackfillThread::progress, this, [this, range, ingest](int done, int total){
+    ui->statusbar->showMessage(tr("Fetching %1 from all partitions, %2: %3%").arg(range, ingest).arg(total ? 100 * static_cast<int64_t>(done) / total : 100));
+  });
+  connect(thread, &BackfillThread::failed, this, [this, range](const QString & message){
+    ui->statusbar->showMessage(tr("Consuming %1 failed: %2").arg(range, message));
+  });
+  connect(thread, &QThread::finished, this, [this, thread, range](){
+    if (thread->succeeded()) ui->statusbar->showMessage(tr("Consumed %1").arg(range), 5000);
+    if (backfiller == thread) backfiller = nullptr;
+    thread->deleteLater();
+  });
+  backfiller = thread;
+  backfiller->start();
+}
+
+void MainWindow::stop_backfill(){
+  if (backfill_timer) backfill_timer->stop();
+  if (!backfiller) return;
+  // the consumers of all partitions stop within a fraction of a second
+  backfiller->requestInterruption();
+  backfiller->wait();
+  backfiller = nullptr;
 }
 
 
@@ -227,6 +271,9 @@ void MainWindow::setup_consumer(){
 }
 
 MainWindow::~MainWindow(){
+  // the file being saved is completed first
+  if (exporter) exporter->wait();
+  stop_backfill();
   delete ui;
 }
 
@@ -362,6 +409,8 @@ void MainWindow::set_int(int_t t, bool plot_now){
 
 void MainWindow::plot(){
   if (is_paused()) return;
+  // show histograms from one moment, data arriving meanwhile is added afterwards
+  auto held = data->hold();
   set_intensity_limits();
   _triplet_fixed = ui->tripletBox->isChecked();
   _type_fixed = ui->intTypeBox->isChecked();
@@ -392,13 +441,14 @@ void MainWindow::plot_single(int arc, int triplet, int_t t){
     if (PlotManager::Dim::one == d){
       using ::bifrost::data::Filter;
       std::optional<std::vector<double>> all{std::nullopt}, included{std::nullopt}, excluded{std::nullopt};
-      if (ui->filter1Everything->isChecked()) all = data->data_1D(arc, triplet, t, Filter::none);
-      if (ui->filter1Included->isChecked()) included = data->data_1D(arc, triplet, t, Filter::positive);
-      if (ui->filter1Excluded->isChecked()) excluded = data->data_1D(arc, triplet, t, Filter::negative);
-      plots->plot_all_included_excluded(0, 0, data->axis(t), all, included, excluded, 0.0, intensity, is_log);
+      if (ui->filter1Everything->isChecked()) all = data_1D(arc, triplet, t, Filter::none);
+      if (ui->filter1Included->isChecked()) included = data_1D(arc, triplet, t, Filter::positive);
+      if (ui->filter1Excluded->isChecked()) excluded = data_1D(arc, triplet, t, Filter::negative);
+      plots->plot_all_included_excluded(0, 0, data->axis(t), all, included, excluded, lowest_intensity(intensity), intensity, is_log);
+      plot_reference_1D(0, 0, arc, triplet, t);
     }
     if (PlotManager::Dim::two == d){
-        plots->plot(0, 0, data->data_2D(arc, triplet, t, plot_filter), 0.0, intensity, is_log, gradient, is_inverted, {}, {}, {});
+        plots->plot(0, 0, data_2D(arc, triplet, t, plot_filter, plots->image_data(0, 0)), lowest_intensity(intensity), intensity, is_log, gradient, is_inverted, {}, {}, {});
     }
 }
 
@@ -418,10 +468,11 @@ void MainWindow::plot_one_type(int arc, int_t t){
       for (int j=0; j<3; ++j) {
         auto key = data->key(arc, i*3+j, t);
         auto intensity = 1.0 * max.at(key);
-        if (ui->filter1Everything->isChecked()) all = data->data_1D(arc, i*3+j, t, Filter::none);
-        if (ui->filter1Included->isChecked()) included = data->data_1D(arc, i*3+j, t, Filter::positive);
-        if (ui->filter1Excluded->isChecked()) excluded = data->data_1D(arc, i*3+j, t, Filter::negative);
-        plots->plot_all_included_excluded(i, j, data->axis(t), all, included, excluded, 0.0, intensity, is_log);
+        if (ui->filter1Everything->isChecked()) all = data_1D(arc, i*3+j, t, Filter::none);
+        if (ui->filter1Included->isChecked()) included = data_1D(arc, i*3+j, t, Filter::positive);
+        if (ui->filter1Excluded->isChecked()) excluded = data_1D(arc, i*3+j, t, Filter::negative);
+        plots->plot_all_included_excluded(i, j, data->axis(t), all, included, excluded, lowest_intensity(intensity), intensity, is_log);
+        plot_reference_1D(i, j, arc, i*3+j, t);
       }
     }
   }
@@ -431,7 +482,7 @@ void MainWindow::plot_one_type(int arc, int_t t){
       for (int i=0; i<3; ++i) {
           for (int j=0; j<3; ++j) {
             auto key = data->key(arc, i*3+j, t);
-            plots->plot(i, j, data->data_2D(arc, i*3+j, t, plot_filter), 0.0, 1.0*max[key], is_log, gradient, is_inverted, {}, {}, {});
+            plots->plot(i, j, data_2D(arc, i*3+j, t, plot_filter, plots->image_data(i, j)), lowest_intensity(1.0*max[key]), 1.0*max[key], is_log, gradient, is_inverted, {}, {}, {});
           }
       }
   }
@@ -447,16 +498,17 @@ void MainWindow::plot_one_triplet(int arc, int triplet){
   for (int t: {0, 1, 2, 5, 8}){
     auto key = data->key(arc, triplet, type_order[t]);
     auto intensity = 1.0 * max[key];
-    if (ui->filter1Everything->isChecked()) all = data->data_1D(arc, triplet, type_order[t], Filter::none);
-    if (ui->filter1Included->isChecked()) included = data->data_1D(arc, triplet, type_order[t], Filter::positive);
-    if (ui->filter1Excluded->isChecked()) excluded = data->data_1D(arc, triplet, type_order[t], Filter::negative);
-    plots->plot_all_included_excluded(i[t], j[t], data->axis(type_order[t]), all, included, excluded, 0.0, intensity, is_log);
+    if (ui->filter1Everything->isChecked()) all = data_1D(arc, triplet, type_order[t], Filter::none);
+    if (ui->filter1Included->isChecked()) included = data_1D(arc, triplet, type_order[t], Filter::positive);
+    if (ui->filter1Excluded->isChecked()) excluded = data_1D(arc, triplet, type_order[t], Filter::negative);
+    plots->plot_all_included_excluded(i[t], j[t], data->axis(type_order[t]), all, included, excluded, lowest_intensity(intensity), intensity, is_log);
+    plot_reference_1D(i[t], j[t], arc, triplet, type_order[t]);
   }
   auto gradient = ui->colormapComboBox->currentText().toStdString();
   auto is_inverted = ui->colormapInvertedCheck->isChecked();
   for (int t: {3, 4, 6, 7}){
     auto key = data->key(arc, triplet, type_order[t]);
-    plots->plot(i[t], j[t], data->data_2D(arc, triplet, type_order[t], plot_filter), 0.0, 1.0*max[key], is_log, gradient, is_inverted, {}, {}, {});
+    plots->plot(i[t], j[t], data_2D(arc, triplet, type_order[t], plot_filter, plots->image_data(i[t], j[t])), lowest_intensity(1.0*max[key]), 1.0*max[key], is_log, gradient, is_inverted, {}, {}, {});
   }
 }
 
@@ -14,6 +14,8 @@
 #include <optional>
 
 #include "WorkerThread.h"
+#include "ExportThread.h"
+#include "BackfillThread.h"
 #include "PlotManager.h"
 #include "DataManager.h"
 #include "TwoSpinBox.h"
@@ -118,6 +120,10 @@ private:
   void setup_calibration_info();
   void update_calibration_info();
 
+  // histogram the selected time range of all partitions, replacing the histograms
+  void start_backfill();
+  void stop_backfill();
+
   void set_intensity_limits();
   void get_intensity_limits();
   void auto_intensity_limits();
@@ -158,6 +164,21 @@ private:
 
   void setup_data();
   void save_data();
+  void autosave_data();
+  // write the histograms from a background thread, unless one is still writing
+  bool export_data(const std::filesystem::path & file, bool interactive);
+  // read histograms saved earlier, to overlay on or subtract from the plotted histograms
+  void load_reference();
+  void clear_reference();
+  void select_reference(QAction * selected, bool checked);
+  bool subtract_reference() const;
+  // the lower intensity limit of plots, below zero if the reference is subtracted
+  double lowest_intensity(double intensity) const;
+  // the histograms to plot, less the reference if it is subtracted
+  ::bifrost::data::Manager::D1 data_1D(int arc, int triplet, int_t t, ::bifrost::data::Filter which);
+  ::bifrost::data::Manager::D2 * data_2D(int arc, int triplet, int_t t, ::bifrost::data::Filter which, ::bifrost::data::Manager::D2 * into);
+  // show the reference histograms on a 1-D plot if they are overlaid, or remove them
+  void plot_reference_1D(int i, int j, int arc, int triplet, int_t t);
 
 
 private:
@@ -180,6 +201,10 @@ private:
     ::bifrost::data::Filter plot_filter{::bifrost::data::Filter::none};
     PlotManager * plots;
     WorkerThread * consumer{};
+    ExportThread * exporter{};
+    BackfillThread * backfiller{};
+    /// \brief restarted by every edit of the historical time range, which is consumed once it times out
+    QTimer * backfill_timer{};
 
     /// \brief configuration obtained from main()
     Configuration configuration;
@@ -187,6 +212,11 @@ private:
     /// \brief calibration obtained from main()
     Calibration calibration;
 
+    /// \brief histograms loaded from a file to compare with, using the calibration above
+    std::unique_ptr<::bifrost::data::Manager> reference;
+    /// \brief the reference histograms at the display bins of a subtracted 2-D plot
+    std::unique_ptr<::bifrost::data::Manager::D2> reference_image;
+
     Time time_status{Time::Live};
 
     std::optional<fylgje::Cycles<1>> cycle_one;
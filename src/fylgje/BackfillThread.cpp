@@ -0,0 +1,24 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file BackfillThread.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include "BackfillThread.h"
+#include <algorithm>
+#include <limits>
+
+void BackfillThread::run() {
+  auto report = [this](int64_t done, int64_t total){
+    // the signal counts in ints, so very long ranges are reported in coarser steps
+    auto step = std::max<int64_t>(1, total / std::numeric_limits<int>::max() + 1);
+    emit progress(static_cast<int>(done / step), static_cast<int>(total / step));
+  };
+  try {
+    consumer->consumeRange(from, until, report, [this](){ return isInterruptionRequested(); });
+    ok = !isInterruptionRequested();
+  } catch (const std::exception & ex) {
+    emit failed(QString::fromStdString(ex.what()));
+  }
+}
@@ -0,0 +1,43 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file BackfillThread.h
+///
+/// \brief Histograms the messages of a past time range without blocking the GUI
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "ESSConsumer.h"
+#include <QString>
+#include <QThread>
+#include <cstdint>
+
+class BackfillThread : public QThread {
+  Q_OBJECT
+
+public:
+  BackfillThread(ESSConsumer * consumer, int64_t from, int64_t until, QObject * parent = nullptr):
+  QThread(parent), consumer(consumer), from(from), until(until) {}
+
+  /// \brief consume the time range from all partitions, until done or interrupted
+  ///
+  /// The messages are fetched in parallel, but histogrammed one at a time unless ingest threads are configured
+  void run() override;
+
+  /// \brief whether the whole time range was consumed, valid once the thread finished
+  [[nodiscard]] bool succeeded() const {return ok;}
+
+private:
+  ESSConsumer * consumer;
+  int64_t from;
+  int64_t until;
+  bool ok{false};
+
+signals:
+  /// \brief this signal is 'emitted' regularly with the number of consumed and total messages
+  void progress(int done, int total);
+
+  /// \brief this signal is 'emitted' if the time range could not be consumed
+  void failed(QString message);
+};
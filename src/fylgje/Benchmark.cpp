@@ -0,0 +1,149 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file Benchmark.cpp
+///
+/// \brief Times the histogramming of synthetic readouts, built with -DFYLGJE_BENCHMARK=ON
+///
+/// Usage: fylgje_benchmark [readouts [batch [threads [file.h5]]]]
+///
+/// Times Manager::add per readout, Manager::add_batch per batch, and an IngestPool with 1 up to threads
+/// partitions, by default the number of cores; the pool only scales as far as there are idle cores. Given a
+/// file, also times Manager::save_to and checks that Manager::load_from reads the same histograms back.
+/// The readouts are uniformly random over all fibers, groups, amplitudes and times, which is the worst case
+/// for the caches, and the same for every path, so that their histograms can be compared bin by bin.
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <fmt/format.h>
+#include "IngestPool.h"
+
+namespace {
+  using namespace bifrost::data;
+
+  constexpr int ARCS{5}, TRIPLETS{9}, TUBES{3}, PIXELS{100};
+
+  struct Readout {
+    int fiber, group, a, b;
+    double time;
+  };
+
+  std::vector<Readout> synthetic(size_t count){
+    std::mt19937 rng(1);
+    std::vector<Readout> readouts(count);
+    for (auto & r: readouts) {
+      r = {static_cast<int>(rng() % 6), static_cast<int>(rng() % 15), static_cast<int>(rng() % 32768),
+           static_cast<int>(rng() % 32768), static_cast<double>(rng() % 1000000) * 1e-6};
+    }
+    return readouts;
+  }
+
+  template<class F> double seconds(F && f){
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  ///\brief Split the readouts into batches, as parseCAENData does per message
+  std::vector<Batch> batches(const std::vector<Readout> & readouts, size_t size){
+    std::vector<Batch> result;
+    for (size_t i = 0; i < readouts.size(); ++i) {
+      if (i % size == 0) result.emplace_back();
+      const auto & r = readouts[i];
+      result.back().push_back(r.fiber, r.group, r.a, r.b, r.time);
+    }
+    return result;
+  }
+
+  ///\brief Decode a span of readouts into one batch per partition, as ESSConsumer::decodeCAENData does
+  void decode(const uint8_t * bytes, int size, const IngestPool::header_t &, Batch * batches, int partitions){
+    for (int i = 0; i + static_cast<int>(sizeof(Readout)) <= size; i += sizeof(Readout)) {
+      Readout r;
+      std::memcpy(&r, bytes + i, sizeof(Readout));
+      batches[::bifrost::arc(r.group) % partitions].push_back(r.fiber, r.group, r.a, r.b, r.time);
+    }
+  }
+
+  ///\brief Whether all histograms of two managers hold the same counts
+  bool identical(const Manager & one, const Manager & other){
+    for (auto which: {Filter::none, Filter::positive, Filter::negative}) {
+      for (bifrost::data::key_t k = 0; k < one.key_count(); ++k) {
+        auto x = one.histogram(k, which), y = other.histogram(k, which);
+        if (!std::equal(x, x + type_bins(one.key_type(k)), y)) return false;
+      }
+    }
+    return true;
+  }
+
+  void report(const std::string & name, size_t count, double s){
+    fmt::print("{:<24} {:8.2f} Mreadouts/s {:8.1f} ns/readout\n", name, static_cast<double>(count) / s / 1e6,
+               s / static_cast<double>(count) * 1e9);
+  }
+}
+
+int main(int argc, char ** argv){
+  const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000000;
+  const size_t size = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 300;
+  const int threads = argc > 3 ? std::atoi(argv[3]) : static_cast<int>(std::thread::hardware_concurrency());
+  auto readouts = synthetic(count);
+  auto batched = batches(readouts, size ? size : 1);
+  Calibration calibration(ARCS * TRIPLETS, TUBES);
+
+  Manager single(ARCS, TRIPLETS, TUBES, PIXELS, calibration);
+  report("add", count, seconds([&]{
+    for (const auto & r: readouts) single.add(r.fiber, r.group, r.a, r.b, r.time);
+  }));
+
+  Manager batch(ARCS, TRIPLETS, TUBES, PIXELS, calibration);
+  report(fmt::format("add_batch ({})", size), count, seconds([&]{
+    for (const auto & b: batched) batch.add_batch(b);
+  }));
+  if (!identical(single, batch)) {
+    fmt::print("add_batch differs from add\n");
+    return 1;
+  }
+
+  // the consume loop hands each message to the pool as raw bytes, and splits it by arc
+  const size_t message = (size ? size : 1) * sizeof(Readout);
+  const auto * bytes = reinterpret_cast<const uint8_t *>(readouts.data());
+
+  // the split is the serial part of the pool, which bounds how far it scales
+  std::vector<Batch> split(ARCS);
+  report("split by arc", count, seconds([&]{
+    for (size_t begin = 0; begin < count * sizeof(Readout); begin += message) {
+      decode(bytes + begin, static_cast<int>(std::min(message, count * sizeof(Readout) - begin)), {}, split.data(), ARCS);
+      for (auto & batch: split) batch.clear();
+    }
+  }));
+  for (int t = 1; t <= std::min(threads, ARCS); ++t) {
+    Manager pooled(ARCS, TRIPLETS, TUBES, PIXELS, calibration);
+    report(fmt::format("IngestPool ({} threads)", t), count, seconds([&]{
+      IngestPool pool(&pooled, t, decode);
+      for (size_t begin = 0; begin < count * sizeof(Readout); begin += message) {
+        pool.add(bytes + begin, static_cast<int>(std::min(message, count * sizeof(Readout) - begin)), {});
+      }
+      pool.drain();
+    }));
+    if (!identical(single, pooled)) {
+      fmt::print("IngestPool with {} threads differs from add\n", t);
+      return 1;
+    }
+  }
+
+  if (argc > 4) {
+    std::filesystem::path file(argv[4]);
+    fmt::print("save_to {}: {:.2f} s\n", file.string(), seconds([&]{ single.save_to(file); }));
+    auto loaded = Manager::load_from(file, calibration);
+    if (!loaded || !identical(single, *loaded)) {
+      fmt::print("load_from {} differs from the saved histograms\n", file.string());
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -5,7 +5,9 @@
 //
 /// \brief Calibration information for the BIFROST detector
 //===----------------------------------------------------------------------===//
+#include <cmath>
 #include <iomanip>
+#include <limits>
 #include <sstream>
 #include <iostream>
 #include "Calibration.h"
@@ -123,6 +125,61 @@ void Calibration::setGroups(Groups groups) {
   return groups_[group].elements[unit].unitPosition(global_position);
 }
 
+///\brief Compile the Calibration into lookup tables, finding the position of the change within each cell
+CalibrationTable::CalibrationTable(const Calibration & calibration, int pixels_per_unit)
+: calibration_{calibration}, pixels_per_unit_{pixels_per_unit}, groups_{static_cast<int>(calibration.groupCount())} {
+  if (pixels_per_unit > std::numeric_limits<int16_t>::max() || calibration.elementCount() > static_cast<size_t>(std::numeric_limits<int16_t>::max())){
+    throw std::runtime_error(fmt::format("Can not tabulate {} units of {} pixels", calibration.elementCount(), pixels_per_unit));
+  }
+  auto same = [](const CalibrationResult & x, const CalibrationResult & y){return x.unit == y.unit && x.pixel == y.pixel;};
+  auto entry = [](const CalibrationResult & r){return Entry{static_cast<int16_t>(r.unit), static_cast<int16_t>(r.pixel)};};
+  // non-negative doubles are ordered like their bit patterns, which allows bisecting down to adjacent values
+  auto to_bits = [](double x){uint64_t u; std::memcpy(&u, &x, sizeof u); return u;};
+  auto from_bits = [](uint64_t u){double x; std::memcpy(&x, &u, sizeof x); return x;};
+
+  cells_.resize(static_cast<size_t>(groups_) * (RESOLUTION + 1));
+  for (int g=0; g<groups_; ++g){
+    // the smallest position in (low, high] with a result different from the result at low
+    auto change = [&](double low, double high, const CalibrationResult & at_low){
+      auto l = to_bits(low);
+      auto h = to_bits(high);
+      while (h - l > 1){
+        auto m = l + (h - l) / 2;
+        if (same(evaluate(g, from_bits(m)), at_low)) l = m; else h = m;
+      }
+      return from_bits(h);
+    };
+    for (int q=0; q<=RESOLUTION; ++q){
+      auto & cell = cells_[static_cast<size_t>(g) * (RESOLUTION + 1) + q];
+      auto low = static_cast<double>(q) / RESOLUTION;
+      auto high = q < RESOLUTION ? std::nextafter(static_cast<double>(q + 1) / RESOLUTION, 0.) : 1.;
+      auto first = evaluate(g, low);
+      auto last = evaluate(g, high);
+      cell.split = low;
+      cell.below = entry(first);
+      cell.above = entry(last);
+      if (!same(first, last)){
+        cell.split = change(low, high, first);
+        if (!same(evaluate(g, cell.split), last)){
+          // more than one change, e.g., the single-position last pixel at a unit edge
+          cell.below = cell.above = Entry{};
+        }
+      }
+    }
+  }
+}
+
+[[nodiscard]] CalibrationResult CalibrationTable::evaluate(int group, double pos) const {
+  if (group < 0) return {};
+  auto unit = calibration_.getUnitId(group, pos);
+  if (unit < 0) return {};
+  auto unit_pos = calibration_.unitPosition(group, unit, pos);
+  if (unit_pos < 0 || unit_pos > 1) return {};
+  // corrected position in (0.0, 1.0) is mapped to a unit pixel in (0, pixels_per_unit - 1)
+  auto cor_pos = calibration_.posCorrection(group, unit, unit_pos);
+  return {unit, static_cast<int>((pixels_per_unit_ - 1) * cor_pos)};
+}
+
 /* This pulseHeightOK function is commented out because it was decided to implement the threshold
  * as part of the *configuration* JSON instead of the calibration JSON. This is because the threshold
  * as currently envisaged is a constant for all detectors of a given type, and not a calibration parameter.
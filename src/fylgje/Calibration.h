@@ -11,6 +11,8 @@
 #include <iomanip>
 #include <optional>
 #include <cstring>
+#include <cstdint>
+#include <vector>
 
 
 ///\brief Raise a runtime error if the provided vector is not sorted by index
@@ -211,6 +213,79 @@ private:
   Groups groups_;
 };
 
+///\brief The calibrated unit and in-unit pixel of a charge-division readout
+struct CalibrationResult {
+  ///\param unit the unit containing the readout position, or -1 if no unit does
+  int unit{-1};
+  ///\param pixel the pixel within the unit, in the range (0, pixels_per_unit - 1)
+  int pixel{0};
+  ///\brief Whether the readout position belongs to a unit, i.e., passes the calibration filter
+  [[nodiscard]] bool included() const {return unit >= 0;}
+};
+
+
+///\brief A Calibration compiled into per-group lookup tables over the quantized charge-division position
+///\note Every group has RESOLUTION + 1 cells, one per position interval (q, q+1) / RESOLUTION.
+///      A cell holds the results on either side of the single position within it where the result changes,
+///      so a lookup is exact without searching for the unit or evaluating the correction polynomial.
+///      Cells with more than one change, e.g., around a unit edge, are marked and evaluated directly,
+///      as are positions outside of (0, 1) which can not come from non-negative readouts.
+///      A result which changes and changes back within one cell is not detected, but cells are much
+///      narrower than the pixels of any sensible calibration.
+///      The table holds its own copy of the Calibration, so it is unaffected by later edits to the original.
+class CalibrationTable {
+public:
+  ///\param RESOLUTION the number of cells per group covering positions (0, 1)
+  static constexpr int RESOLUTION{2048};
+
+  CalibrationTable() = default;
+  CalibrationTable(const Calibration & calibration, int pixels_per_unit);
+
+  ///\brief Calibrate the readout of a group from its charge-division amplitudes
+  ///\param group the group index
+  ///\param a the amplitude at one end of the group
+  ///\param b the amplitude at the other end of the group
+  ///\returns the same unit and pixel as evaluate(group, a / (a + b))
+  [[nodiscard]] inline CalibrationResult lookup(int group, int a, int b) const {
+    auto pos = static_cast<double>(a) / static_cast<double>(a + b);
+    if (group < 0 || group >= groups_ || !(pos >= 0 && pos <= 1)) return evaluate(group, pos);
+    const auto & cell = cells_[static_cast<size_t>(group) * (RESOLUTION + 1) + static_cast<int>(pos * RESOLUTION)];
+    const auto & entry = pos < cell.split ? cell.below : cell.above;
+    if (entry.unit == DIRECT) return evaluate(group, pos);
+    return {entry.unit, entry.pixel};
+  }
+
+  ///\brief Calibrate a global position without the lookup table
+  ///\param group the group index
+  ///\param pos the global position, a / (a + b)
+  ///\returns the unit containing the position and the pixel of the corrected in-unit position
+  [[nodiscard]] CalibrationResult evaluate(int group, double pos) const;
+
+private:
+  ///\param DIRECT the unit of cell entries whose results must be evaluated directly
+  static constexpr int16_t DIRECT{-2};
+
+  struct Entry {
+    int16_t unit{DIRECT};
+    int16_t pixel{0};
+  };
+  struct Cell {
+    ///\param split the first position in the cell with the result of `above`
+    double split{0};
+    Entry below;
+    Entry above;
+  };
+
+  ///\param calibration_ the compiled calibration, used for direct evaluation
+  Calibration calibration_;
+  ///\param pixels_per_unit_ the number of pixels along each unit
+  int pixels_per_unit_{0};
+  ///\param groups_ the number of groups in the calibration
+  int groups_{0};
+  ///\param cells_ the lookup table cells, RESOLUTION + 1 per group
+  std::vector<Cell> cells_;
+};
+
 ///\brief CalibrationGroup JSON serialization
 ///\param json_out the json object to serialize to
 ///\param group_in the CalibrationGroup object to serialize
@@ -24,6 +24,7 @@ void Configuration::fromJsonFile(std::string fname) {
   getInstrumentConfig();
   getKafkaConfig();
   getPlotConfig();
+  getAutosaveConfig();
   print();
 }
 
@@ -51,6 +52,8 @@ void Configuration::getKafkaConfig() {
       getVal("kafka", "enable.auto.commit", Kafka.EnableAutoCommit);
   Kafka.EnableAutoOffsetStore =
       getVal("kafka", "enable.auto.offset.store", Kafka.EnableAutoOffsetStore);
+  /// Decoding and histogramming threads, each for a partition of the arcs
+  Kafka.IngestThreads = getVal("kafka", "ingest_threads", Kafka.IngestThreads);
 }
 
 void Configuration::getPlotConfig() {
@@ -68,6 +71,14 @@ void Configuration::getPlotConfig() {
   Plot.Height = getVal("plot", "window_height", Plot.Height);
 }
 
+void Configuration::getAutosaveConfig() {
+  // Autosave options - all are optional
+  Autosave.IntervalSeconds =
+      getVal("autosave", "interval_seconds", Autosave.IntervalSeconds);
+  Autosave.Directory = getVal("autosave", "directory", Autosave.Directory);
+  Autosave.Prefix = getVal("autosave", "prefix", Autosave.Prefix);
+}
+
 
 void Configuration::print() {
   fmt::print("[Kafka]\n");
@@ -78,6 +89,7 @@ void Configuration::print() {
   fmt::print("  replica.fetch.max.bytes {}\n", Kafka.ReplicaFetchMaxBytes);
   fmt::print("  enable.auto.commit {}\n", Kafka.EnableAutoCommit);
   fmt::print("  enable.auto.offset.store {}\n", Kafka.EnableAutoOffsetStore);
+  fmt::print("  ingest threads {}\n", Kafka.IngestThreads);
   fmt::print("[Plot]\n");
   fmt::print("  WindowTitle {}\n", Plot.WindowTitle);
   fmt::print("  Clear periodically {}\n", Plot.ClearPeriodic);
@@ -85,6 +97,10 @@ void Configuration::print() {
   fmt::print("  Color gradient {}\n", Plot.ColorGradient);
   fmt::print("  Invert gradient {}\n", Plot.InvertGradient);
   fmt::print("  Log Scale {}\n", Plot.LogScale);
+  fmt::print("[Autosave]\n");
+  fmt::print("  Interval (s) {}\n", Autosave.IntervalSeconds);
+  fmt::print("  Directory {}\n", Autosave.Directory);
+  fmt::print("  Prefix {}\n", Autosave.Prefix);
 }
 
 //\brief getVal() template is used to effectively achieve
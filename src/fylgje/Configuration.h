@@ -39,6 +39,9 @@ public:
   // get the TOF related config options
   void getTOFConfig();
 
+  // get the autosave related config options
+  void getAutosaveConfig();
+
   /// \brief prints the settings
   void print();
 
@@ -64,6 +67,7 @@ public:
     std::string ReplicaFetchMaxBytes{"10000000"};
     std::string EnableAutoCommit{"false"};
     std::string EnableAutoOffsetStore{"false"};
+    int IngestThreads{1};
   };
 
   struct Plot {
@@ -77,9 +81,16 @@ public:
     int Height{900};
   };
 
+  struct Autosave {
+    double IntervalSeconds{0}; // no autosave unless positive
+    std::string Directory{"."};
+    std::string Prefix{"fylgje"};
+  };
+
   struct Instrument Instrument;
   struct Kafka Kafka;
   struct Plot Plot;
+  struct Autosave Autosave;
 
   std::string KafkaConfigFile{""};
   std::vector<std::pair<std::string, std::string>> KafkaConfig;
@@ -5,52 +5,14 @@
 //
 /// \brief Implementation code for data management object
 //===----------------------------------------------------------------------===//
+#include <algorithm>
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <fmt/format.h>
 #include <sstream>
 #include "DataManager.h"
 
-int bifrost::data::hist_a_or_b(int x, int shift, int bins){
-  int y = x >> shift;
-  if (y < 0 || y >= bins) y = -1;
-  return y;
-}
-
-int bifrost::data::hist_p(int x, int shift, int bins){
-  // a and b are effectively 15-bit integers
-  // so a+b is 16-bits, but we want this to fit into BIN2D bins,
-  // so we must shift by an extra bit compared to a or b above
-  int y = x >> (shift + 1);
-  if (y < 0 || y >= bins) y = -1;
-  return y;
-}
-
-int bifrost::data::hist_t(double x, int bins){
-  // time at ESS resets every 1/14 Hz ~= 70 msec.
-  // find the modulus and bin that range
-  double period = 1.0 / 14.0;
-  auto frac = fmod(x, period) / period;
-  auto y = static_cast<int>(frac * bins);
-  if (y < 0 || y >= bins) y = -1;
-  return y;
-}
-
-int bifrost::data::hist_x(int a, int b, int bins){
-  int num = a - b;
-  int den = a + b;
-  if (den == 0) {
-    return false;
-  }
-  double ratio = static_cast<double>(num) / static_cast<double>(den);
-  if (ratio < -1.0 || ratio > 1.0) {
-    return false;
-  }
-  // full range is (-1, 1) so shift up by 1, multiply by 512 and convert to an integer
-  auto x = static_cast<int>((ratio + 1.0) / 2.0 * (bins - 1));
-  if (x < 0 || x >= bins) x = -1;
-  return x;
-}
-
 int bifrost::data::Manager::group(int arc, int triplet) const {
   return arc * triplets + triplet;
 }
@@ -58,123 +20,281 @@ int bifrost::data::Manager::group(int arc, int triplet) const {
 ///\brief Replicate the EFU calculations to identify a unique pixel number
 ///\returns 0 if no valid pixel
 int bifrost::data::Manager::pixel(int arc, int triplet, int a, int b) const {
-  auto g = group(arc, triplet);
-  auto pos = static_cast<double>(a) / static_cast<double>(a + b);
-  auto tube = calibration.getUnitId(g, pos);
-  if (tube < 0) {
+  return pixel(arc, triplet, table.lookup(group(arc, triplet), a, b));
+}
+
+int bifrost::data::Manager::pixel(int arc, int triplet, const CalibrationResult & result) const {
+  if (!result.included()) {
     // invalid global position (outside any unit's range)
     return 0;
   }
-  auto cor_pos = calibration.posCorrection(g, tube, calibration.unitPosition(g, tube,  pos)); // in range (0, 1)
-  // corrected position in (0.0, 1.0) is mapped to a tube pixel in (0, pixels_per_tube - 1)
-  // its offset by which tube it is, which triplet its in, and which arc its in
-  int offset = pixels_per_tube * arc + pixels_per_tube * triplet + pixels_per_tube_arc * tube;
+  // the unit pixel is offset by which tube it is, which triplet its in, and which arc its in
+  int offset = pixels_per_tube * arc + pixels_per_tube * triplet + pixels_per_tube_arc * result.unit;
   // and note that valid pixels index from 1 -- not 0.
-  return 1 + offset + static_cast<int>((pixels_per_tube - 1) * cor_pos);
+  return 1 + offset + result.pixel;
 }
 
 ///\brief Determine if the charge division would give a pixel number, and if the the pulse height is within threshold
 bool bifrost::data::Manager::includes(int arc, int triplet, int a, int b) const {
   auto g = group(arc, triplet);
   if (g < 0) return false;
-
-  auto pos = static_cast<double>(a) / static_cast<double>(a + b);
-  auto tube = calibration.getUnitId(g, pos);
-  if (tube < 0) return false;
-
-  auto unit_pos = calibration.unitPosition(g, tube, pos);
-  if (unit_pos < 0 || unit_pos > 1) return false;
-
 //  return calibration.pulseHeightOK(g, tube, a+b);
-  return true;
+  return table.lookup(g, a, b).included();
+}
+
+void bifrost::data::Manager::recalibrate() {
+  // compiling takes a while, so the histograms are held only to swap the tables
+  CalibrationTable compiled(calibration, pixels_per_tube);
+  std::lock_guard lock(mutex);
+  table = std::move(compiled);
 }
 
 
 bool bifrost::data::Manager::add(int fiber, int group, int a, int b, double time){
+    if (read_only) return false;
+    std::lock_guard lock(mutex);
+    add_pending();
     auto arc_ = arc(group);
     auto triplet_ = triplet(fiber, group);
     if (arc_ < 0 || arc_ >= arcs || triplet_ < 0 || triplet_ >= triplets) {
         return false;
     }
-    auto allowed = includes(arc_, triplet_, a, b);
+    auto calibrated = table.lookup(this->group(arc_, triplet_), a, b);
+    auto allowed = calibrated.included();
     if (allowed) {
-      if (auto p = pixel(arc_, triplet_, a, b); (p > 0 && p <= total_pixels)) {
+      if (auto p = pixel(arc_, triplet_, calibrated); (p > 0 && p <= total_pixels)) {
         pixel_data[p - 1] += 1;
       }
     }
 
+    // every event is counted in the everything histograms and one of included or excluded
+    auto index = triplet_ * arcs + arc_;
+    auto which = allowed ? Filter::positive : Filter::negative;
+    int * all = arena.data() + offset(Filter::none, index);
+    int * filtered = arena.data() + offset(which, index);
+    ++generations[block_index(Filter::none, index)];
+    ++generations[block_index(which, index)];
+
     bool ok{true};
-    ok &= add_1D(arc_, triplet_, a, b, time, allowed);
-    ok &= add_2D(arc_, triplet_, a, b, time, allowed);
+    ok &= add_1D(all, filtered, a, b, time);
+    ok &= add_2D(all, filtered, a, b, time);
     return ok;
 }
 
-bool bifrost::data::Manager::add_1D(int arc, int triplet, int a, int b, double time, bool allowed){
-  auto t_a = std::make_pair(Type::a, hist_a_or_b(a, SHIFT1D, BIN1D));
-  auto t_b = std::make_pair(Type::b, hist_a_or_b(b, SHIFT1D, BIN1D));
-  auto t_p = std::make_pair(Type::p, hist_p(a+b, SHIFT1D, BIN1D));
-  auto t_x = std::make_pair(Type::x, hist_x(a, b, BIN1D));
-  auto t_t = std::make_pair(Type::t, hist_t(time, BIN1D));
-  if (t_a.second < 0 || t_b.second < 0 || t_p.second < 0 || t_x.second < 0 || t_t.second < 0) {
+bool bifrost::data::Manager::add_1D(int * all, int * filtered, int a, int b, double time){
+  auto h_a = hist_a_or_b(a, SHIFT1D, BIN1D);
+  auto h_b = hist_a_or_b(b, SHIFT1D, BIN1D);
+  auto h_p = hist_p(a+b, SHIFT1D, BIN1D);
+  auto h_x = hist_x(a, b, BIN1D);
+  auto h_t = hist_t(time, BIN1D);
+  if (h_a < 0 || h_b < 0 || h_p < 0 || h_x < 0 || h_t < 0) {
       return false;
   }
-  std::vector<std::pair<map_t<data_t> *, bool>> each{{{&everything, true}, {&included, allowed}, {&excluded, !allowed}}};
-  for (auto & [data, tf]: each) {
-    if (tf) {
-      for (auto [t, h]: {t_a, t_b, t_p, t_x, t_t}) {
-        auto this_key = this->key(arc, triplet, t);
-        if (!data->count(this_key)) {
-          std::stringstream ss;
-          ss << t;
-          fmt::print("arc={}, triplet={}, type={} does not exist in managed data\n", arc, triplet, ss.str());
-          return false;
-        }
-        if (static_cast<size_t>(h) < data->at(this_key).size()) {
-          data->at(this_key).at(h) += 1;
-        } else {
-          std::stringstream ss;
-          ss << t;
-          fmt::print("arc={}, triplet={}, type={} at a={}, b={} time={} given out of bound index {}\n", arc, triplet,
-                     ss.str(), a, b, time, h);
-        }
-      }
-    }
-  }
+  count_1D(all, filtered, h_a, h_b, h_p, h_x, h_t);
   return true;
 }
 
-bool bifrost::data::Manager::add_2D(int arc, int triplet, int full_a, int full_b, double full_t, bool allowed){
+bool bifrost::data::Manager::add_2D(int * all, int * filtered, int full_a, int full_b, double full_t){
   auto a = hist_a_or_b(full_a, SHIFT2D, BIN2D);
   auto b = hist_a_or_b(full_b, SHIFT2D, BIN2D);
   auto p = hist_p(full_a+full_b, SHIFT2D, BIN2D);
   auto x = hist_x(full_a, full_b, BIN2D);
   auto t = hist_t(full_t, BIN2D);
   if (a < 0 || b < 0 || p < 0 || x < 0 || t < 0) return false;
-  std::vector<std::tuple<Type, int, int>> t_i_j {{Type::ab, a, b}, {Type::pt, p, t}, {Type::xt, x, t}, {Type::xp, x, p}};
-  std::vector<std::pair<map_t<data_t> *, bool>> each{{{&everything, true}, {&included, allowed}, {&excluded, !allowed}}};
-  for (auto & [data, tf]: each) {
-    if (tf) {
-      for (auto [y, i, j]: t_i_j) {
-        auto this_key = this->key(arc, triplet, y);
-        if (!data->count(this_key)) {
-          std::stringstream ss;
-          ss << y;
-          fmt::print("arc={}, triplet={}, type={} does not exist in managed data\n", arc, triplet, ss.str());
-          return false;
+  count_2D(all, filtered, a, b, p, x, t);
+  return true;
+}
+
+namespace {
+  ///\brief Increment one bin of a histogram type in the values of one (arc, triplet), and its running maximum
+  inline void count(int * block, bifrost::data::Type t, int bin){
+    using namespace bifrost::data;
+    auto value = ++block[type_offset(t) + bin];
+    auto & peak = block[BLOCK + static_cast<size_t>(t)];
+    peak = std::max(peak, value);
+  }
+}
+
+void bifrost::data::Manager::count_1D(int * all, int * filtered, int a, int b, int p, int x, int t){
+  // all bin numbers are within [0, BIN1D), so no further checks are needed
+  for (int * block: {all, filtered}) {
+    count(block, Type::a, a);
+    count(block, Type::b, b);
+    count(block, Type::p, p);
+    count(block, Type::x, x);
+    count(block, Type::t, t);
+  }
+}
+
+void bifrost::data::Manager::count_2D(int * all, int * filtered, int a, int b, int p, int x, int t){
+  for (int * block: {all, filtered}) {
+    count(block, Type::ab, a * BIN2D + b);
+    count(block, Type::pt, p * BIN2D + t);
+    count(block, Type::xt, x * BIN2D + t);
+    count(block, Type::xp, x * BIN2D + p);
+  }
+}
+
+namespace {
+  ///\brief Find the bin numbers of n readouts for one histogram resolution, -1 marks out of range values
+  void bin_readouts(const int * a, const int * b, const double * time, size_t n, int shift, int bins,
+                    int * ha, int * hb, int * hp, int * hx, int * ht){
+    using namespace bifrost::data;
+    for (size_t i = 0; i < n; ++i) {
+      ha[i] = hist_a_or_b(a[i], shift, bins);
+      hb[i] = hist_a_or_b(b[i], shift, bins);
+      hp[i] = hist_p(a[i] + b[i], shift, bins);
+    }
+    for (size_t i = 0; i < n; ++i) hx[i] = hist_x(a[i], b[i], bins);
+    for (size_t i = 0; i < n; ++i) ht[i] = hist_t(time[i], bins);
+  }
+
+  ///\brief Prefetch the 2-D histogram bins of one event within the bins of one (arc, triplet)
+  void prefetch_2D(const int * block, int a, int b, int p, int x, int t){
+    using namespace bifrost::data;
+    __builtin_prefetch(block + type_offset(Type::ab) + a * BIN2D + b, 1);
+    __builtin_prefetch(block + type_offset(Type::pt) + p * BIN2D + t, 1);
+    __builtin_prefetch(block + type_offset(Type::xt) + x * BIN2D + t, 1);
+    __builtin_prefetch(block + type_offset(Type::xp) + x * BIN2D + p, 1);
+  }
+}
+
+size_t bifrost::data::Manager::add_batch(const Batch & batch){
+  if (read_only) return 0;
+  std::unique_lock lock(mutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    keep_aside(pending, pending_clears, batch);
+    return 0;
+  }
+  return add_pending() + add_locked(batch);
+}
+
+size_t bifrost::data::Manager::flush(){
+  std::unique_lock lock(mutex, std::try_to_lock);
+  return lock.owns_lock() ? add_pending() : 0;
+}
+
+size_t bifrost::data::Manager::drain(){
+  std::lock_guard lock(mutex);
+  auto accepted = add_pending();
+  for (int p = 0; p < partition_count(); ++p) accepted += add_pending(p);
+  return accepted;
+}
+
+void bifrost::data::Manager::keep_aside(Batch & kept, uint64_t & kept_clears, const Batch & batch) const {
+  // everything kept so far arrived before the clear, unlike this batch which is kept
+  if (const auto now = clears.load(); now != kept_clears) {
+    kept.clear();
+    kept_clears = now;
+  }
+  kept.append(batch);
+}
+
+size_t bifrost::data::Manager::add_pending(int partition){
+  auto & kept = partition < 0 ? pending : partitions[partition]->pending;
+  auto & kept_clears = partition < 0 ? pending_clears : partitions[partition]->pending_clears;
+  // the histograms are locked, so no clear() can happen meanwhile
+  const auto now = clears.load();
+  size_t accepted{0};
+  if (kept_clears == now) accepted = add_locked(kept, partition);
+  kept.clear();
+  kept_clears = now;
+  return accepted;
+}
+
+size_t bifrost::data::Manager::add_batch(const Batch & batch, int partition){
+  if (read_only || partition < 0 || partition >= partition_count()) return 0;
+  std::shared_lock lock(mutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    keep_aside(partitions[partition]->pending, partitions[partition]->pending_clears, batch);
+    return 0;
+  }
+  return add_pending(partition) + add_locked(batch, partition);
+}
+
+void bifrost::data::Manager::set_partitions(int count){
+  std::lock_guard lock(mutex);
+  count = std::clamp(count, 1, arcs);
+  // nothing kept aside or counted by the current partitions is lost
+  for (int p = 0; p < partition_count(); ++p) {
+    add_pending(p);
+    std::transform(pixel_data.begin(), pixel_data.end(), partitions[p]->pixels.begin(), pixel_data.begin(), std::plus<>());
+  }
+  partitions.clear();
+  for (int p = 0; p < count; ++p) {
+    partitions.push_back(std::make_unique<Partition>());
+    partitions.back()->pixels.resize(total_pixels, 0);
+  }
+}
+
+size_t bifrost::data::Manager::add_locked(const Batch & batch, int partition){
+  // The batch is handled in chunks which stay in the L1 cache. For each chunk all bin numbers are found first,
+  // in loops without dependencies between events which the compiler vectorizes, and then scattered into the arena.
+  constexpr size_t CHUNK{256};
+  constexpr size_t AHEAD{16};
+  int index[CHUNK], a1[CHUNK], b1[CHUNK], p1[CHUNK], x1[CHUNK], t1[CHUNK];
+  int a2[CHUNK], b2[CHUNK], p2[CHUNK], x2[CHUNK], t2[CHUNK];
+  size_t filtered[CHUNK]; // block_index of the filtered histograms
+  // concurrent partitions write only to the histograms of their own arcs, and their own pixel counts
+  const int owners = partition < 0 ? 1 : partition_count();
+  const int owner = partition < 0 ? 0 : partition;
+  auto & pixels = partition < 0 ? pixel_data : partitions[partition]->pixels;
+
+  size_t accepted{0};
+  for (size_t first = 0; first < batch.size(); first += CHUNK) {
+    const auto n = std::min(CHUNK, batch.size() - first);
+    const int * fiber = batch.fiber.data() + first;
+    const int * group = batch.group.data() + first;
+    const int * a = batch.a.data() + first;
+    const int * b = batch.b.data() + first;
+    const double * time = batch.time.data() + first;
+
+    for (size_t i = 0; i < n; ++i) {
+      auto arc_ = arc(group[i]);
+      auto triplet_ = triplet(fiber[i], group[i]);
+      bool valid = (arc_ >= 0) & (arc_ < arcs) & (triplet_ >= 0) & (triplet_ < triplets);
+      valid &= arc_ % owners == owner;
+      index[i] = valid ? triplet_ * arcs + arc_ : -1;
+    }
+    bin_readouts(a, b, time, n, SHIFT1D, BIN1D, a1, b1, p1, x1, t1);
+    bin_readouts(a, b, time, n, SHIFT2D, BIN2D, a2, b2, p2, x2, t2);
+
+    // the calibration decides which of the filtered histograms each event goes to
+    for (size_t i = 0; i < n; ++i) {
+      if (index[i] < 0) continue;
+      auto arc_ = index[i] % arcs;
+      auto triplet_ = index[i] / arcs;
+      auto calibrated = table.lookup(this->group(arc_, triplet_), a[i], b[i]);
+      auto allowed = calibrated.included();
+      if (allowed) {
+        if (auto p = pixel(arc_, triplet_, calibrated); (p > 0 && p <= total_pixels)) {
+          pixels[p - 1] += 1;
         }
-        auto ij = i * BIN2D + j;
-        if (static_cast<size_t>(ij) < data->at(this_key).size()) {
-          data->at(this_key).at(ij) += 1;
-        } else {
-          std::stringstream ss;
-          ss << y;
-          fmt::print("arc={}, triplet={}, type={} at a={}, b={} time={} given out of bound index ({}, {})\n", arc,
-                     triplet, ss.str(), full_a, full_b, full_t, i, j);
+      }
+      filtered[i] = block_index(allowed ? Filter::positive : Filter::negative, index[i]);
+    }
+
+    // invalid bins are -1, so any negative bin makes the bitwise or negative
+    auto ok_1D = [&](size_t i){return index[i] >= 0 && (a1[i] | b1[i] | p1[i] | x1[i] | t1[i]) >= 0;};
+    auto ok_2D = [&](size_t i){return index[i] >= 0 && (a2[i] | b2[i] | p2[i] | x2[i] | t2[i]) >= 0;};
+    for (size_t i = 0; i < n; ++i) {
+      // the 2-D histograms are much larger than the caches, so their bins are fetched a few events ahead
+      if (auto j = i + AHEAD; j < n && ok_2D(j)) {
+        for (auto o: {offset(Filter::none, index[j]), filtered[j] * STRIDE}) {
+          prefetch_2D(arena.data() + o, a2[j], b2[j], p2[j], x2[j], t2[j]);
         }
       }
+      if (index[i] < 0) continue;
+      int * all = arena.data() + offset(Filter::none, index[i]);
+      int * block = arena.data() + filtered[i] * STRIDE;
+      ++generations[block_index(Filter::none, index[i])];
+      ++generations[filtered[i]];
+      if (ok_1D(i)) count_1D(all, block, a1[i], b1[i], p1[i], x1[i], t1[i]);
+      if (ok_2D(i)) count_2D(all, block, a2[i], b2[i], p2[i], x2[i], t2[i]);
+      if (ok_1D(i) && ok_2D(i)) ++accepted;
     }
   }
-  return true;
+  return accepted;
 }
 
 double bifrost::data::Manager::max(Filter which) const {
@@ -207,6 +327,7 @@ double bifrost::data::Manager::max(int arc, int triplet, bifrost::data::Type t,
 }
 
 double bifrost::data::Manager::max(bifrost::data::key_t k, Filter which) const {
+  std::lock_guard lock(mutex);
   return is_1D(key_type(k)) ? max_1D(k, which) : max_2D(k, which);
 }
 
@@ -240,6 +361,7 @@ double bifrost::data::Manager::min(int arc, int triplet, bifrost::data::Type t,
 }
 
 double bifrost::data::Manager::min(bifrost::data::key_t k, Filter which) const {
+  std::lock_guard lock(mutex);
   return is_1D(key_type(k)) ? min_1D(k, which) : min_2D(k, which);
 }
 
@@ -248,68 +370,141 @@ bifrost::data::Manager::D1 bifrost::data::Manager::data_1D(int arc, int triplet,
   return data_1D(this->key(arc, triplet, t), which);
 }
 
-bifrost::data::Manager::D1 bifrost::data::Manager::data_1D(bifrost::data::key_t k, Filter which) const {
-    auto d = bifrost::data::Manager::D1();
-    auto this_type = key_type(k);
-    const auto & data{which == Filter::none ? everything : which == Filter::positive ? included : excluded};
-    if (data.count(k) && bins_1d.count(this_type)){
-      auto full = data.at(k);
-      auto bins = bins_1d.at(this_type);
-      d.reserve(bins);
-      for (int i=0; i<bins; ++i) d.push_back(0.);
-      if (BIN1D == bins){
-        for (int i=0; i<BIN1D; ++i){
-          d[i] = full.at(i);
+const bifrost::data::Manager::View & bifrost::data::Manager::view(bifrost::data::key_t k, Filter which) const {
+  auto this_type = key_type(k);
+  auto [nx, ny] = is_1D(this_type) ? std::make_pair(bins_1d.at(this_type), 1) : bins_2D(this_type);
+  auto generation = generations[block_index(which, static_cast<int>(k % (arcs * triplets)))];
+  auto & v = views[static_cast<size_t>(which) * key_count() + k];
+  if (v.generation == generation && v.nx == nx && v.ny == ny) return v;
+
+  // only the display bins changed, not the data
+  const bool unchanged = v.generation == generation;
+  v.generation = generation;
+  v.nx = nx;
+  v.ny = ny;
+  v.data.clear();
+  const int * full = histogram(k, which);
+  int high{std::numeric_limits<int>::lowest()}, low{(std::numeric_limits<int>::max)()};
+  if (is_1D(this_type)) {
+    if (BIN1D == nx){
+      for (int i=0; i<BIN1D; ++i){
+        high = std::max(high, full[i]);
+        low = std::min(low, full[i]);
+      }
+    } else {
+      v.data.resize(nx, 0.);
+      auto r = BIN1D / nx; // since all bins are powers of two, this is as well
+      for (int i=0; i < nx; ++i){
+        int tmp{0};
+        for (int j=0; j < r; ++j){
+          tmp += full[i*r + j];
         }
-      } else {
-        auto r = BIN1D / bins; // since all bins are powers of two, this is as well
-        for (int i=0; i < bins; ++i){
-          for (int j=0; j < r; ++j){
-            d[i] += full.at(i*r + j);
+        v.data[i] = static_cast<double>(tmp) / r;
+        tmp = tmp ? tmp/r ? tmp/r : 1 : 0;
+        high = std::max(high, tmp);
+        low = std::min(low, tmp);
+      }
+    }
+    v.max = high;
+    v.min = low;
+  } else {
+    double norm{static_cast<double>(BIN2D)*static_cast<double>(BIN2D)/static_cast<double>(nx)/static_cast<double>(ny)};
+    if (nx == BIN2D && ny == BIN2D){
+      // the histogram is shown as it is, so a rebinned copy is not kept
+      std::vector<double>().swap(v.data);
+      for (int i=0; i < BIN2D * BIN2D; ++i){
+        high = std::max(high, full[i]);
+        low = std::min(low, full[i]);
+      }
+    } else {
+      v.data.assign(static_cast<size_t>(nx) * ny, 0.);
+      auto rx = BIN2D / nx;
+      auto ry = BIN2D / ny;
+      // Once data was added, rebinning in one pass over the histogram is cheapest. A summed-area table, which
+      // holds the sum of all bins below (x, y) at (x * (BIN2D + 1) + y), takes such a pass as well, but then
+      // gives each display bin in four lookups; so it is kept for the last histogram whose display bins changed
+      // without new data, e.g., while paused, and reused for its further display bins.
+      constexpr int N{BIN2D + 1};
+      auto & t = area.sums;
+      bool tabled = area.key == k && area.which == which && area.generation == generation && !t.empty();
+      if (!tabled && unchanged) {
+        t.assign(static_cast<size_t>(N) * N, 0);
+        for (int x=0; x < BIN2D; ++x){
+          int64_t row{0};
+          for (int y=0; y < BIN2D; ++y){
+            row += full[x * BIN2D + y];
+            t[(x + 1) * N + y + 1] = t[x * N + y + 1] + row;
+          }
+        }
+        area.key = k;
+        area.which = which;
+        area.generation = generation;
+        tabled = true;
+      }
+      if (tabled) {
+        for (int ix=0; ix < nx; ++ix){
+          auto x0 = ix * rx * N, x1 = (ix + 1) * rx * N;
+          for (int iy=0; iy < ny; ++iy){
+            auto y0 = iy * ry, y1 = (iy + 1) * ry;
+            v.data[ix * ny + iy] = static_cast<double>(t[x1 + y1] - t[x0 + y1] - t[x1 + y0] + t[x0 + y0]);
           }
-          d[i] /= r;
         }
+      } else {
+        for (int x=0; x < BIN2D; ++x){
+          double * row = v.data.data() + static_cast<size_t>(x / rx) * ny;
+          for (int y=0; y < BIN2D; ++y) row[y / ry] += full[x * BIN2D + y];
+        }
+      }
+      // the sums of up to 2^18 int bins are exact as doubles
+      for (auto & d: v.data){
+        auto tmp = static_cast<int>(d);
+        high = std::max(high, tmp);
+        low = std::min(low, tmp);
+        d = tmp / norm;
       }
     }
-    return d;
+    v.max = static_cast<int>(std::ceil(static_cast<double>(high)/norm));
+    v.min = static_cast<int>(std::ceil(static_cast<double>(low)/norm));
+  }
+  return v;
 }
 
-bifrost::data::Manager::D2 * bifrost::data::Manager::data_2D(int arc, int triplet, bifrost::data::Type t, Filter which) const {
-  return data_2D(key(arc, triplet, t), which);
+bifrost::data::Manager::D1 bifrost::data::Manager::data_1D(bifrost::data::key_t k, Filter which) const {
+    std::lock_guard lock(mutex);
+    auto this_type = key_type(k);
+    const int * full = histogram(k, which);
+    if (!full || !bins_1d.count(this_type)) return {};
+    if (BIN1D == bins_1d.at(this_type)) return D1(full, full + BIN1D);
+    return view(k, which).data;
 }
 
-bifrost::data::Manager::D2 * bifrost::data::Manager::data_2D(bifrost::data::key_t k, Filter which) const {
+bifrost::data::Manager::D2 * bifrost::data::Manager::data_2D(int arc, int triplet, bifrost::data::Type t, Filter which, D2 * into) const {
+  return data_2D(key(arc, triplet, t), which, into);
+}
+
+bifrost::data::Manager::D2 * bifrost::data::Manager::data_2D(bifrost::data::key_t k, Filter which, D2 * into) const {
+  std::lock_guard lock(mutex);
   // translate 2d to 1d axes
   auto this_type = key_type(k);
   auto [nx, ny] = bins_2D(this_type);
   int bx{BIN2D/nx/2}, by{BIN2D/ny/2};
-  double norm{static_cast<double>(BIN2D)*static_cast<double>(BIN2D)/static_cast<double>(nx)/static_cast<double>(ny)};
 
-  auto d = new ::bifrost::data::Manager::D2(nx, ny, QCPRange(bx, BIN2D-bx), QCPRange(by, BIN2D-by));
-  d->fill(0);
-  const auto & data{which == Filter::none ? everything : which == Filter::positive ? included : excluded};
-  if (data.count(k)){
-    auto full = data.at(k);
-    if (nx == BIN2D && ny == BIN2D){
-      for (int ix=0; ix < nx; ++ix){
-        for (int iy=0; iy < ny; ++iy){
-          d->setCell(ix, iy, full.at(ix * BIN2D + iy));
-        }
-      }
-    } else {
-      auto rx = BIN2D / nx;
-      auto ry = BIN2D / ny;
-      for (int ix=0; ix < nx; ++ix){
-        for (int iy=0; iy < ny; ++iy){
-          double tmp{0.};
-          for (int jx=0; jx < rx; ++jx){
-            for (int jy=0; jy < ry; ++jy){
-              auto z = (ix * rx + jx) * BIN2D + (iy * ry + jy);
-              tmp += full.at(z);
-            }
-          }
-          d->setCell(ix, iy, tmp/norm);
-        }
+  auto d = into;
+  if (d) {
+    if (d->keySize() != nx || d->valueSize() != ny) d->setSize(nx, ny);
+    d->setRange(QCPRange(bx, BIN2D-bx), QCPRange(by, BIN2D-by));
+  } else {
+    d = new ::bifrost::data::Manager::D2(nx, ny, QCPRange(bx, BIN2D-bx), QCPRange(by, BIN2D-by));
+  }
+  const int * full = histogram(k, which);
+  if (!full){
+    d->fill(0);
+  } else {
+    const bool native{nx == BIN2D && ny == BIN2D};
+    const double * rebinned = native ? nullptr : view(k, which).data.data();
+    for (int ix=0; ix < nx; ++ix){
+      for (int iy=0; iy < ny; ++iy){
+        d->setCell(ix, iy, native ? full[ix * BIN2D + iy] : rebinned[ix * ny + iy]);
       }
     }
   }
@@ -318,123 +513,33 @@ bifrost::data::Manager::D2 * bifrost::data::Manager::data_2D(bifrost::data::key_
 
 
 int bifrost::data::Manager::max_1D(bifrost::data::key_t k, Filter which) const {
-  int value{std::numeric_limits<int>::lowest()};
   auto this_type = key_type(k);
-  const auto & data{which == Filter::none ? everything : which == Filter::positive ? included : excluded};
-  if (data.count(k) && bins_1d.count(this_type)){
-    auto full = data.at(k);
-    auto bins = bins_1d.at(this_type);
-    if (BIN1D == bins){
-      for (int i=0; i<BIN1D; ++i){
-        if (full.at(i) > value) value = full.at(i);
-      }
-    } else {
-      auto r = BIN1D / bins; // since all bins are powers of two, this is as well
-      for (int i=0; i < bins; ++i){
-        int tmp{0};
-        for (int j=0; j < r; ++j){
-          tmp += full.at(i*r + j);
-        }
-        tmp = tmp ? tmp/r ? tmp/r : 1 : 0;
-        if (tmp > value) value = tmp;
-      }
-    }
-  }
-  return value;
+  const int * full = histogram(k, which);
+  if (!full || !bins_1d.count(this_type)) return std::numeric_limits<int>::lowest();
+  // the running maximum is kept for the full resolution histograms
+  if (BIN1D == bins_1d.at(this_type)) return peak(k, which);
+  return view(k, which).max;
 }
 
 int bifrost::data::Manager::max_2D(bifrost::data::key_t k, Filter which) const {
-  auto [nx, ny] = bins_2D(key_type(k));
-  int value{std::numeric_limits<int>::lowest()};
-  double norm{static_cast<double>(BIN2D)*static_cast<double>(BIN2D)/static_cast<double>(nx)/static_cast<double>(ny)};
-  const auto & data{which == Filter::none ? everything : which == Filter::positive ? included : excluded};
-  if (data.count(k)){
-    auto & full = data.at(k);
-    if (nx == BIN2D && ny == BIN2D){
-      for (int ix=0; ix < nx; ++ix){
-        for (int iy=0; iy < ny; ++iy){
-          if (full.at(ix * BIN2D + iy) > value) value = full.at(ix * BIN2D + iy);
-        }
-      }
-    } else {
-      auto rx = BIN2D / nx;
-      auto ry = BIN2D / ny;
-      for (int ix=0; ix < nx; ++ix){
-        for (int iy=0; iy < ny; ++iy){
-          int tmp{0};
-          for (int jx=0; jx < rx; ++jx){
-            for (int jy=0; jy < ry; ++jy){
-              auto z = (ix * rx + jx) * BIN2D + (iy * ry + jy);
-              tmp += full.at(z);
-            }
-          }
-          if (tmp > value) value = tmp;
-        }
-      }
-    }
-  }
-  return static_cast<int>(std::ceil(static_cast<double>(value)/norm));
+  auto this_type = key_type(k);
+  auto [nx, ny] = bins_2D(this_type);
+  const int * full = histogram(k, which);
+  if (!full) return std::numeric_limits<int>::lowest();
+  if (nx == BIN2D && ny == BIN2D) return peak(k, which);
+  return view(k, which).max;
 }
 
 
 int bifrost::data::Manager::min_1D(bifrost::data::key_t k, Filter which) const {
   auto this_type = key_type(k);
-  int value{(std::numeric_limits<int>::max)()};
-  const auto & data{which == Filter::none ? everything : which == Filter::positive ? included : excluded};
-  if (data.count(k) && bins_1d.count(this_type)){
-    auto full = data.at(k);
-    auto bins = bins_1d.at(this_type);
-    if (BIN1D == bins){
-      for (int i=0; i<BIN1D; ++i){
-        if (full.at(i) < value) value = full.at(i);
-      }
-    } else {
-      auto r = BIN1D / bins; // since all bins are powers of two, this is as well
-      for (int i=0; i < bins; ++i){
-        int tmp{0};
-        for (int j=0; j < r; ++j){
-          tmp += full.at(i*r + j);
-        }
-        tmp = tmp ? tmp/r ? tmp/r : 1 : 0;
-        if (tmp < value) value = tmp;
-      }
-    }
-  }
-  return value;
+  if (!histogram(k, which) || !bins_1d.count(this_type)) return (std::numeric_limits<int>::max)();
+  return view(k, which).min;
 }
 
 int bifrost::data::Manager::min_2D(bifrost::data::key_t k, Filter which) const {
-  auto this_type = key_type(k);
-  auto [nx, ny] = bins_2D(this_type);
-  double norm{static_cast<double>(BIN2D)*static_cast<double>(BIN2D)/static_cast<double>(nx)/static_cast<double>(ny)};
-  int value{(std::numeric_limits<int>::max)()};
-  const auto & data{which == Filter::none ? everything : which == Filter::positive ? included : excluded};
-  if (data.count(k)){
-    auto full = data.at(k);
-    if (nx == BIN2D && ny == BIN2D){
-      for (int ix=0; ix < nx; ++ix){
-        for (int iy=0; iy < ny; ++iy){
-          if (full.at(ix * BIN2D + iy) < value) value = full.at(ix * BIN2D + iy);
-        }
-      }
-    } else {
-      auto rx = BIN2D / nx;
-      auto ry = BIN2D / ny;
-      for (int ix=0; ix < nx; ++ix){
-        for (int iy=0; iy < ny; ++iy){
-          int tmp{0};
-          for (int jx=0; jx < rx; ++jx){
-            for (int jy=0; jy < ry; ++jy){
-              auto z = (ix * rx + jx) * BIN2D + (iy * ry + jy);
-              tmp += full.at(z);
-            }
-          }
-          if (tmp < value) value = tmp;
-        }
-      }
-    }
-  }
-  return static_cast<int>(std::ceil(static_cast<double>(value)/norm));
+  if (!histogram(k, which)) return (std::numeric_limits<int>::max)();
+  return view(k, which).min;
 }
 
 
@@ -509,7 +614,7 @@ std::vector<uint64_t> bifrost::data::Manager::type_dimensions(Type type) const{
   }
 }
 
-void bifrost::data::Manager::save_to(hdf5::node::Group group) const {
+void bifrost::data::Manager::save_to(hdf5::node::Group group, const progress_t & progress) const {
   std::string creator{"fylgje"};
   std::string version{"v0.0.1"};
   std::string instrument{"BIFROST"};
@@ -521,20 +626,36 @@ void bifrost::data::Manager::save_to(hdf5::node::Group group) const {
   group.attributes.create_from("triplets", triplets);
   group.attributes.create_from("tubes", tubes_per_triplet);
   group.attributes.create_from("pixels", pixels_per_tube);
+  // the histograms keep changing while they are written, see the copied attribute of each triplet
+  std::string snapshot{"per (arc, triplet)"};
+  group.attributes.create_from("snapshot", snapshot);
 
   std::vector<std::string> pixel_order{{"arcs", "tubes", "triplets"}};
   std::vector<std::string> data_order{{"arc"}, {"triplets"}, {"type"}};
   group.attributes.create_from("pixel_order", pixel_order);
   group.attributes.create_from("data_order", data_order);
 
-  std::vector<std::pair<std::string, const map_t<data_t>*>> pairs{
-      {{"everything", &everything}, {"included", &included}, {"excluded", &excluded}}
+  std::vector<std::pair<std::string, Filter>> pairs{
+      {{"everything", Filter::none}, {"included", Filter::positive}, {"excluded", Filter::negative}}
   };
   // all datasets are integer valued
   auto datatype = hdf5::datatype::create<int>();
-  // and we know their final size already, so use contiguous layout
+  // the small axes are contiguous
   hdf5::property::DatasetCreationList datasetCreationList;
   datasetCreationList.layout(hdf5::property::DatasetLayout::Contiguous);
+  // while the mostly empty histograms are chunked and compressed, 2-D histograms in square tiles
+  auto compressed = [](const std::vector<uint64_t> & dimensions){
+    hdf5::property::DatasetCreationList list;
+    list.layout(hdf5::property::DatasetLayout::Chunked);
+    hdf5::Dimensions chunk(dimensions.begin(), dimensions.end());
+    if (chunk.size() > 1) for (auto & c: chunk) c = std::min<hdf5::Dimensions::value_type>(c, 128);
+    list.chunk(chunk);
+    hdf5::filter::Shuffle()(list);
+    hdf5::filter::Deflate(4u)(list);
+    return list;
+  };
+  std::map<Type, hdf5::property::DatasetCreationList> histogramCreationLists;
+  for (auto k: TYPEND) histogramCreationLists.emplace(k, compressed(type_dimensions(k)));
 
   // bin center values for 1-D and 2-D axes:
   // TODO add units for each axis
@@ -554,19 +675,37 @@ void bifrost::data::Manager::save_to(hdf5::node::Group group) const {
     d2.write(axis(t, BIN2D+1));
   }
   std::string intensity_unit{"counts"};
-  for (auto & [name, data]: pairs){
-    auto dg = group.create_group(name);
-    for (int a = 0; a < arcs; ++a){
-      auto arc_name = fmt::format("arc{}", a);
-      auto da = dg.create_group(arc_name);
-      for (int t = 0; t < triplets; ++t){
-        auto triplet_name = fmt::format("triplet{}", t);
-        auto dt = da.create_group(triplet_name);
+  std::vector<hdf5::node::Group> filter_groups;
+  for (auto & [name, which]: pairs) filter_groups.push_back(group.create_group(name));
+
+  // Copying the whole arena at once would keep the histograms held for far too long, so each (arc, triplet)
+  // is copied and written in turn. Its filters are copied together, so that everything = included + excluded.
+  const int total = arcs * triplets + 1;
+  int done{0};
+  data_t copy(pairs.size() * BLOCK);
+  for (int a = 0; a < arcs; ++a){
+    auto arc_name = fmt::format("arc{}", a);
+    std::vector<hdf5::node::Group> arc_groups;
+    for (auto & dg: filter_groups) arc_groups.push_back(dg.create_group(arc_name));
+    for (int t = 0; t < triplets; ++t){
+      int64_t copied;
+      {
+        auto lock = hold();
+        copied = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        for (size_t f = 0; f < pairs.size(); ++f){
+          const int * block = arena.data() + offset(pairs[f].second, t * arcs + a);
+          std::copy(block, block + BLOCK, copy.begin() + static_cast<std::ptrdiff_t>(f * BLOCK));
+        }
+      }
+      auto triplet_name = fmt::format("triplet{}", t);
+      for (size_t f = 0; f < pairs.size(); ++f){
+        auto dt = arc_groups[f].create_group(triplet_name);
+        dt.attributes.create_from("copied", copied);
         for (auto k: TYPEND){
           auto dataset_name = type_dataset_name(k);
           auto dsg = dt.create_group(dataset_name);
           auto dataspace = hdf5::dataspace::Simple(type_dimensions(k));
-          auto ds = dsg.create_dataset("signal", datatype, dataspace, datasetCreationList);
+          auto ds = dsg.create_dataset("signal", datatype, dataspace, histogramCreationLists.at(k));
           auto the_axes = axes_names(k);
           auto nax = the_axes.size();
           for (auto & ax: the_axes){
@@ -575,28 +714,39 @@ void bifrost::data::Manager::save_to(hdf5::node::Group group) const {
           }
           ds.attributes.create_from("axes", the_axes);
           ds.attributes.create_from("unit", intensity_unit);
-          ds.write(data->at(key(a, t, k)));
+          const int * bins = copy.data() + f * BLOCK + type_offset(k);
+          ds.write(data_t(bins, bins + type_bins(k)));
         }
       }
+      if (progress) progress(++done, total);
+    }
+  }
+  // plus stash the pixel data, summed over the partitions which counted them:
+  data_t pixels(pixel_data.size());
+  {
+    auto lock = hold();
+    pixels = pixel_data;
+    for (const auto & p: partitions) {
+      std::transform(pixels.begin(), pixels.end(), p->pixels.begin(), pixels.begin(), std::plus<>());
     }
   }
-  // plus stash the pixel data:
-  auto dimensions = hdf5::Dimensions({pixel_data.size()});
+  auto dimensions = hdf5::Dimensions({pixels.size()});
   auto pixeldataspace = hdf5::dataspace::Simple(dimensions);
-  auto pds = group.create_dataset("pixels", datatype, pixeldataspace, datasetCreationList);
+  auto pds = group.create_dataset("pixels", datatype, pixeldataspace, compressed(std::vector<uint64_t>(dimensions.begin(), dimensions.end())));
   pds.attributes.create_from("wrap_order", pixel_order);
-  pds.write(pixel_data);
+  pds.write(pixels);
+  if (progress) progress(++done, total);
 }
-void bifrost::data::Manager::save_to(hdf5::file::File file, std::optional<std::string> group) const {
+void bifrost::data::Manager::save_to(hdf5::file::File file, std::optional<std::string> group, const progress_t & progress) const {
   auto root = file.root();
   std::string name = group.value_or("fylgje");
   if (root.has_group(name)){
     throw std::runtime_error(fmt::format("The provided file already has the group /{}", name));
   }
   auto gr = root.create_group(name);
-  save_to(gr);
+  save_to(gr, progress);
 }
-void bifrost::data::Manager::save_to(std::filesystem::path file, std::optional<std::string> group) const{
+void bifrost::data::Manager::save_to(std::filesystem::path file, std::optional<std::string> group, const progress_t & progress) const{
   namespace fs = std::filesystem;
   auto status = fs::status(file);
   hdf5::file::File hdf5_file;
@@ -612,5 +762,58 @@ void bifrost::data::Manager::save_to(std::filesystem::path file, std::optional<s
     throw std::runtime_error(fmt::format("{} exists but is not a file", std::string(file)));
   }
 
-  save_to(hdf5_file, group);
-}
\ No newline at end of file
+  save_to(hdf5_file, group, progress);
+}
+
+std::unique_ptr<bifrost::data::Manager> bifrost::data::Manager::load_from(hdf5::node::Group group, Calibration & calib) {
+  auto attribute = [&group](const std::string & name){
+    int value{0};
+    group.attributes[name].read(value);
+    return value;
+  };
+  auto manager = std::make_unique<Manager>(attribute("arcs"), attribute("triplets"), attribute("tubes"), attribute("pixels"), calib);
+  auto & m = *manager;
+  m.read_only = true;
+
+  // each dataset is read into its place in the arena, checking only that it has the expected number of values
+  auto read_into = [&group](const std::string & path, int * values, size_t count){
+    auto dataset = group.get_dataset(hdf5::Path(path));
+    if (static_cast<size_t>(dataset.dataspace().size()) != count) {
+      throw std::runtime_error(fmt::format("{} holds {} values, expected {}", path, dataset.dataspace().size(), count));
+    }
+    hdf5::ArrayAdapter<int> adapter(values, count);
+    dataset.read(adapter);
+  };
+  std::vector<std::pair<std::string, Filter>> pairs{
+      {{"everything", Filter::none}, {"included", Filter::positive}, {"excluded", Filter::negative}}
+  };
+  for (auto & [name, which]: pairs){
+    for (int a = 0; a < m.arcs; ++a){
+      for (int t = 0; t < m.triplets; ++t){
+        int * block = m.arena.data() + m.offset(which, t * m.arcs + a);
+        for (auto k: TYPEND){
+          auto path = fmt::format("{}/arc{}/triplet{}/{}/signal", name, a, t, type_dataset_name(k));
+          int * bins = block + type_offset(k);
+          read_into(path, bins, type_bins(k));
+          // the running maximum is not saved, but kept for every histogram
+          block[BLOCK + static_cast<size_t>(k)] = *std::max_element(bins, bins + type_bins(k));
+        }
+      }
+    }
+  }
+  read_into("pixels", m.pixel_data.data(), m.pixel_data.size());
+  return manager;
+}
+
+std::unique_ptr<bifrost::data::Manager> bifrost::data::Manager::load_from(std::filesystem::path file, Calibration & calib, std::optional<std::string> group) {
+  if (!hdf5::file::is_hdf5_file(std::string(file))) {
+    throw std::runtime_error(fmt::format("{} is not an HDF5 file", std::string(file)));
+  }
+  auto hdf5_file = hdf5::file::open(std::string(file), hdf5::file::AccessFlags::ReadOnly);
+  auto root = hdf5_file.root();
+  std::string name = group.value_or("fylgje");
+  if (!root.has_group(name)){
+    throw std::runtime_error(fmt::format("{} has no group /{}", std::string(file), name));
+  }
+  return load_from(root.get_group(name), calib);
+}
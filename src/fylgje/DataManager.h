@@ -6,7 +6,14 @@
 /// \brief Hold and update buffers for BIFROST-fylgje
 //===----------------------------------------------------------------------===//
 #pragma once
+#include <atomic>
+#include <cstdlib>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
 #include <vector>
 #include <QVector>
 #include <QPlot/qcustomplot/qcustomplot.h>
@@ -48,20 +55,51 @@ namespace bifrost::data {
   ///\param x the value to bin
   ///\param shift the number of bits to shift the value to the right (powers of two to divide by)
   ///\param bins the maximum number of bins which the axis is divided into
-  int hist_a_or_b(int x, int shift, int bins);
+  inline int hist_a_or_b(int x, int shift, int bins){
+    int y = x >> shift;
+    if (y < 0 || y >= bins) y = -1;
+    return y;
+  }
 
   ///\brief Identify the bin number for A+B
   ///\param x the value to bin
   ///\param shift one less than the number of bits to shift the value to the right (powers of two to divide by)
   ///\param bins the maximum number of bins which the axis is divided into
-  int hist_p(int x, int shift, int bins);
+  inline int hist_p(int x, int shift, int bins){
+    // a and b are effectively 15-bit integers
+    // so a+b is 16-bits, but we want this to fit into BIN2D bins,
+    // so we must shift by an extra bit compared to a or b above
+    int y = x >> (shift + 1);
+    if (y < 0 || y >= bins) y = -1;
+    return y;
+  }
 
   ///\brief Identify the bin number for time
   ///\returns the bin number for the time value modulus the ESS pulse period of 1/14 seconds
-  int hist_t(double x, int bins);
+  inline int hist_t(double x, int bins){
+    // time at ESS resets every 1/14 Hz ~= 70 msec.
+    // find the fraction of the current period and bin that range.
+    // Times are relative to a recent pulse, so more than 2^30 periods is as invalid as a negative time;
+    // rejecting both keeps the conversion to int in range, without fmod or branches which prevent vectorization
+    auto periods = x * 14.0;
+    bool valid = (periods >= 0.0) & (periods < static_cast<double>(1 << 30));
+    auto whole = static_cast<int>(valid ? periods : 0.0);
+    auto y = static_cast<int>((valid ? periods - whole : 0.0) * bins);
+    return valid & (y >= 0) & (y < bins) ? y : -1;
+  }
 
   ///\brief Identify the bin number for the ratio of A-B to A+B
-  int hist_x(int a, int b, int bins);
+  inline int hist_x(int a, int b, int bins){
+    int num = a - b;
+    int den = a + b;
+    // written without early returns, so that loops over many readouts can be vectorized
+    double ratio = static_cast<double>(num) / static_cast<double>(den == 0 ? 1 : den);
+    // full range is (-1, 1) so shift up by 1, multiply by 512 and convert to an integer
+    auto x = static_cast<int>((ratio + 1.0) / 2.0 * (bins - 1));
+    x = (x >= 0) & (x < bins) ? x : -1;
+    // a zero denominator or a ratio outside of the full range, |num| > |den|, goes to the first bin
+    return (den == 0) | (std::abs(num) > std::abs(den)) ? 0 : x;
+  }
 
   ///\brief Helper to calculate the bin edge values for a histogram
   template<class T, class R>
@@ -127,6 +165,97 @@ namespace bifrost::data {
   ///\brief Default number of bins for 2-D histograms
   constexpr int BIN2D = (1 << 15) >> SHIFT2D;
 
+  ///\brief The number of bins held for a histogram type
+  constexpr size_t type_bins(Type t){
+    if (Type::xp == t || Type::ab == t || Type::xt == t || Type::pt == t) return static_cast<size_t>(BIN2D) * BIN2D;
+    return BIN1D;
+  }
+
+  ///\brief The offset of a histogram type within the bins of one (arc, triplet), histograms are stored in Type order
+  constexpr size_t type_offset(Type t){
+    size_t offset{0};
+    for (int i=0; i<static_cast<int>(t); ++i) offset += type_bins(static_cast<Type>(i));
+    return offset;
+  }
+
+  ///\brief The number of bins of all histogram types for one (arc, triplet)
+  constexpr size_t BLOCK = type_offset(Type::pixel);
+
+  ///\brief The number of values stored for one (arc, triplet): its bins followed by the largest bin of each type
+  constexpr size_t STRIDE = BLOCK + TYPECOUNT;
+
+  ///\brief Readouts in structure-of-arrays form, to be histogrammed together by Manager::add_batch
+  struct Batch{
+    std::vector<int> fiber, group, a, b;
+    std::vector<double> time;
+
+    void clear(){
+      for (auto v: {&fiber, &group, &a, &b}) v->clear();
+      time.clear();
+    }
+    void push_back(int f, int g, int ra, int rb, double t){
+      fiber.push_back(f);
+      group.push_back(g);
+      a.push_back(ra);
+      b.push_back(rb);
+      time.push_back(t);
+    }
+    [[nodiscard]] size_t size() const {return time.size();}
+    void append(const Batch & other){
+      fiber.insert(fiber.end(), other.fiber.begin(), other.fiber.end());
+      group.insert(group.end(), other.group.begin(), other.group.end());
+      a.insert(a.end(), other.a.begin(), other.a.end());
+      b.insert(b.end(), other.b.begin(), other.b.end());
+      time.insert(time.end(), other.time.begin(), other.time.end());
+    }
+  };
+
+  ///\brief The lock of the histograms: exclusive and recursive for readers, shared between partition adders
+  ///
+  ///Shared owners only ever try to lock, and fail while an exclusive owner waits, so that the adders of
+  ///several partitions can not keep a reader waiting.
+  class HistogramMutex {
+  public:
+    void lock(){
+      if (owner.load() == std::this_thread::get_id()) {
+        ++depth;
+        return;
+      }
+      ++waiting;
+      mutex.lock();
+      --waiting;
+      owner = std::this_thread::get_id();
+      depth = 1;
+    }
+    bool try_lock(){
+      if (owner.load() == std::this_thread::get_id()) {
+        ++depth;
+        return true;
+      }
+      if (!mutex.try_lock()) return false;
+      owner = std::this_thread::get_id();
+      depth = 1;
+      return true;
+    }
+    void unlock(){
+      if (--depth == 0) {
+        owner = std::thread::id();
+        mutex.unlock();
+      }
+    }
+    bool try_lock_shared(){
+      return waiting.load() == 0 && mutex.try_lock_shared();
+    }
+    void unlock_shared(){
+      mutex.unlock_shared();
+    }
+  private:
+    std::shared_mutex mutex;
+    std::atomic<std::thread::id> owner{};
+    std::atomic<int> waiting{0};
+    int depth{0};
+  };
+
   ///\brief Manager for holding and updating data for BIFROST-fylgje
   class Manager{
   public:
@@ -135,10 +264,35 @@ namespace bifrost::data {
     using D2 = QCPColorMapData;
     using data_t = std::vector<int>;
   private:
-    ///\param everything histograms for all data received
-    ///\param included histograms for data which passes the calibration filter
-    ///\param excluded histograms for data which fails the calibration filter
-    map_t<data_t> everything, included, excluded;
+    ///\param arena histograms for all data received (Filter::none), data which passes the calibration
+    ///       filter (Filter::positive) and data which fails it (Filter::negative), in that order.
+    ///       Within each filter the BLOCK bins of every (arc, triplet) follow each other, each followed by
+    ///       the running maximum of its histograms, so STRIDE values per (arc, triplet).
+    data_t arena;
+    ///\param filter_size The number of values of all histograms for one filter
+    size_t filter_size;
+    ///\param generations incremented whenever data is added to an (arc, triplet) of a filter
+    std::vector<uint64_t> generations;
+
+    ///\brief A histogram rebinned for display, with its extrema, valid while its generation is current
+    struct View {
+      uint64_t generation{0};
+      int nx{0}, ny{0};
+      std::vector<double> data; // only held if the histogram is rebinned
+      int max{0}, min{0};
+    };
+    ///\param views the last requested display of each histogram, per filter and key
+    mutable std::vector<View> views;
+    ///\brief Summed-area table of one 2-D histogram, (BIN2D+1)^2 partial sums, valid while its generation is current
+    struct AreaTable {
+      key_t key{-1};
+      Filter which{Filter::none};
+      uint64_t generation{0};
+      std::vector<int64_t> sums;
+    };
+    ///\param area the table of the histogram whose display bins changed last, shared by all views, so that
+    ///       further display bins of the same data come out without reading the full histogram again
+    mutable AreaTable area;
     ///\param pixel_data data points to store post-EFU-calculation results
     data_t pixel_data;
 
@@ -165,26 +319,47 @@ namespace bifrost::data {
 
     ///\param calibration The calibration object to use for filtering data
     Calibration & calibration;
+    ///\param table The calibration compiled for lookup while adding data, replaced by recalibrate()
+    CalibrationTable table;
+
+    ///\param mutex held while the histograms change, and while they are read by another thread, see hold()
+    mutable HistogramMutex mutex;
+    ///\param clears the number of calls to clear(), pending data points kept aside before the last one are dropped
+    std::atomic<uint64_t> clears{0};
+    ///\param pending data points which arrived while the histograms were held, owned by the adding thread
+    Batch pending;
+    ///\param pending_clears the value of clears when the pending data points arrived
+    uint64_t pending_clears{0};
+
+    ///\brief The state of one adding thread of add_batch(batch, partition)
+    struct Partition {
+      ///\param pending data points of the partition which arrived while the histograms were held
+      Batch pending;
+      ///\param pending_clears the value of clears when the pending data points arrived
+      uint64_t pending_clears{0};
+      ///\param pixels pixel counts of the partition, since pixels of different arcs may coincide
+      data_t pixels;
+    };
+    ///\param partitions the partitions of the arcs, arc a belongs to partition a % partitions.size()
+    std::vector<std::unique_ptr<Partition>> partitions;
+    ///\param read_only set for histograms loaded by load_from, to which no data is added
+    bool read_only{false};
 
   public:
     Manager(int arcs, int triplets, int tubes, int pixels, Calibration & calib)
     : arcs(arcs), triplets(triplets),
-      tubes_per_triplet{tubes}, pixels_per_tube{pixels}, calibration(calib)
+      tubes_per_triplet{tubes}, pixels_per_tube{pixels}, calibration(calib), table(calib, pixels)
       {
       // setup data objects ...
-      for (auto data : {&everything, &included, &excluded}) {
-        data->resize(key_count());
-        for (int a = 0; a < arcs; ++a) {
-          for (int t = 0; t < triplets; ++t) {
-            for (auto k: TYPE1D) data->at(key(a, t, k)).resize(BIN1D, 0);
-            for (auto k: TYPE2D) data->at(key(a, t, k)).resize(BIN2D * BIN2D, 0);
-          }
-        }
-      }
+      filter_size = static_cast<size_t>(arcs) * triplets * STRIDE;
+      arena.resize(3 * filter_size, 0);
+      generations.resize(3 * arcs * triplets, 1);
+      views.resize(3 * key_count());
       pixels_per_tube_arc = triplets * pixels_per_tube;
       pixels_per_arc = tubes_per_triplet * pixels_per_tube_arc;
       total_pixels = pixels_per_arc * arcs;
       pixel_data.resize(total_pixels, 0);
+      set_partitions(1);
     }
     ~Manager() = default;
 
@@ -198,16 +373,65 @@ namespace bifrost::data {
     ///\brief Determine if the charge division would give a pixel number
     [[nodiscard]] bool includes(int arc, int triplet, int a, int b) const;
 
+    ///\brief Compile the calibration again, after it was loaded or edited
+    ///
+    ///The new lookup table replaces the old one between two added batches, so each data point is
+    ///filtered and assigned a pixel by one complete calibration.
+    void recalibrate();
+
     ///\brief Reset all histogram data to zeros
     void clear(){
-      for (auto data: {&everything, &included, &excluded}) {
-        for (auto &d: *data) std::fill(d.begin(), d.end(), 0);
-      }
+      if (read_only) return;
+      std::lock_guard lock(mutex);
+      std::fill(arena.begin(), arena.end(), 0);
+      for (auto & g: generations) ++g;
+      area = AreaTable();
+      ++clears;
+    }
+
+    ///\brief Keep the histograms unchanged until the returned lock is released
+    ///
+    ///Every read of the histograms holds them for its own duration, so each histogram is read complete;
+    ///hold them for longer to read several histograms from the same moment, e.g., for a whole plot.
+    ///Data points given to add_batch meanwhile are kept aside, and added once the histograms are free.
+    [[nodiscard]] std::unique_lock<HistogramMutex> hold() const {
+      return std::unique_lock(mutex);
     }
 
-    ///\brief Add a new data point to the histograms
+    ///\brief Add a new data point to the histograms, waits if the histograms are held
     bool add(int arc, int triplet, int a, int b, double time);
 
+    ///\brief Add all data points of a batch to the histograms, equivalent to calling add for each
+    ///
+    ///Never waits for readers: if the histograms are held the batch is kept aside until a later call
+    ///to add_batch or flush finds them free.
+    ///\returns the number of data points for which add would return true, including kept aside points
+    ///          which are added by this call, and excluding points of this batch which are kept aside
+    size_t add_batch(const Batch & batch);
+
+    ///\brief Add the data points kept aside by add_batch, if the histograms are not held
+    ///\returns the number of data points for which add would return true
+    size_t flush();
+
+    ///\brief Add the data points kept aside by either add_batch, waiting for the histograms if they are held
+    ///\returns the number of data points for which add would return true
+    size_t drain();
+
+    ///\brief Divide the arcs between threads adding data concurrently, arc a belongs to partition a % count
+    ///\param count the number of partitions, limited to (1, arcs)
+    void set_partitions(int count);
+
+    ///\brief The number of partitions of the arcs
+    [[nodiscard]] int partition_count() const {return static_cast<int>(partitions.size());}
+
+    ///\brief Add the data points of a batch which belong to the arcs of one partition
+    ///
+    ///Threads adding to different partitions do so concurrently, since the histograms of each arc are
+    ///separate, while each partition must be added to by one thread at a time. Data points of other arcs
+    ///are ignored. Like add_batch(batch), never waits for readers and keeps the batch aside instead.
+    ///\returns the number of added data points for which add would return true
+    size_t add_batch(const Batch & batch, int partition);
+
     [[nodiscard]] double max(Filter) const;
     [[nodiscard]] double max(int arc, Filter) const;
     [[nodiscard]] double max(int arc, int triplet, Filter) const;
@@ -224,8 +448,11 @@ namespace bifrost::data {
 
     [[nodiscard]] D1 data_1D(int arc, int triplet, Type t, Filter) const;
     [[nodiscard]] D1 data_1D(key_t k, Filter) const;
-    [[nodiscard]] D2 * data_2D(int arc, int triplet, Type t, Filter) const;
-    [[nodiscard]] D2 * data_2D(key_t k, Filter) const;
+    ///\brief Provide a 2-D histogram at its display bins
+    ///\param into color map data to refill, e.g., the one already shown, resized if needed;
+    ///            new color map data is allocated if not provided
+    [[nodiscard]] D2 * data_2D(int arc, int triplet, Type t, Filter, D2 * into = nullptr) const;
+    [[nodiscard]] D2 * data_2D(key_t k, Filter, D2 * into = nullptr) const;
 
     ///\brief Return the axis values for a given histogram type
     ///\param t the histogram type
@@ -263,6 +490,19 @@ namespace bifrost::data {
       if (m > 0 && m <= BIN2D) bins_2d[t] = m;
     }
 
+    ///\brief Use the display bins of another Manager, so that their histograms can be compared bin by bin
+    void set_bins(const Manager & other){
+      bins_1d = other.bins_1d;
+      bins_2d = other.bins_2d;
+    }
+
+    ///\brief The number of arcs, as given to the constructor
+    [[nodiscard]] int arc_count() const {return arcs;}
+    ///\brief The number of triplets per arc, as given to the constructor
+    [[nodiscard]] int triplet_count() const {return triplets;}
+    ///\brief Whether the histograms were loaded by load_from, and ignore added data
+    [[nodiscard]] bool is_read_only() const {return read_only;}
+
     ///\brief Identify the data key for a given arc, triplet, and histogram type
     [[nodiscard]] key_t key(int arc, int triplet, Type t) const {
       if (arc < 0 || arc >= arcs){
@@ -293,9 +533,49 @@ namespace bifrost::data {
       return TYPECOUNT * arcs * triplets;
     }
 
+    ///\brief Access the type_bins(key_type(k)) bins of the histogram for a data key
+    ///Hold the histograms from another thread than the one adding data for as long as the bins are used.
+    ///\returns nullptr if the key is not valid
+    [[nodiscard]] const int * histogram(key_t k, Filter which) const {
+      if (k < 0 || k >= key_count()) return nullptr;
+      return arena.data() + offset(which, k % (arcs * triplets)) + type_offset(key_type(k));
+    }
+
   private:
-    bool add_1D(int arc, int triplet, int a, int b, double time, bool allowed);
-    bool add_2D(int arc, int triplet, int a, int b, double time, bool allowed);
+    ///\brief The offset of the first bin of an (arc, triplet) in the arena, with index triplet * arcs + arc as for key()
+    [[nodiscard]] size_t offset(Filter which, int index) const {
+      return block_index(which, index) * STRIDE;
+    }
+    ///\brief The number of an (arc, triplet) of a filter, counting all filters, e.g., for generations
+    [[nodiscard]] size_t block_index(Filter which, int index) const {
+      return static_cast<size_t>(which) * arcs * triplets + static_cast<size_t>(index);
+    }
+
+    ///\brief The largest bin of the full resolution histogram for a valid data key, kept while adding data
+    [[nodiscard]] int peak(key_t k, Filter which) const {
+      return arena[offset(which, static_cast<int>(k % (arcs * triplets))) + BLOCK + static_cast<size_t>(key_type(k))];
+    }
+    ///\brief The display of a histogram at its current display bins, rebinned only if it changed since
+    const View & view(key_t k, Filter which) const;
+
+    ///\brief The unique pixel number of a calibrated data point, 0 if it is not included
+    [[nodiscard]] int pixel(int arc, int triplet, const CalibrationResult & result) const;
+
+    ///\brief Add all data points of a batch to the histograms, which must be locked
+    ///\param partition add only data points of this partition's arcs, or all if negative
+    size_t add_locked(const Batch & batch, int partition = -1);
+    ///\brief Keep a batch aside while the histograms are held, dropping kept points from before a clear()
+    void keep_aside(Batch & kept, uint64_t & kept_clears, const Batch & batch) const;
+    ///\brief Add the pending data points to the histograms, which must be locked
+    ///\param partition add the data points kept aside for this partition, or by add_batch(batch) if negative
+    size_t add_pending(int partition = -1);
+
+    bool add_1D(int * all, int * filtered, int a, int b, double time);
+    bool add_2D(int * all, int * filtered, int a, int b, double time);
+    ///\brief Increment the 1-D histogram bins of one (arc, triplet) in everything and its filtered histograms
+    static void count_1D(int * all, int * filtered, int a, int b, int p, int x, int t);
+    ///\brief Increment the 2-D histogram bins of one (arc, triplet) in everything and its filtered histograms
+    static void count_2D(int * all, int * filtered, int a, int b, int p, int x, int t);
 
     [[nodiscard]] int max_1D(key_t t, Filter) const;
     [[nodiscard]] int max_2D(key_t t, Filter) const;
@@ -325,9 +605,26 @@ namespace bifrost::data {
   public:
     std::vector<uint64_t> type_dimensions(Type type) const;
 
-    void save_to(std::filesystem::path file, std::optional<std::string> group = std::nullopt) const;
-    void save_to(hdf5::file::File file, std::optional<std::string> group = std::nullopt) const;
-    void save_to(hdf5::node::Group group) const;
+    ///\brief Called with the number of written parts of a file and their total number
+    using progress_t = std::function<void(int done, int total)>;
+
+    ///\brief Write all histograms and pixel counts to an HDF5 group, in a new or existing file
+    ///
+    ///The histograms are held only to copy one (arc, triplet) at a time, so saving may take place on another
+    ///thread while data is added and plotted; every histogram in the file is complete, and the histograms of
+    ///one (arc, triplet) are from the same moment. Different (arc, triplet)s are not, so the group has a snapshot
+    ///attribute "per (arc, triplet)" and each triplet group a copied attribute, in ms since the UTC epoch.
+    void save_to(std::filesystem::path file, std::optional<std::string> group = std::nullopt, const progress_t & progress = {}) const;
+    void save_to(hdf5::file::File file, std::optional<std::string> group = std::nullopt, const progress_t & progress = {}) const;
+    void save_to(hdf5::node::Group group, const progress_t & progress = {}) const;
+
+    ///\brief Read the histograms and pixel counts written by save_to into a new, read-only, Manager
+    ///
+    ///Each dataset is read straight into the bins of the new Manager, in the native integer type, e.g., to
+    ///compare the data being received with an earlier accumulation. Data added to it is ignored.
+    ///\param calib the calibration of the new Manager, which must outlive it
+    static std::unique_ptr<Manager> load_from(std::filesystem::path file, Calibration & calib, std::optional<std::string> group = std::nullopt);
+    static std::unique_ptr<Manager> load_from(hdf5::node::Group group, Calibration & calib);
   };
 
 }
@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <fmt/format.h>
 #include <iostream>
+#include <thread>
 #include <unistd.h>
 #include <utility>
 #include <vector>
@@ -48,11 +49,18 @@ ESSConsumer::ESSConsumer(data_t * data, Configuration & config,
   {
   mConsumer = subscribeTopic();
   assert(mConsumer != nullptr);
+  if (configuration.Kafka.IngestThreads > 1) {
+    auto decode = [](const uint8_t * readouts, int size, const IngestPool::header_t & header,
+                     ::bifrost::data::Batch * batches, int partitions){
+      decodeCAENData(readouts, size, header[0], header[1], header[2], header[3], batches, partitions);
+    };
+    pool = std::make_unique<IngestPool>(histograms, configuration.Kafka.IngestThreads, decode);
+  }
   // if ... something is set in the gui, then seek the consumer offset before consuming
     setConsumerOffset(End, -1);
 }
 
-RdKafka::KafkaConsumer *ESSConsumer::subscribeTopic() const {
+RdKafka::KafkaConsumer *ESSConsumer::subscribeTopic(bool partition_eof) const {
   auto mConf = RdKafka::Conf::create(RdKafka::Conf::CONF_GLOBAL);
 
   if (!mConf) {
@@ -74,6 +82,9 @@ RdKafka::KafkaConsumer *ESSConsumer::subscribeTopic() const {
   for (auto &Config : mKafkaConfig) {
     mConf->set(Config.first, Config.second, ErrStr);
   }
+  if (partition_eof) {
+    mConf->set("enable.partition.eof", "true", ErrStr);
+  }
 
   auto ret = RdKafka::KafkaConsumer::create(mConf, ErrStr);
   if (!ret) {
@@ -194,22 +205,37 @@ void ESSConsumer::setTopicPartitionOffset(std::vector<RdKafka::TopicPartition*>&
 
 /// \brief Example parser for CAEN Data
 uint32_t ESSConsumer::parseCAENData(uint8_t * Readout, int Size, uint32_t hi, uint32_t lo, uint32_t p_hi, uint32_t p_lo) {
-  uint32_t processed{0};
+  uint32_t processed = Size > 0 ? Size / static_cast<int>(sizeof(CAENReadout)) : 0;
+  std::lock_guard lock(ingesting);
+  if (pool) {
+    // the readouts are split by arc here, and the pool's threads add them, each for its own arcs
+    pool->add(Readout, static_cast<int>(processed * sizeof(CAENReadout)), {hi, lo, p_hi, p_lo});
+    return processed;
+  }
+  // decode the readouts into arrays first, so that the data manager can bin them all together
+  batch.clear();
+  decodeCAENData(Readout, Size, hi, lo, p_hi, p_lo, &batch);
+  histograms->add_batch(batch);
+  return processed;
+}
+
+void ESSConsumer::decodeCAENData(const uint8_t * Readout, int Size, uint32_t hi, uint32_t lo, uint32_t p_hi, uint32_t p_lo,
+                                 ::bifrost::data::Batch * batches, int partitions) {
   int BytesLeft = Size;
   while (BytesLeft >= static_cast<int>(sizeof(CAENReadout))) {
-    auto * crd = (CAENReadout *)Readout;
+    auto * crd = (const CAENReadout *)Readout;
     if (crd->FEN != 0){
       printf("FEN %u, Length %u, HighTime %u, LowTime %u, Flags %u, Group %u\n",
              crd->FEN, crd->Length, crd->HighTime, crd->LowTime, crd->Flags_OM, crd->Group);
     } else {
       auto time = frame_time(hi, lo, p_hi, p_lo, crd->HighTime, crd->LowTime);
-      histograms->add(crd->Fiber, crd->Group, crd->A, crd->B, time);
+      // readouts of invalid arcs are ignored by every partition, so any will do
+      const auto arc = ::bifrost::arc(crd->Group);
+      batches[arc < 0 ? 0 : arc % partitions].push_back(crd->Fiber, crd->Group, crd->A, crd->B, time);
     }
     BytesLeft -= sizeof(CAENReadout);
     Readout += sizeof(CAENReadout);
-    ++processed;
   }
-  return processed;
 }
 
 /// Main processing function for AR51 data
@@ -262,9 +288,16 @@ uint32_t ESSConsumer::processAR51Data(RdKafka::Message *Msg) {
 ESSConsumer::Status ESSConsumer::handleMessage(RdKafka::Message *Message) {
   switch (Message->err()) {
   case RdKafka::ERR__TIMED_OUT:
+    // add readouts which arrived while the histograms were held, since no new message will do so
+    flush();
     return Continue;
 
   case RdKafka::ERR_NO_ERROR: {
+      if (paused) {
+        // nor will ignored messages, while others add readouts
+        flush();
+        return Continue;
+      }
       uint32_t count{0};
       if (latest_timestamp < 0 || Message->timestamp().timestamp < latest_timestamp) {
         if (RawReadoutMessageBufferHasIdentifier(Message->payload())) {
@@ -281,6 +314,134 @@ ESSConsumer::Status ESSConsumer::handleMessage(RdKafka::Message *Message) {
   }
 }
 
+void ESSConsumer::flush() {
+  std::lock_guard lock(ingesting);
+  if (pool) {
+    pool->flush();
+  } else {
+    histograms->flush();
+  }
+}
+
+void ESSConsumer::consumeRange(int64_t from, int64_t until, const std::function<void(int64_t, int64_t)> & progress,
+                               const std::function<bool()> & stop) {
+  const auto & topic = configuration.Kafka.Topic;
+  std::unique_ptr<RdKafka::KafkaConsumer> resolver(subscribeTopic());
+  if (!resolver) {
+    throw std::runtime_error("Failed to create a consumer to find the offsets of the time range");
+  }
+  RdKafka::Metadata * metadataptr{nullptr};
+  auto resp = resolver->metadata(true, nullptr, &metadataptr, 1000);
+  if (resp != RdKafka::ERR_NO_ERROR || metadataptr == nullptr) {
+    throw std::runtime_error(fmt::format("Failed retrieving metadata: {}", err2str(resp)));
+  }
+  std::vector<int32_t> ids;
+  for (const auto & topic_meta: *metadataptr->topics()) {
+    if (topic_meta->topic() != topic) continue;
+    for (const auto & partition: *topic_meta->partitions()) ids.push_back(partition->id());
+  }
+  delete metadataptr;
+  if (ids.empty()) {
+    throw std::runtime_error(fmt::format("Topic {} has no partitions", topic));
+  }
+
+  // the offsets of the first messages at or after both timestamps, -1 if there is none
+  auto offsets = [&](int64_t ms_since_utc_epoch){
+    std::vector<RdKafka::TopicPartition*> tps;
+    for (auto id: ids) tps.push_back(RdKafka::TopicPartition::create(topic, id, ms_since_utc_epoch));
+    auto err = resolver->offsetsForTimes(tps, 1000);
+    if (err != RdKafka::ERR_NO_ERROR) {
+      RdKafka::TopicPartition::destroy(tps);
+      throw std::runtime_error(fmt::format("Failed retrieving offsets after {} for {}: {}", ms_since_utc_epoch, topic, err2str(err)));
+    }
+    std::vector<int64_t> found;
+    for (const auto * tp: tps) found.push_back(tp->err() == RdKafka::ERR_NO_ERROR ? tp->offset() : -1);
+    RdKafka::TopicPartition::destroy(tps);
+    return found;
+  };
+  auto first = offsets(from < 0 ? 0 : from);
+  auto last = until < 0 ? std::vector<int64_t>(ids.size(), -1) : offsets(until);
+
+  struct Range {int32_t id; int64_t first; int64_t last;};
+  std::vector<Range> ranges;
+  int64_t total{0};
+  for (size_t i = 0; i < ids.size(); ++i) {
+    int64_t low{0}, high{0};
+    resp = resolver->query_watermark_offsets(topic, ids[i], &low, &high, 1000);
+    if (resp != RdKafka::ERR_NO_ERROR) {
+      throw std::runtime_error(fmt::format("Failed retrieving watermark offsets for {} (partition {}): {}", topic, ids[i], err2str(resp)));
+    }
+    // messages are consumed up to, excluding, the last offset
+    auto begin = first[i] < 0 ? high : std::max(first[i], low);
+    auto end = last[i] < 0 ? high : std::min(last[i], high);
+    fmt::print("Consuming offsets ({}, {}) of {} (partition {})\n", begin, end, topic, ids[i]);
+    if (begin < end) {
+      ranges.push_back({ids[i], begin, end});
+      total += end - begin;
+    }
+  }
+  resolver->close();
+
+  // a few readers fetch as fast as the broker delivers, each reads one partition range after another
+  auto readers = std::min({ranges.size(), static_cast<size_t>(std::max(1u, std::thread::hardware_concurrency())), RANGE_READERS});
+  std::atomic<int64_t> done{0};
+  std::atomic<size_t> next{0};
+  std::atomic<size_t> running{readers};
+  auto consume_ranges = [&](){
+    // the end of a partition is reported, since offsets up to the end of a range may have no message
+    std::unique_ptr<RdKafka::KafkaConsumer> reader(subscribeTopic(true));
+    for (auto i = next++; i < ranges.size(); i = next++) {
+      const auto & range = ranges[i];
+      int64_t offset{range.first};
+      if (reader) {
+        std::vector<RdKafka::TopicPartition*> tps{RdKafka::TopicPartition::create(topic, range.id, range.first)};
+        reader->assign(tps);
+        RdKafka::TopicPartition::destroy(tps);
+        while (offset < range.last && !stop()) {
+          std::unique_ptr<RdKafka::Message> message(reader->consume(100));
+          if (message->err() == RdKafka::ERR__TIMED_OUT) continue;
+          if (message->err() == RdKafka::ERR__PARTITION_EOF) break;
+          if (message->err() != RdKafka::ERR_NO_ERROR) {
+            fmt::print("Consume failed for {} (partition {}): {}\n", topic, range.id, message->errstr());
+            break;
+          }
+          // offsets may have gaps, so progress counts the offsets passed
+          done += message->offset() + 1 - offset;
+          offset = message->offset() + 1;
+          if (until >= 0 && message->timestamp().timestamp >= until) break;
+          if (RawReadoutMessageBufferHasIdentifier(message->payload())) {
+            processAR51Data(message.get());
+          } else {
+            printf("Not a ar51 Kafka message!\n");
+          }
+        }
+        reader->unassign();
+      } else {
+        fmt::print("Failed to create a consumer for {} (partition {})\n", topic, range.id);
+      }
+      // a partition which stopped early is done with its range as well
+      done += std::max<int64_t>(range.last - offset, 0);
+    }
+    if (reader) reader->close();
+    --running;
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < readers; ++i) threads.emplace_back(consume_ranges);
+  while (running > 0) {
+    if (progress) progress(done, total);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  }
+  for (auto & thread: threads) thread.join();
+  // everything is added once this returns, so that the histograms may be cleared for another range;
+  // the pool threads and flush only add if the histograms are free, so this waits for them instead
+  {
+    std::lock_guard lock(ingesting);
+    if (pool) pool->drain();
+    histograms->drain();
+  }
+  if (progress) progress(total, total);
+}
+
 // Copied from daqlite - modified to not reinstantiate charset 'length' times
 std::string ESSConsumer::randomGroupString(size_t length) {
   srand(getpid());
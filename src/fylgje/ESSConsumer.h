@@ -14,6 +14,11 @@
 #include "ar51_readout_data_generated.h"
 #include <librdkafka/rdkafkacpp.h>
 #include "DataManager.h"
+#include "IngestPool.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
 
 class ESSConsumer {
 public:
@@ -60,7 +65,8 @@ public:
   RdKafka::Message *consume();
 
   /// \brief setup librdkafka parameters for Broker and Topic
-  [[nodiscard]] RdKafka::KafkaConsumer *subscribeTopic() const;
+  /// \param partition_eof report reaching the end of a partition as ERR__PARTITION_EOF
+  [[nodiscard]] RdKafka::KafkaConsumer *subscribeTopic(bool partition_eof = false) const;
 
   /// \brief initial checks for kafka error messages
   /// \return true if message contains data, false otherwise
@@ -72,6 +78,12 @@ public:
   ///
   uint32_t parseCAENData(uint8_t * Readout, int Size, uint32_t pulse_high, uint32_t pulse_low, uint32_t prev_high, uint32_t prev_low);
 
+  /// \brief decode the CAEN readouts into one batch per partition of the arcs
+  /// \param batches the readouts of arc a are added to batches[a % partitions]
+  static void decodeCAENData(const uint8_t * Readout, int Size, uint32_t pulse_high, uint32_t pulse_low,
+                             uint32_t prev_high, uint32_t prev_low, ::bifrost::data::Batch * batches,
+                             int partitions = 1);
+
   static std::string randomGroupString(size_t length);
 
   [[maybe_unused]] void consumeAll();
@@ -79,7 +91,27 @@ public:
   void consumeFrom(int64_t ms_since_utc_epoch);
   void consumeUntil(int64_t ms_since_utc_epoch);
 
+  /// \brief consume the messages of every partition with timestamps in [from, until), fetched in parallel
+  ///
+  /// Up to RANGE_READERS threads, each with its own Kafka consumer, read one partition after another, from
+  /// the offset found for the first timestamp to the offset found for the last. Only the fetching is
+  /// parallel: the readouts go to the histograms through the same path as those of live messages, one
+  /// message at a time, so decoding and histogramming are serial unless ingest threads are configured, in
+  /// which case the partitions of the arcs are histogrammed in parallel. Pause the live messages meanwhile.
+  /// \param until end of the range, or negative for the messages up to now
+  /// \param progress called regularly with the number of consumed and total messages
+  /// \param stop polled while consuming, returns true to abandon the rest of the range
+  void consumeRange(int64_t from_ms_since_utc_epoch, int64_t until_ms_since_utc_epoch,
+                    const std::function<void(int64_t done, int64_t total)> & progress,
+                    const std::function<bool()> & stop);
+
+  /// \brief ignore (true) or histogram (false) the messages of the live consumer
+  void pause(bool ignore){ paused = ignore; }
+
 private:
+  /// \brief the most threads fetching the messages of a time range, fewer if there are fewer cores or partitions
+  static constexpr size_t RANGE_READERS{8};
+
   Configuration & configuration;
 
   RdKafka::KafkaConsumer *mConsumer;
@@ -87,10 +119,21 @@ private:
   int64_t earliest_timestamp{-1}, latest_timestamp{-1};
 
   data_t * histograms;
+  /// \brief readouts of the current message, kept to reuse its allocations
+  ::bifrost::data::Batch batch;
+  /// \brief threads decoding and adding readouts per partition of the arcs, if configured
+  std::unique_ptr<IngestPool> pool;
+  /// \brief held while readouts are handed to the pool or histograms, which serializes the readers of consumeRange
+  std::mutex ingesting;
+  /// \brief whether the messages of the live consumer are ignored
+  std::atomic<bool> paused{false};
 
   /// \brief loadable Kafka-specific configuration
   std::vector<std::pair<std::string, std::string>> &mKafkaConfig;
 
   void setConsumerOffset(Start start, int64_t ms_since_utc_epoch);
   void setTopicPartitionOffset(std::vector<RdKafka::TopicPartition*>& tps, Start start, int64_t ms_since_utc_epoch);
+
+  /// \brief add readouts which arrived while the histograms were held
+  void flush();
 };
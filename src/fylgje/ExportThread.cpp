@@ -0,0 +1,24 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file ExportThread.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include "ExportThread.h"
+
+void ExportThread::run() {
+  namespace fs = std::filesystem;
+  // an interrupted export of a new file leaves no file behind which looks complete
+  auto fresh = !fs::exists(file);
+  auto target = fresh ? fs::path(file.string() + ".part") : file;
+  try {
+    data->save_to(target, std::nullopt, [this](int done, int total){ emit progress(done, total); });
+    if (fresh) fs::rename(target, file);
+    ok = true;
+  } catch (const std::exception & ex) {
+    std::error_code ec;
+    if (fresh) fs::remove(target, ec);
+    emit failed(QString::fromStdString(ex.what()));
+  }
+}
@@ -0,0 +1,44 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file ExportThread.h
+///
+/// \brief Writes the histograms to an HDF5 file without blocking the GUI
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "DataManager.h"
+#include <QString>
+#include <QThread>
+#include <filesystem>
+
+class ExportThread : public QThread {
+  Q_OBJECT
+
+public:
+  using data_t = ::bifrost::data::Manager;
+  ExportThread(const data_t * data, std::filesystem::path file, QObject * parent = nullptr):
+  QThread(parent), data(data), file(std::move(file)) {}
+
+  /// \brief write the file, which is created under a temporary name first if it does not exist yet
+  void run() override;
+
+  /// \brief the file written to
+  [[nodiscard]] const std::filesystem::path & path() const {return file;}
+
+  /// \brief whether the file was written completely, valid once the thread finished
+  [[nodiscard]] bool succeeded() const {return ok;}
+
+private:
+  const data_t * data;
+  std::filesystem::path file;
+  bool ok{false};
+
+signals:
+  /// \brief this signal is 'emitted' whenever another part of the file is written
+  void progress(int done, int total);
+
+  /// \brief this signal is 'emitted' if the file could not be written
+  void failed(QString message);
+};
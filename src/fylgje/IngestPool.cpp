@@ -0,0 +1,83 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file IngestPool.cpp
+///
+//===----------------------------------------------------------------------===//
+
+#include "IngestPool.h"
+
+IngestPool::IngestPool(data_t * data, int count, decoder_t decoder)
+: histograms(data), decode(std::move(decoder)) {
+  histograms->set_partitions(count);
+  partitions = histograms->partition_count();
+  for (auto & round: rounds) round.batches.resize(partitions);
+  for (int p = 0; p < partitions; ++p) {
+    threads.emplace_back(&IngestPool::work, this, p);
+  }
+}
+
+IngestPool::~IngestPool(){
+  dispatch();
+  {
+    std::unique_lock lock(mutex);
+    finished.wait(lock, [this]{return busy == 0;});
+    stop = true;
+  }
+  started.notify_all();
+  for (auto & thread: threads) thread.join();
+}
+
+void IngestPool::add(const uint8_t * readouts, int size, const header_t & header){
+  auto & round = rounds[filling];
+  decode(readouts, size, header, round.batches.data(), partitions);
+  // idle threads get every message right away, busy ones get larger rounds
+  bool idle;
+  {
+    std::lock_guard lock(mutex);
+    idle = busy == 0;
+  }
+  if (idle || round.size() >= ROUND_READOUTS) dispatch();
+}
+
+void IngestPool::flush(){
+  dispatch();
+}
+
+void IngestPool::drain(){
+  dispatch();
+  std::unique_lock lock(mutex);
+  finished.wait(lock, [this]{return busy == 0;});
+}
+
+void IngestPool::dispatch(){
+  std::unique_lock lock(mutex);
+  finished.wait(lock, [this]{return busy == 0;});
+  busy = partitions;
+  ++sequence;
+  filling ^= 1;
+  // the threads are done with the round which is filled next
+  rounds[filling].clear();
+  lock.unlock();
+  started.notify_all();
+}
+
+void IngestPool::work(int partition){
+  uint64_t seen{0};
+  while (true) {
+    const Round * round;
+    {
+      std::unique_lock lock(mutex);
+      started.wait(lock, [&]{return stop || sequence != seen;});
+      if (stop) return;
+      seen = sequence;
+      round = &rounds[filling ^ 1];
+    }
+    histograms->add_batch(round->batches[partition], partition);
+    {
+      std::lock_guard lock(mutex);
+      --busy;
+    }
+    finished.notify_all();
+  }
+}
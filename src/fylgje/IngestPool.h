@@ -0,0 +1,90 @@
+// Copyright (C) 2026 European Spallation Source, ERIC. See LICENSE file
+//===----------------------------------------------------------------------===//
+///
+/// \file IngestPool.h
+///
+/// \brief Threads histogramming readouts, each for its own partition of the arcs
+///
+/// The consume loop decodes each message once, splitting its readouts by arc into one batch per partition
+/// of the current round, which is handed to the threads as soon as they are idle, or once it is full, while
+/// the next round is filled. Every thread adds the batch of its own arcs only, so the threads add to separate
+/// histograms and neither merge their results nor wait for each other.
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "DataManager.h"
+
+class IngestPool {
+public:
+  using data_t = ::bifrost::data::Manager;
+  using Batch = ::bifrost::data::Batch;
+  /// \brief The pulse times of the message header, (high, low, previous high, previous low)
+  using header_t = std::array<uint32_t, 4>;
+  /// \brief Decode a span of readouts, those of arc a into batches[a % partitions]
+  using decoder_t = std::function<void(const uint8_t * readouts, int size, const header_t & header,
+                                       Batch * batches, int partitions)>;
+
+  /// \brief Start one thread per partition of the arcs of the histograms
+  /// \param threads the number of partitions, at most the number of arcs
+  IngestPool(data_t * data, int threads, decoder_t decoder);
+  ~IngestPool();
+  IngestPool(const IngestPool &) = delete;
+  IngestPool & operator=(const IngestPool &) = delete;
+
+  /// \brief Decode a span of readouts into the current round, which the threads add later
+  void add(const uint8_t * readouts, int size, const header_t & header);
+
+  /// \brief Hand the current round to the threads, even if empty, so that they also add their
+  ///        readouts kept aside while the histograms were held
+  void flush();
+
+  /// \brief Hand the current round to the threads and wait until they added it
+  void drain();
+
+private:
+  /// \brief The number of readouts in a round at which the consume loop waits for the threads
+  static constexpr size_t ROUND_READOUTS{1 << 16};
+
+  struct Round {
+    /// \brief The readouts of each partition
+    std::vector<Batch> batches;
+    [[nodiscard]] size_t size() const {
+      size_t count{0};
+      for (const auto & batch: batches) count += batch.size();
+      return count;
+    }
+    void clear(){
+      for (auto & batch: batches) batch.clear();
+    }
+  };
+
+  /// \brief Wait for the threads to finish the last round, then hand them the current one
+  void dispatch();
+  /// \brief The loop of the thread adding the readouts of one partition
+  void work(int partition);
+
+  data_t * histograms;
+  decoder_t decode;
+  int partitions;
+  /// \brief rounds[filling] is filled by add, the other one is worked on by the threads
+  std::array<Round, 2> rounds;
+  int filling{0};
+
+  std::mutex mutex;
+  std::condition_variable started;
+  std::condition_variable finished;
+  /// \brief The number of rounds handed to the threads
+  uint64_t sequence{0};
+  /// \brief The number of threads still working on the last round
+  int busy{0};
+  bool stop{false};
+  std::vector<std::thread> threads;
+};
@@ -107,6 +107,25 @@ void PlotManager::plot_all_included_excluded(int i, int j, const std::vector<dou
   ax->setRange(min - (max - min) / 40, max + (max - min) / 20);
 }
 
+void PlotManager::plot_references(int i, int j, const std::vector<double> & std_x,
+                                  const std::optional<std::vector<double>> & all,
+                                  const std::optional<std::vector<double>> & included,
+                                  const std::optional<std::vector<double>> & excluded) {
+  using ::bifrost::data::Filter;
+  auto k = key(i, j);
+  if (!dims.count(k) || dims.at(k) != Dim::one) return;
+
+  QVector<double> x(std_x.begin(), std_x.end());
+  for (const auto & [filter, y]: {std::make_pair(Filter::none, &all), std::make_pair(Filter::positive, &included), std::make_pair(Filter::negative, &excluded)}){
+    auto g = references.at(key(i, j, filter));
+    if (y->has_value()) {
+      g->setData(x, QVector<double>(y->value().begin(), y->value().end()));
+    } else {
+      g->data()->clear();
+    }
+  }
+}
+
 void PlotManager::plot(int i, int j, QCPColorMapData * data, double min, double max, bool is_log,
           std::string_view gradient, bool is_inverted,
           const std::optional<std::vector<std::pair<double, double>>> & left,
@@ -117,7 +136,8 @@ void PlotManager::plot(int i, int j, QCPColorMapData * data, double min, double
   if (!images.count(k)) return;
   auto im = images.at(k);
   // Why does setData _require_ a mutable pointer?
-  im->setData(data);
+  // Data refilled in place through image_data is already owned by the color map, and redrawn as modified
+  if (data != im->data()) im->setData(data);
   auto p = plots.at(k);
   p->xAxis->setRange(0, ::bifrost::data::BIN2D);
   p->yAxis->setRange(0, ::bifrost::data::BIN2D);
@@ -190,6 +210,9 @@ void PlotManager::make_1D(int i, int j, bool flip, type_t t){
     lines[lk] = new QCPGraph(flip ? plots[k]->yAxis : plots[k]->xAxis, flip ? plots[k]->xAxis : plots[k]->yAxis);
     lines[lk]->setLineStyle(QCPGraph::LineStyle::lsStepCenter);
     lines[lk]->setPen(QPen(color));
+    references[lk] = new QCPGraph(flip ? plots[k]->yAxis : plots[k]->xAxis, flip ? plots[k]->xAxis : plots[k]->yAxis);
+    references[lk]->setLineStyle(QCPGraph::LineStyle::lsStepCenter);
+    references[lk]->setPen(QPen(color, 1, Qt::DashLine));
   }
   //plots[k]->setInteractions(QCP::iRangeDrag| QCP::iRangeZoom | QCP::iSelectPlottables);
 }
@@ -49,8 +49,21 @@ public:
                                   const std::optional<std::vector<double>> & excluded,
                                   double min, double max, bool is_log);
 
+  /// \brief Show reference 1D histograms, dashed, on a plot drawn by plot_all_included_excluded
+  /// Histograms which are not provided are removed from the plot.
+  void plot_references(int i, int j, const std::vector<double> & std_x,
+                       const std::optional<std::vector<double>> & all,
+                       const std::optional<std::vector<double>> & included,
+                       const std::optional<std::vector<double>> & excluded);
+
+  /// \brief The color map data shown by a 2D plot, to be refilled in place and passed back to plot
+  /// \returns nullptr if there is no 2D plot at (i, j)
+  [[nodiscard]] QCPColorMapData * image_data(int i, int j) const {
+    auto k = key(i, j);
+    return images.count(k) ? images.at(k)->data() : nullptr;
+  }
 
-  /// \brief Plot a 2D histogram
+  /// \brief Plot a 2D histogram, taking ownership of the data unless it is the plot's own image_data
   void plot(int i, int j, QCPColorMapData * data, double min, double max, bool is_log,
             std::string_view gradient, bool is_inverted,
             const std::optional<std::vector<std::pair<double, double>>> & left,
@@ -76,6 +89,7 @@ private:
   std::map<int, QCustomPlot *> plots;
   std::map<int, QCPColorMap *> images;
   std::map<int, QCPGraph *> lines;
+  std::map<int, QCPGraph *> references;
   std::map<int, QCPCurve *> polygons;
   std::map<int, Dim> dims;
   std::map<int, type_t> types;
@@ -86,6 +100,7 @@ private:
     plots.clear();
     images.clear();
     lines.clear();
+    references.clear();
     dims.clear();
     types.clear();
     flipped.clear();
@@ -102,6 +117,7 @@ private:
     if (plots.count(k)) plots.erase(k);
     if (images.count(k)) images.erase(k);
     if (lines.count(k)) lines.erase(k);
+    if (references.count(k)) references.erase(k);
     if (dims.count(k)) dims.erase(k);
     if (types.count(k)) types.erase(k);
     if (flipped.count(k)) flipped.erase(k);